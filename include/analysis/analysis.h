@@ -6,6 +6,9 @@
 
 #include "binutils/cubin.h"
 #include "common/map.h"
+#include "common/stats.h"
+#include "common/vector.h"
+#include "operation/interval_set.h"
 #include "operation/kernel.h"
 #include "operation/memory.h"
 #include "operation/operation.h"
@@ -21,13 +24,133 @@ struct Trace {
   virtual ~Trace() = 0;
 };
 
+// 128-bit vectors with 8-bit units
+const int WARP_ACCESS_MAX_UNITS = 16;
+
+/**
+ * @brief Resolved lanes of a single warp record, stored as structure-of-arrays.
+ * Only lanes set in active have valid entries.
+ */
+struct WarpAccess {
+  u64 pc;
+  u32 active;
+  u32 num_units;
+  GPUPatchFlags flags;
+  // Unit access kind, vec_size == unit_size
+  AccessKind access_kind;
+  ThreadId thread_ids[GPU_PATCH_WARP_SIZE];
+  u64 addresses[GPU_PATCH_WARP_SIZE];
+  MemoryView memories[GPU_PATCH_WARP_SIZE];
+  // <unit index, lane>
+  u64 values[WARP_ACCESS_MAX_UNITS][GPU_PATCH_WARP_SIZE];
+
+  WarpAccess() : pc(0), active(0), num_units(0), flags(GPU_PATCH_NONE), thread_ids(), addresses(), values() {}
+};
+
+// Merged ranges of the accesses to a memory object
+struct MemoryAccessRanges {
+  u64 op_id;
+  i32 ctx_id;
+  IntervalSet reads;
+  IntervalSet writes;
+
+  MemoryAccessRanges(u64 op_id, i32 ctx_id) : op_id(op_id), ctx_id(ctx_id) {}
+};
+
+/**
+ * @brief Read and write ranges of every memory object accessed by a trace.
+ *
+ * Built once per trace and sorted and coalesced before it is passed to analyses that only use
+ * the footprints of accesses.
+ */
+class AccessRanges {
+ public:
+  // <memory op_id, ranges>
+  typedef Map<u64, MemoryAccessRanges>::const_iterator const_iterator;
+
+ public:
+  AccessRanges() = default;
+
+  AccessRanges(const AccessRanges &) = delete;
+
+  AccessRanges &operator=(const AccessRanges &) = delete;
+
+  /**
+   * @brief Add [start, end) of memory, a read if flags has GPU_PATCH_READ, a write if flags has
+   * GPU_PATCH_WRITE
+   */
+  void add(const MemoryView &memory, u64 start, u64 end, GPUPatchFlags flags) {
+    // Lanes of a record mostly access the same object
+    if (_last == NULL || _last->op_id != memory.op_id) {
+      _last = &ranges(memory);
+    }
+    if (flags & GPU_PATCH_READ) {
+      _last->reads.add(start, end);
+    }
+    if (flags & GPU_PATCH_WRITE) {
+      _last->writes.add(start, end);
+    }
+  }
+
+  /**
+   * @brief Sort and coalesce the ranges of every object, called once all accesses are added
+   */
+  void normalize();
+
+  bool empty() const { return _ranges.empty(); }
+
+  const_iterator begin() const { return _ranges.begin(); }
+
+  const_iterator end() const { return _ranges.end(); }
+
+ private:
+  MemoryAccessRanges &ranges(const MemoryView &memory);
+
+ private:
+  Map<u64, MemoryAccessRanges> _ranges;
+  MemoryAccessRanges *_last = NULL;
+};
+
+inline u32 trace_type_mask(GPUPatchType type) { return 0x1u << type; }
+
+inline u32 op_type_mask(OperationType type) { return 0x1u << type; }
+
+const u32 TRACE_TYPE_ALL = (0x1u << GPU_PATCH_TYPE_COUNT) - 1;
+const u32 TRACE_TYPE_ADDRESS =
+    (0x1u << GPU_PATCH_TYPE_ADDRESS_PATCH) | (0x1u << GPU_PATCH_TYPE_ADDRESS_ANALYSIS);
+const u32 OP_TYPE_ALL = (0x1u << OPERATION_TYPE_COUNT) - 1;
+
+/**
+ * @brief Events an analysis consumes. Only subscribers of an event are called, and trace data
+ * that no subscriber needs is not decoded.
+ */
+struct AnalysisCapabilities {
+  // trace_type_mask of traces passed to analysis_begin and analysis_end
+  u32 trace_types = 0;
+  // If warp_access and unit_access are called for the accesses of these traces
+  bool accesses = false;
+  // If unit values of default traces are used
+  bool values = false;
+  // If per-lane thread ids of default traces are used
+  bool thread_ids = false;
+  // If only the memory ranges of accesses are used, regardless of which lanes access them,
+  // range_access is called instead of warp_access
+  bool ranges_only = false;
+  // If accesses are only counted regardless of their order, so identical records of default
+  // traces may be passed once to weighted_warp_access
+  bool weighted = false;
+  bool block_exit = false;
+  // op_type_mask of operations passed to op_callback
+  u32 op_types = 0;
+};
+
 class Analysis {
  public:
   Analysis(redshow_analysis_type_t type) : _type(type), _dtoh(NULL) {}
 
   virtual ~Analysis() = default;
 
-  virtual void lock() { this->_lock.lock(); }
+  virtual void lock() { stats_lock(this->_lock); }
 
   virtual void unlock() { this->_lock.unlock(); }
 
@@ -43,6 +166,8 @@ class Analysis {
     this->_configs[config] = enable;
   }
 
+  virtual AnalysisCapabilities capabilities() const = 0;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false) = 0;
 
@@ -70,15 +195,49 @@ class Analysis {
    * @param read read/write
    */
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags) = 0;
 
+  /**
+   * @brief A callback for every resolved warp record. The default implementation falls back to
+   * unit_access for every active lane and unit.
+   *
+   * @param kernel_id kernel context id
+   * @param host_op_id kernel operation id
+   * @param access resolved lanes of a record
+   */
+  virtual void warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access);
+
+  /**
+   * @brief A callback for a resolved warp record that repeats count times, called instead of
+   * warp_access for folded records if the analysis is weighted. The default implementation calls
+   * warp_access count times.
+   *
+   * @param kernel_id kernel context id
+   * @param host_op_id kernel operation id
+   * @param access resolved lanes of a record
+   * @param count number of identical records
+   */
+  virtual void weighted_warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access,
+                                    u32 count);
+
+  /**
+   * @brief A callback for the merged ranges of every trace, called instead of warp_access if the
+   * analysis only uses ranges.
+   *
+   * @param kernel_id kernel context id
+   * @param host_op_id kernel operation id
+   * @param ranges read and write ranges of each memory object accessed by the trace
+   */
+  virtual void range_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                            const AccessRanges & /* ranges */) {}
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback) = 0;
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback) = 0;
 
  protected:
@@ -89,6 +248,41 @@ class Analysis {
   std::mutex _lock;
 };
 
+struct AnalysisSubscriber {
+  redshow_analysis_type_t type;
+  Analysis *analysis;
+
+  AnalysisSubscriber(redshow_analysis_type_t type, Analysis *analysis)
+      : type(type), analysis(analysis) {}
+};
+
+typedef Vector<AnalysisSubscriber> AnalysisSubscribers;
+
+/**
+ * @brief Subscribers of each event, built from the capabilities of the enabled analyses.
+ *
+ * Rebuilt whenever an analysis is enabled or disabled, so events are dispatched without
+ * querying capabilities or copying shared pointers.
+ */
+struct AnalysisDispatch {
+  // Indexed by GPUPatchType
+  AnalysisSubscribers traces[GPU_PATCH_TYPE_COUNT];
+  AnalysisSubscribers accesses[GPU_PATCH_TYPE_COUNT];
+  AnalysisSubscribers ranges[GPU_PATCH_TYPE_COUNT];
+  // If any access subscriber of the trace type uses values or thread ids
+  bool values[GPU_PATCH_TYPE_COUNT];
+  bool thread_ids[GPU_PATCH_TYPE_COUNT];
+  // If the trace type has access subscribers and all of them are weighted
+  bool weighted[GPU_PATCH_TYPE_COUNT];
+  AnalysisSubscribers block_exits;
+  // Indexed by OperationType
+  AnalysisSubscribers op_callbacks[OPERATION_TYPE_COUNT];
+
+  AnalysisDispatch() : values(), thread_ids(), weighted() {}
+
+  void build(const Map<redshow_analysis_type_t, std::shared_ptr<Analysis>> &analyses);
+};
+
 struct CompareView {
   bool operator()(redshow_record_view_t const &r1, redshow_record_view_t const &r2) {
     return r1.red_count > r2.red_count;
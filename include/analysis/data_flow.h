@@ -26,6 +26,8 @@ class DataFlow final : public Analysis {
 
   virtual ~DataFlow() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -40,14 +42,16 @@ class DataFlow final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void range_access(i32 kernel_id, u64 host_op_id, const AccessRanges &ranges);
+
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
  private:
@@ -108,8 +112,8 @@ class DataFlow final : public Analysis {
   typedef Graph<Index, Node, EdgeIndex, Edge> DataFlowGraph;
 
   struct DataFlowTrace final : public Trace {
-    Map<u64, Set<MemoryRange>> read_memory;
-    Map<u64, Set<MemoryRange>> write_memory;
+    Map<u64, IntervalSet> read_memory;
+    Map<u64, IntervalSet> write_memory;
 
     DataFlowTrace() = default;
 
@@ -142,8 +146,6 @@ class DataFlow final : public Analysis {
   void analyze_duplicate(Map<i32, Map<i32, bool>> &duplicate);
 
   void dump(const std::string &output_dir, const Map<i32, Map<i32, bool>> &duplicate);
-
-  void merge_memory_range(Set<MemoryRange> &memory, const MemoryRange &memory_range);
  
  private:
   enum class CopyType {
@@ -38,6 +38,8 @@ class MemoryHeatmap final : public Analysis {
 
   virtual ~MemoryHeatmap() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -52,15 +54,20 @@ class MemoryHeatmap final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access);
+
+  virtual void weighted_warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access,
+                                    u32 count);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
 
@@ -126,7 +133,17 @@ void update_op_node(u64 op_id, i32 ctx_id);
  * @brief Update heatmap list
  * 
  */
-void update_heatmap_list(u64 op_id, MemoryRange memory_range, uint32_t unit_size);
+void update_heatmap_list(u64 op_id, MemoryRange memory_range, uint32_t unit_size, int count);
+
+/**
+ * @brief Count accesses to a memory object, allocate its heatmap on the first access. Called
+ * with the analysis lock held.
+ * 
+ * @param memory 
+ * @param unit_size 
+ * @param count number of unit accesses
+ */
+void heatmap_access(const MemoryView &memory, uint32_t unit_size, int count);
 
 
 
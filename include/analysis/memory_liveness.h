@@ -42,6 +42,8 @@ public:
 
   virtual ~MemoryLiveness() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -56,15 +58,17 @@ public:
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void range_access(i32 kernel_id, u64 host_op_id, const AccessRanges &ranges);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
 /***********************************************************************
@@ -42,6 +42,8 @@ class MemoryProfile final : public Analysis {
 
   virtual ~MemoryProfile() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -56,15 +58,17 @@ class MemoryProfile final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void range_access(i32 kernel_id, u64 host_op_id, const AccessRanges &ranges);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
 
@@ -82,7 +86,7 @@ class MemoryProfile final : public Analysis {
     // here use memory range to loge access range but not allocation and sub-allocation
 
     // u64: Memory:Operation->op_id
-    Map<u64, Set<MemoryRange>> access_memory;
+    Map<u64, IntervalSet> access_memory;
 
     MemoryProfileTrace() = default;
 
@@ -175,15 +179,6 @@ Map<u32, Map<u64, Map<u64, ChunkFragmentation>>> _object_fragmentation_of_kernel
 // functions
 private:
 
-/**
- * @brief To merge access memory range in unit_access.
- * 
- * @param memory 
- * @param memory_range 
- */
-void merge_memory_range(Set<MemoryRange> &memory, const MemoryRange &memory_range);
-
-
 /**
  * @brief Kernel callback function
  * 
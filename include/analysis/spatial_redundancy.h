@@ -28,6 +28,8 @@ class SpatialRedundancy final : public Analysis {
 
   virtual ~SpatialRedundancy() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -42,15 +44,20 @@ class SpatialRedundancy final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access);
+
+  virtual void weighted_warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access,
+                                    u32 count);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
  private:
@@ -80,6 +87,8 @@ class SpatialRedundancy final : public Analysis {
   void update_spatial_trace(u64 pc, u64 value, u64 memory_op_id, AccessKind access_kind,
                             SpatialTrace &spatial_trace);
 
+  void update_spatial_trace(const WarpAccess &access, u32 count, SpatialTrace &spatial_trace);
+
   void transform_spatial_statistics(u32 cubin_id, const SymbolVector &symbols,
                                     SpatialStatistics &spatial_stats);
 
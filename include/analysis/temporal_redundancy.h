@@ -32,6 +32,8 @@ class TemporalRedundancy final : public Analysis {
 
   virtual ~TemporalRedundancy() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -46,15 +48,17 @@ class TemporalRedundancy final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
  private:
@@ -86,6 +90,9 @@ class TemporalRedundancy final : public Analysis {
   void update_temporal_trace(u64 pc, ThreadId tid, u64 addr, u64 value, AccessKind access_kind,
                              TemporalTrace &temporal_trace, PCPairs &pc_pairs);
 
+  void update_temporal_trace(const WarpAccess &access, TemporalTrace &temporal_trace,
+                             PCPairs &pc_pairs);
+
   void transform_temporal_statistics(uint32_t cubin_id, const SymbolVector &symbols,
                                      TemporalStatistics &temporal_stats);
 
@@ -0,0 +1,61 @@
+#ifndef REDSHOW_ANALYSIS_VALUE_DECODER_H
+#define REDSHOW_ANALYSIS_VALUE_DECODER_H
+
+#include "analysis/analysis.h"
+#include "binutils/instruction.h"
+#include "common/utils.h"
+#include "redshow.h"
+
+namespace redshow {
+
+/**
+ * @brief Decodes the values of a warp record into WarpAccess::values.
+ *
+ * Accesses of 8 to 64-bit units in vectors of up to 128 bits are decoded by loops specialized for
+ * the unit size and the number of units, which are selected from a table once per record. They
+ * copy the units of all lanes without branches and truncate float units with a mask. Other access
+ * kinds are decoded unit by unit with AccessKind::value_to_basic_type.
+ */
+class ValueDecoder {
+ public:
+  /**
+   * @param access_kind The kind of the whole access, vec_size is the size of all units
+   */
+  ValueDecoder(const AccessKind &access_kind, int decimal_degree_f32, int decimal_degree_f64);
+
+  /**
+   * @brief Decode the units of record, values of lanes not in warp_access.active are undefined
+   */
+  void decode(const gpu_patch_record_t *record, WarpAccess &warp_access) const {
+    _decode(*this, record, warp_access);
+  }
+
+  // If the access kind has a specialized loop
+  bool specialized() const { return _decode != decode_generic; }
+
+ private:
+  typedef void (*DecodeFunction)(const ValueDecoder &decoder, const gpu_patch_record_t *record,
+                                 WarpAccess &warp_access);
+
+  template <typename T, u32 NUM_UNITS>
+  static void decode_units(const ValueDecoder &decoder, const gpu_patch_record_t *record,
+                           WarpAccess &warp_access);
+
+  static void decode_generic(const ValueDecoder &decoder, const gpu_patch_record_t *record,
+                             WarpAccess &warp_access);
+
+  static DecodeFunction select(const AccessKind &access_kind);
+
+ private:
+  DecodeFunction _decode;
+  // Unit access kind, vec_size == unit_size
+  AccessKind _unit_kind;
+  // Valid bits of a unit
+  u64 _mask;
+  int _decimal_degree_f32;
+  int _decimal_degree_f64;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_ANALYSIS_VALUE_DECODER_H
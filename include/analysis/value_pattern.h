@@ -28,6 +28,8 @@ class ValuePattern final : public Analysis {
 
   virtual ~ValuePattern() = default;
 
+  virtual AnalysisCapabilities capabilities() const;
+
   // Coarse-grained
   virtual void op_callback(OperationPtr operation, bool is_submemory = false);
 
@@ -42,27 +44,32 @@ class ValuePattern final : public Analysis {
   virtual void block_exit(const ThreadId &thread_id);
 
   virtual void unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags);
 
+  virtual void warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access);
+
+  virtual void weighted_warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access,
+                                    u32 count);
+
   // Flush
   virtual void flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback);
 
-  virtual void flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+  virtual void flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback);
 
  private:
   struct ValueDistMemoryComp {
-    bool operator()(const Memory &l, const Memory &r) const { return l.op_id < r.op_id; }
+    bool operator()(const MemoryView &l, const MemoryView &r) const { return l.op_id < r.op_id; }
   };
 
   // <Offset, <Value, Count>>
   typedef Map<u64, u64> ValueCount;
   typedef Map<u64, ValueCount> ItemsValueCount;
-  typedef std::map<Memory, Map<AccessKind, ItemsValueCount>, ValueDistMemoryComp> ValueDist;
-  typedef std::map<Memory, Map<AccessKind, ValueCount>, ValueDistMemoryComp> ValueDistCompact;
+  typedef std::map<MemoryView, Map<AccessKind, ItemsValueCount>, ValueDistMemoryComp> ValueDist;
+  typedef std::map<MemoryView, Map<AccessKind, ValueCount>, ValueDistMemoryComp> ValueDistCompact;
 
   enum ValuePatternType {
     VP_REDUNDANT_ZEROS = 0,
@@ -90,7 +97,7 @@ class ValuePattern final : public Analysis {
 
   struct ArrayPatternInfo {
     AccessKind access_kind;
-    Memory memory;
+    MemoryView memory;
     //     <signed_leading_zero_bits, unsigned_leading_zero_bits, tail_zero_bits>
     std::tuple<int, int, int> narrow_down_to_unit_size;
     // E.g., <<10,1000>, > there are 1000 items have single value 10.
@@ -109,7 +116,7 @@ class ValuePattern final : public Analysis {
 
     uint8_t read_flag;
 
-    ArrayPatternInfo(const AccessKind &access_kind, const Memory &memory)
+    ArrayPatternInfo(const AccessKind &access_kind, const MemoryView &memory)
         : access_kind(access_kind), memory(memory) {}
   };
 
@@ -153,6 +160,8 @@ class ValuePattern final : public Analysis {
   void vp_approx_level_config(redshow_approx_level_t level, int &decimal_degree_f32,
                               int &decimal_degree_f64);
 
+  void update_value_dist(const AccessKind &access_kind, const WarpAccess &access, u32 count);
+
  private:
   static inline thread_local std::shared_ptr<ValuePatternTrace> _trace;
 };
@@ -0,0 +1,25 @@
+#ifndef REDSHOW_BENCH_PEAK_RSS_H
+#define REDSHOW_BENCH_PEAK_RSS_H
+
+#include "common/utils.h"
+
+namespace redshow {
+
+/**
+ * @brief Start a new peak resident set size measurement
+ */
+void reset_peak_rss();
+
+/**
+ * @brief Peak resident set size since the last reset, in KB
+ */
+u64 peak_rss_kb();
+
+/**
+ * @brief Bytes allocated from the heap and not freed yet, 0 if the allocator does not tell
+ */
+u64 heap_bytes();
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BENCH_PEAK_RSS_H
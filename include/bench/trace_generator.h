@@ -0,0 +1,97 @@
+#ifndef REDSHOW_BENCH_TRACE_GENERATOR_H
+#define REDSHOW_BENCH_TRACE_GENERATOR_H
+
+#include <random>
+
+#include "common/utils.h"
+#include "common/vector.h"
+#include "operation/memory.h"
+#include "redshow.h"
+#include "replay/trace_file.h"
+
+namespace redshow {
+
+// Synthetic memory objects are placed apart from each other starting at this address
+const u64 TRACE_GENERATOR_ADDRESS_START = 0x7f0000000000;
+// Synthetic kernels start at this pc, each pc is an instruction of 16 bytes
+const u64 TRACE_GENERATOR_PC_START = 0x10000;
+const u32 TRACE_GENERATOR_WARPS_PER_BLOCK = 8;
+
+enum TraceAccessPattern {
+  // Lane i accesses base + i * access_size
+  TRACE_ACCESS_COALESCED = 0,
+  // Lane i accesses base + i * stride
+  TRACE_ACCESS_STRIDED = 1,
+  // Every lane accesses a random offset of a random memory object
+  TRACE_ACCESS_RANDOM = 2,
+  // All lanes access the same address
+  TRACE_ACCESS_WARP_UNIFORM = 3,
+  TRACE_ACCESS_COUNT = 4
+};
+
+enum TraceValueRedundancy {
+  // Random values
+  TRACE_VALUE_LOW = 0,
+  // All lanes of a pc load or store the same value
+  TRACE_VALUE_HIGH = 1,
+  TRACE_VALUE_COUNT = 2
+};
+
+struct TraceGeneratorConfig {
+  GPUPatchType type = GPU_PATCH_TYPE_DEFAULT;
+  TraceAccessPattern pattern = TRACE_ACCESS_COALESCED;
+  TraceValueRedundancy redundancy = TRACE_VALUE_LOW;
+  u32 num_records = 4096;
+  u32 num_memories = 16;
+  u64 memory_size = 1 << 20;
+  // Bytes accessed by each lane, at most GPU_PATCH_MAX_ACCESS_SIZE
+  u32 access_size = 4;
+  u32 stride = 128;
+  u32 num_pcs = 64;
+  u32 active = 0xFFFFFFFF;
+  // Identical default records in a row, like iterations of a polling loop
+  u32 repeats = 1;
+  u64 seed = 0;
+};
+
+const char *trace_access_pattern_name(TraceAccessPattern pattern);
+
+const char *trace_value_redundancy_name(TraceValueRedundancy redundancy);
+
+/**
+ * @brief Generates gpu_patch_buffer_t traces that look like those of a sanitizer patched kernel
+ *
+ * Addresses of every record fall into memories(), which must be registered before analysis.
+ */
+class TraceGenerator {
+ public:
+  explicit TraceGenerator(const TraceGeneratorConfig &config);
+
+  const TraceGeneratorConfig &config() const { return _config; }
+
+  // Device ranges of the synthetic memory objects
+  const Vector<MemoryRange> &memories() const { return _memories; }
+
+  /**
+   * @brief Fill trace_buffer with config().num_records records of config().type
+   */
+  void generate(TraceBuffer &trace_buffer);
+
+ private:
+  u64 lane_address(u32 record, u32 lane);
+
+  void generate_default(gpu_patch_record_t *records);
+
+  void generate_address_patch(gpu_patch_record_address_t *records);
+
+  void generate_address_analysis(gpu_patch_analysis_address_t *records);
+
+ private:
+  TraceGeneratorConfig _config;
+  Vector<MemoryRange> _memories;
+  std::mt19937_64 _rng;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BENCH_TRACE_GENERATOR_H
@@ -0,0 +1,92 @@
+#ifndef REDSHOW_BINUTILS_ACCESS_KIND_TABLE_H
+#define REDSHOW_BINUTILS_ACCESS_KIND_TABLE_H
+
+#include "binutils/instruction.h"
+#include "binutils/symbol.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+struct PackedAccessKind {
+  u8 vec_size;
+  u8 unit_size;
+  u8 data_type;
+  u8 valid;
+
+  PackedAccessKind() : vec_size(0), unit_size(0), data_type(REDSHOW_DATA_UNKNOWN), valid(0) {}
+
+  AccessKind unpack() const {
+    return AccessKind(unit_size, vec_size, static_cast<redshow_data_type_t>(data_type));
+  }
+};
+
+struct AccessKindSlot {
+  PackedAccessKind access_kind;
+  u32 function_index;
+
+  AccessKindSlot() : function_index(0) {}
+};
+
+/**
+ * @brief Access kinds of a cubin's memory instructions, indexed by instruction slot.
+ *
+ * SASS instructions are fixed-width, so a cubin offset maps to a slot with a subtraction and a
+ * shift instead of a lookup in the instruction graph.
+ */
+class AccessKindTable {
+ public:
+  AccessKindTable() = default;
+
+  /**
+   * @brief Build the table from an analyzed instruction graph
+   *
+   * @param inst_graph instructions with access kinds
+   * @param symbols function index and cubin offset of each function
+   */
+  void build(const InstructionGraph &inst_graph, const SymbolVector &symbols);
+
+  /**
+   * @brief Restore a table from its fields, e.g., loaded from the instruction cache
+   */
+  void assign(u64 start, u32 shift, const AccessKindSlot *slots, size_t num_slots) {
+    _start = start;
+    _shift = shift;
+    _slots.assign(slots, slots + num_slots);
+  }
+
+  bool empty() const { return _slots.empty(); }
+
+  u64 start() const { return _start; }
+
+  u32 shift() const { return _shift; }
+
+  const Vector<AccessKindSlot> &slots() const { return _slots; }
+
+  // Bytes per instruction slot
+  u64 slot_size() const { return 1ul << _shift; }
+
+  /**
+   * @brief Get the slot of a memory instruction, NULL if it is not a memory instruction or its
+   * access kind is unknown
+   */
+  const AccessKindSlot *lookup(u64 cubin_offset) const {
+    if (cubin_offset < _start) {
+      return NULL;
+    }
+    auto index = (cubin_offset - _start) >> _shift;
+    if (index >= _slots.size() || _slots[index].access_kind.valid == 0) {
+      return NULL;
+    }
+    return &_slots[index];
+  }
+
+ private:
+  u64 _start = 0;
+  u32 _shift = 0;
+  Vector<AccessKindSlot> _slots;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BINUTILS_ACCESS_KIND_TABLE_H
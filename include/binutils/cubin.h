@@ -4,10 +4,13 @@
 #include <memory>
 #include <string>
 
+#include "binutils/access_kind_table.h"
 #include "common/map.h"
+#include "common/rcu.h"
 #include "common/utils.h"
 #include "common/vector.h"
 #include "instruction.h"
+#include "redshow.h"
 #include "symbol.h"
 
 namespace redshow {
@@ -17,12 +20,36 @@ struct Cubin {
   std::string path;
   // <mod_id, [symbols]>
   Map<u32, SymbolVector> symbols;
-  InstructionGraph inst_graph;
+  // Shared by cubins with identical instruction files, empty if loaded from the instruction cache
+  std::shared_ptr<const InstructionGraph> inst_graph;
+  // Access kinds of inst_graph indexed by cubin offset
+  std::shared_ptr<const AccessKindTable> access_kinds;
 
   Cubin() = default;
 
-  Cubin(u32 cubin_id, const std::string &path, InstructionGraph &inst_graph)
-      : cubin_id(cubin_id), path(path), inst_graph(inst_graph) {}
+  Cubin(u32 cubin_id, const std::string &path,
+        std::shared_ptr<const InstructionGraph> inst_graph)
+      : cubin_id(cubin_id), path(path), inst_graph(std::move(inst_graph)) {}
+};
+
+// Parse results of an instruction file, shared by all the modules of a cubin
+struct CubinParse {
+  redshow_result_t result = REDSHOW_SUCCESS;
+  // Function indices and cubin offsets, pcs are assigned per module
+  SymbolVector symbols;
+  std::shared_ptr<const InstructionGraph> inst_graph;
+  std::shared_ptr<const AccessKindTable> access_kinds;
+
+  CubinParse() = default;
+
+  CubinParse(u32 nsymbols) : symbols(nsymbols) {}
+};
+
+// Parse results kept for cubins with the same instruction file, released with the last cubin
+struct SharedCubinParse {
+  SymbolVector symbols;
+  std::weak_ptr<const InstructionGraph> inst_graph;
+  std::weak_ptr<const AccessKindTable> access_kinds;
 };
 
 struct CubinCache {
@@ -38,6 +65,12 @@ struct CubinCache {
   CubinCache(u32 cubin_id, const std::string &path) : cubin_id(cubin_id), path(path), nsymbols(0) {}
 };
 
+// <cubin_id, cubin>
+typedef RcuMap<u32, Cubin> CubinMap;
+
+// <cubin_id, cubin cache>
+typedef RcuMap<u32, CubinCache> CubinCacheMap;
+
 }  // namespace redshow
 
 #endif  // REDSHOW_BINUTILS_CUBIN_H
@@ -0,0 +1,113 @@
+#ifndef REDSHOW_BINUTILS_CUBIN_PREFETCHER_H
+#define REDSHOW_BINUTILS_CUBIN_PREFETCHER_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "binutils/cubin.h"
+#include "common/map.h"
+#include "common/set.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+/**
+ * @brief Background parsing of cached cubins before their first kernel is analyzed.
+ *
+ * Cubins listed in the hint file of a previous run are parsed first, in the order they were
+ * used, followed by the most recently submitted ones. A cubin that no worker has started yet is
+ * parsed by the thread that needs it.
+ */
+class CubinPrefetcher {
+ public:
+  typedef std::function<void(const std::string &path, CubinParse &parse)> Parse;
+
+  CubinPrefetcher() = default;
+
+  ~CubinPrefetcher() { stop(); }
+
+  /**
+   * @brief Spawn num_workers threads, no-op if the prefetcher is running
+   */
+  void start(u32 num_workers, Parse parse);
+
+  /**
+   * @brief Join the workers after their current parses, queued cubins are left to take()
+   */
+  void stop();
+
+  bool running() const;
+
+  /**
+   * @brief Read the cubin paths used by a previous run, one per line
+   */
+  void load_hints(const std::string &file_name);
+
+  /**
+   * @brief Write the cubin paths taken by this run, followed by the unused hints
+   */
+  void store_hints(const std::string &file_name);
+
+  /**
+   * @brief Queue a cubin, no-op if it was submitted before or the prefetcher is not running
+   */
+  void submit(u32 cubin_id, u32 nsymbols, const std::string &path);
+
+  /**
+   * @brief Parse results of cubin_id, waits only if a worker is still parsing it
+   *
+   * @return NULL if cubin_id was not submitted
+   */
+  std::shared_ptr<CubinParse> take(u32 cubin_id);
+
+  /**
+   * @brief Forget cubin_id, its parse results may have been moved out
+   */
+  void erase(u32 cubin_id);
+
+ private:
+  enum TaskState { TASK_QUEUED = 0, TASK_RUNNING = 1, TASK_DONE = 2 };
+
+  struct Task {
+    std::string path;
+    // Position in _queue
+    std::pair<u64, u32> priority;
+    TaskState state = TASK_QUEUED;
+    std::shared_ptr<CubinParse> parse;
+  };
+
+  void work();
+
+  // Parse with _lock held on entry and exit
+  void run(std::unique_lock<std::mutex> &lock, Task &task);
+
+ private:
+  Vector<std::thread> _workers;
+  mutable std::mutex _lock;
+  std::condition_variable _ready;
+  // Signaled when a parse finishes
+  std::condition_variable _done;
+  Parse _parse;
+  // <cubin_id, task>
+  Map<u32, std::shared_ptr<Task>> _tasks;
+  // <priority, cubin_id>, the smallest first
+  Set<std::pair<u64, u32>> _queue;
+  // <path, rank in the hint file>
+  Map<std::string, u64> _hints;
+  Vector<std::string> _hint_paths;
+  // Paths in the order of the first take
+  Vector<std::string> _used;
+  Set<std::string> _used_paths;
+  u64 _submitted = 0;
+  bool _running = false;
+  bool _stopping = false;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BINUTILS_CUBIN_PREFETCHER_H
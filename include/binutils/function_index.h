@@ -0,0 +1,162 @@
+#ifndef REDSHOW_BINUTILS_FUNCTION_INDEX_H
+#define REDSHOW_BINUTILS_FUNCTION_INDEX_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#include "binutils/access_kind_table.h"
+#include "binutils/real_pc.h"
+#include "binutils/symbol.h"
+#include "common/map.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+// A function of a loaded module, it spans from pc to the next function of any module
+struct FunctionInterval {
+  // pc in memory at runtime
+  u64 pc;
+  // offset in the cubin
+  u64 offset;
+  u32 cubin_id;
+  u32 mod_id;
+  u32 function_index;
+  // Owned by the snapshot
+  const AccessKindTable *access_kinds;
+
+  RealPC real_pc(u64 pc) const {
+    RealPC real_pc(cubin_id, function_index, pc - this->pc);
+    real_pc.cubin_offset = real_pc.pc_offset + offset;
+    return real_pc;
+  }
+};
+
+/**
+ * @brief Immutable view of all the functions loaded at some point.
+ */
+class FunctionSnapshot {
+ public:
+  FunctionSnapshot() = default;
+
+  /**
+   * @brief Find the function that contains pc
+   *
+   * @param pc pc in memory at runtime
+   * @param end set to the pc of the next function, callers can reuse the result for pcs below it
+   * @return the function, NULL if pc is before the first function
+   */
+  const FunctionInterval *lookup(u64 pc, u64 &end) const {
+    return lookup(_intervals, pc, end);
+  }
+
+  /**
+   * @brief Find the function of module mod_id of cubin_id that contains pc
+   *
+   * Same as lookup(pc, end) unless modules overlap, e.g., a stale module that was not unregistered
+   */
+  const FunctionInterval *lookup(u32 cubin_id, u32 mod_id, u64 pc, u64 &end) const;
+
+  std::optional<RealPC> transform_pc(u64 pc) const {
+    u64 end = 0;
+    auto *interval = lookup(pc, end);
+    if (interval == NULL) {
+      return {};
+    }
+    return interval->real_pc(pc);
+  }
+
+  /**
+   * @brief If module mod_id of cubin_id is loaded
+   */
+  bool has(u32 cubin_id, u32 mod_id) const { return module(cubin_id, mod_id) != NULL; }
+
+  size_t size() const { return _intervals.size(); }
+
+ private:
+  friend class FunctionIndex;
+
+  struct Module {
+    u32 cubin_id;
+    u32 mod_id;
+    // Sorted by pc
+    Vector<FunctionInterval> intervals;
+    std::shared_ptr<const AccessKindTable> access_kinds;
+  };
+
+  static const FunctionInterval *lookup(const Vector<FunctionInterval> &intervals, u64 pc,
+                                        u64 &end);
+
+  const Module *module(u32 cubin_id, u32 mod_id) const;
+
+ private:
+  // Functions of all the modules sorted by pc
+  Vector<FunctionInterval> _intervals;
+  // Sorted by <cubin_id, mod_id>
+  Vector<Module> _modules;
+};
+
+/**
+ * @brief Functions of all the loaded modules indexed by runtime pc.
+ *
+ * Updates copy the current snapshot and publish a new one. Readers keep a per-thread reference
+ * to the latest snapshot and only take the lock once after each update, so analysis threads do
+ * not contend with each other or with the cubin map. A thread holds on to its snapshot until its
+ * next snapshot() call or its exit, so each thread keeps at most one stale snapshot alive, with the
+ * AccessKindTables of the modules erased after it. Analysis threads refresh it with every trace.
+ */
+class FunctionIndex {
+ public:
+  FunctionIndex() : _snapshot(std::make_shared<FunctionSnapshot>()) {}
+
+  /**
+   * @brief Add the functions of module mod_id of cubin_id, replacing the module's old functions
+   *
+   * @param symbols function indices, cubin offsets, and runtime pcs of the module
+   * @param access_kinds access kinds of the cubin, kept alive by snapshots that refer to them
+   */
+  void insert(u32 cubin_id, u32 mod_id, const SymbolVector &symbols,
+              std::shared_ptr<const AccessKindTable> access_kinds);
+
+  /**
+   * @brief Remove the functions of module mod_id of cubin_id
+   */
+  void erase(u32 cubin_id, u32 mod_id);
+
+  /**
+   * @brief The latest snapshot, lock free unless the index was updated since the thread's last call
+   *
+   * The returned snapshot is also cached by the calling thread until its next call.
+   */
+  std::shared_ptr<const FunctionSnapshot> snapshot() const;
+
+ private:
+  struct Module {
+    SymbolVector symbols;
+    std::shared_ptr<const AccessKindTable> access_kinds;
+  };
+
+  /**
+   * @brief Publish a snapshot with module mod_id of cubin_id replaced, with _lock held
+   *
+   * Merges the module's functions into the functions of the current snapshot, O(functions).
+   *
+   * @param module new functions of the module, NULL if it was erased
+   */
+  void publish(u32 cubin_id, u32 mod_id, const Module *module);
+
+ private:
+  // <<cubin_id, mod_id>, module>
+  Map<std::pair<u32, u32>, Module> _modules;
+  std::shared_ptr<const FunctionSnapshot> _snapshot;
+  // Incremented by each publish
+  std::atomic<u64> _version{1};
+  mutable std::mutex _lock;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BINUTILS_FUNCTION_INDEX_H
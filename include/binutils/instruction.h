@@ -55,6 +55,45 @@ struct AccessKind {
   }
 };
 
+/*
+ * Opcode tokens used by access kind inference, e.g., MEMORY.LOAD.GLOBAL.64.
+ * A flag is set if its token appears anywhere in the opcode.
+ */
+enum InstructionOpFlag : u32 {
+  // Class
+  INSTRUCTION_OP_MEMORY = 1u << 0,
+  INSTRUCTION_OP_INTEGER = 1u << 1,
+  INSTRUCTION_OP_FLOAT = 1u << 2,
+  INSTRUCTION_OP_CONVERT = 1u << 3,
+  INSTRUCTION_OP_MOVE = 1u << 4,
+  INSTRUCTION_OP_UNIFORM = 1u << 5,
+  // Memory direction, "STORE" and ".STORE"
+  INSTRUCTION_OP_ANY_STORE = 1u << 6,
+  INSTRUCTION_OP_STORE = 1u << 7,
+  INSTRUCTION_OP_LOAD = 1u << 8,
+  // Memory space
+  INSTRUCTION_OP_SHARED = 1u << 9,
+  INSTRUCTION_OP_LOCAL = 1u << 10,
+  // Width
+  INSTRUCTION_OP_128 = 1u << 11,
+  INSTRUCTION_OP_64 = 1u << 12,
+  INSTRUCTION_OP_32 = 1u << 13,
+  INSTRUCTION_OP_16 = 1u << 14,
+  INSTRUCTION_OP_8 = 1u << 15,
+  // Conversion
+  INSTRUCTION_OP_I2F = 1u << 16,
+  INSTRUCTION_OP_F2F = 1u << 17,
+  INSTRUCTION_OP_F2I = 1u << 18,
+  INSTRUCTION_OP_I2I = 1u << 19,
+  INSTRUCTION_OP_64_TO_32 = 1u << 20,
+  INSTRUCTION_OP_32_TO_64 = 1u << 21
+};
+
+/**
+ * @brief Decode the InstructionOpFlags of an opcode
+ */
+u32 instruction_op_flags(const std::string &op);
+
 /*
  * A copy-paste struct from hpctoolkit
  */
@@ -70,6 +109,8 @@ struct Instruction {
   std::map<int, std::vector<int> > assign_pcs;
   std::map<int, std::vector<int> > uassign_pcs;
   std::shared_ptr<AccessKind> access_kind;
+  // InstructionOpFlags of op
+  u32 op_flags;
 
   // legacy interface
   Instruction(const std::string &op, unsigned int pc, int predicate, std::vector<int> &dsts,
@@ -80,7 +121,8 @@ struct Instruction {
         dsts(dsts),
         srcs(srcs),
         assign_pcs(assign_pcs),
-        access_kind(NULL) {}
+        access_kind(NULL),
+        op_flags(instruction_op_flags(op)) {}
 
   Instruction(const std::string &op, unsigned int pc, int predicate, std::vector<int> &dsts,
               std::vector<int> &srcs, std::vector<int> &udsts, std::vector<int> &usrcs,
@@ -95,9 +137,10 @@ struct Instruction {
         usrcs(usrcs),
         assign_pcs(assign_pcs),
         uassign_pcs(uassign_pcs),
-        access_kind(NULL) {}
+        access_kind(NULL),
+        op_flags(instruction_op_flags(op)) {}
 
-  Instruction() : access_kind(NULL) {}
+  Instruction() : access_kind(NULL), op_flags(0) {}
 
   bool operator<(const Instruction &other) const { return this->pc < other.pc; }
 };
@@ -130,6 +173,13 @@ typedef Graph<u64, Instruction, InstructionDependencyIndex, InstructionDependenc
 
 class SymbolVector;
 
+enum InstructionReaderMode {
+  // Streaming reader, falls back to the tree reader on unexpected input
+  INSTRUCTION_READER_STREAM = 0,
+  // boost::property_tree
+  INSTRUCTION_READER_TREE = 1
+};
+
 class InstructionParser {
  public:
   InstructionParser() = default;
@@ -139,16 +189,24 @@ class InstructionParser {
    * @param file_path
    * @param symbols
    * @param graph
+   * @param mode how the instruction file is read
    * @return true
    * @return false
    */
-  static bool parse(const std::string &file_path, SymbolVector &symbols, InstructionGraph &graph);
+  static bool parse(const std::string &file_path, SymbolVector &symbols, InstructionGraph &graph,
+                    InstructionReaderMode mode = INSTRUCTION_READER_STREAM);
 
- private:
-  static void default_access_kind(Instruction &inst);
+  /**
+   * @brief Infer the access kinds of memory instructions that do not have one
+   *
+   * @param symbols
+   * @param inst_graph a graph with dependencies, preferably frozen
+   */
+  static void infer_access_kinds(const SymbolVector &symbols, InstructionGraph &inst_graph);
 
-  static AccessKind init_access_kind(Instruction &inst, InstructionGraph &inst_graph,
-                                     std::set<unsigned int> &visited, bool load);
+ private:
+  static void read_tree(const std::string &file_path, SymbolVector &symbols,
+                        InstructionGraph &inst_graph);
 };
 
 }  // namespace redshow
@@ -0,0 +1,73 @@
+#ifndef REDSHOW_BINUTILS_INSTRUCTION_CACHE_H
+#define REDSHOW_BINUTILS_INSTRUCTION_CACHE_H
+
+#include <string>
+
+#include "binutils/access_kind_table.h"
+#include "binutils/instruction.h"
+#include "binutils/symbol.h"
+#include "common/utils.h"
+
+namespace redshow {
+
+/*
+ * Cache file layout (native endianness), named <key>.inst.bin:
+ *
+ * header:  magic[8] version:u32 reserved:u32
+ * symbols: count:u64 [index:u32 offset:u64]...
+ * table:   start:u64 shift:u32 count:u64 [AccessKindSlot]...
+ *
+ * Sections needed by trace analysis come first, the instruction graph follows:
+ *
+ * insts:   count:u64 [pc:u32 predicate:i32 op access_kind dsts srcs udsts usrcs assign_pcs
+ *          uassign_pcs]...
+ * edges:   count:u64 [from:u64 to:u64 inter_function:u8]...
+ *
+ * Strings and register lists are prefixed by a u32 length. access_kind is
+ * valid:u8 vec_size:u32 unit_size:u32 data_type:u32.
+ */
+const char INSTRUCTION_CACHE_MAGIC[8] = {'R', 'S', 'I', 'N', 'S', 'T', '\0', '\0'};
+// Bump on any change of the layout or of the access kind inference
+const u32 INSTRUCTION_CACHE_VERSION = 1;
+
+/**
+ * @brief Parsed instruction files saved across processes.
+ *
+ * Instruction files of the same cubin are identical between runs, so a cache entry is keyed by
+ * the content of the instruction file and never invalidated.
+ */
+class InstructionCache {
+ public:
+  /**
+   * @brief Key of an instruction file, the hash and size of its content and the default data type
+   *
+   * @return empty if the file cannot be read
+   */
+  static std::string key(const std::string &inst_path);
+
+  /**
+   * @brief Load the parsed results of an instruction file
+   *
+   * @param cache_dir
+   * @param key returned by key()
+   * @param symbols index and cubin offset of each function
+   * @param access_kinds
+   * @param inst_graph instructions, dependencies, and access kinds. Rebuilding the graph costs
+   * about as much as parsing, so it is skipped if NULL.
+   * @return false if there is no valid entry, outputs are unspecified then
+   */
+  static bool load(const std::string &cache_dir, const std::string &key, SymbolVector &symbols,
+                   AccessKindTable &access_kinds, InstructionGraph *inst_graph = NULL);
+
+  /**
+   * @brief Save the parsed results of an instruction file, concurrent processes may store the
+   * same key
+   */
+  static bool store(const std::string &cache_dir, const std::string &key,
+                    const SymbolVector &symbols, const InstructionGraph &inst_graph,
+                    const AccessKindTable &access_kinds);
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BINUTILS_INSTRUCTION_CACHE_H
@@ -0,0 +1,35 @@
+#ifndef REDSHOW_BINUTILS_INSTRUCTION_READER_H
+#define REDSHOW_BINUTILS_INSTRUCTION_READER_H
+
+#include <string>
+
+#include "binutils/instruction.h"
+#include "binutils/symbol.h"
+#include "common/utils.h"
+
+namespace redshow {
+
+/**
+ * @brief Single pass reader of instruction files.
+ *
+ * The file is mapped into memory and scanned once. Instructions are built directly from the
+ * mapped bytes without an intermediate tree. Only the layout written by hpcstruct is
+ * recognized, unknown members are skipped.
+ */
+class InstructionReader {
+ public:
+  /**
+   * @brief Read functions and instructions of an instruction file
+   *
+   * @param file_path
+   * @param symbols index and cubin offset of each function
+   * @param inst_graph instruction nodes without dependencies
+   * @return false if the file cannot be mapped or does not follow the expected layout
+   */
+  static bool read(const std::string &file_path, SymbolVector &symbols,
+                   InstructionGraph &inst_graph);
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_BINUTILS_INSTRUCTION_READER_H
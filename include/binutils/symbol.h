@@ -61,6 +61,24 @@ class SymbolVector : public Vector<Symbol> {
     return real_pc;
   }
 
+  /**
+   * @brief Find the symbol that contains pc
+   *
+   * @param pc pc in memory at runtime
+   * @param end set to the pc of the next symbol, callers can reuse the result for pcs below it
+   * @return the symbol, NULL if pc is before the first symbol
+   */
+  const Symbol *lookup(uint64_t pc, uint64_t &end) const {
+    auto symbols_iter = std::upper_bound(this->begin(), this->end(), Symbol(pc));
+
+    if (symbols_iter == this->begin()) {
+      return NULL;
+    }
+
+    end = symbols_iter == this->end() ? UINT64_MAX : symbols_iter->pc;
+    return &*(symbols_iter - 1);
+  }
+
   void transform_data_views(redshow_record_data_t &record_data) const {
     // Transform pcs
     for (auto i = 0; i < record_data.num_views; ++i) {
@@ -1,11 +1,71 @@
 #ifndef REDSHOW_COMMON_GRAPH_H
 #define REDSHOW_COMMON_GRAPH_H
 
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
 #include "common/map.h"
 #include "common/set.h"
+#include "common/vector.h"
 
 namespace redshow {
 
+/*
+ * Iterates the tree containers of a graph or the arrays of a frozen graph
+ */
+template <typename Value, typename TreeIterator>
+class GraphIterator {
+ public:
+  typedef std::forward_iterator_tag iterator_category;
+  typedef Value value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef Value *pointer;
+  typedef Value &reference;
+
+ public:
+  GraphIterator() = default;
+
+  explicit GraphIterator(TreeIterator iter) : _iter(iter) {}
+
+  explicit GraphIterator(Value *ptr) : _ptr(ptr) {}
+
+  reference operator*() const { return _ptr != NULL ? *_ptr : *_iter; }
+
+  pointer operator->() const { return &(**this); }
+
+  GraphIterator &operator++() {
+    if (_ptr != NULL) {
+      ++_ptr;
+    } else {
+      ++_iter;
+    }
+    return *this;
+  }
+
+  GraphIterator operator++(int) {
+    auto iter = *this;
+    ++(*this);
+    return iter;
+  }
+
+  bool operator==(const GraphIterator &other) const {
+    return _ptr == other._ptr && (_ptr != NULL || _iter == other._iter);
+  }
+
+  bool operator!=(const GraphIterator &other) const { return !(*this == other); }
+
+ private:
+  TreeIterator _iter;
+  Value *_ptr = NULL;
+};
+
+/*
+ * A graph is built with tree containers. Once it is only traversed, freeze() moves nodes, edges,
+ * and neighbor edges into sorted arrays (compressed sparse row). The same methods work in both
+ * layouts. Modifying a frozen graph thaws it first, so freeze it again once it is rebuilt.
+ */
 template <typename Index, typename Node, typename EdgeIndex, typename Edge>
 class Graph {
  public:
@@ -13,44 +73,129 @@ class Graph {
   typedef Map<EdgeIndex, Edge> EdgeMap;
   typedef Map<Index, Node> NodeMap;
 
+  typedef GraphIterator<typename NodeMap::value_type, typename NodeMap::iterator> NodeIterator;
+  typedef GraphIterator<const typename NodeMap::value_type, typename NodeMap::const_iterator>
+      ConstNodeIterator;
+  typedef GraphIterator<typename EdgeMap::value_type, typename EdgeMap::iterator> EdgeIterator;
+  typedef GraphIterator<const typename EdgeMap::value_type, typename EdgeMap::const_iterator>
+      ConstEdgeIterator;
+
+  /*
+   * Incoming or outgoing edges of a node
+   */
+  class NeighborEdges {
+   public:
+    typedef GraphIterator<const EdgeIndex, typename Set<EdgeIndex>::const_iterator>
+        const_iterator;
+    typedef const_iterator iterator;
+
+   public:
+    NeighborEdges() = default;
+
+    explicit NeighborEdges(const Set<EdgeIndex> &edges)
+        : _begin(edges.begin()), _end(edges.end()), _size(edges.size()) {}
+
+    NeighborEdges(const EdgeIndex *begin, const EdgeIndex *end)
+        : _begin(begin), _end(end), _size(end - begin) {}
+
+    const_iterator begin() const { return _begin; }
+
+    const_iterator end() const { return _end; }
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+   private:
+    const_iterator _begin;
+    const_iterator _end;
+    size_t _size = 0;
+  };
+
  public:
   Graph() {}
 
-  typename NodeMap::iterator nodes_begin() { return _nodes.begin(); }
+  NodeIterator nodes_begin() {
+    return _frozen ? NodeIterator(_frozen_nodes.data()) : NodeIterator(_nodes.begin());
+  }
 
-  typename NodeMap::iterator nodes_end() { return _nodes.end(); }
+  NodeIterator nodes_end() {
+    return _frozen ? NodeIterator(_frozen_nodes.data() + _frozen_nodes.size())
+                   : NodeIterator(_nodes.end());
+  }
 
-  typename EdgeMap::iterator edges_begin() { return _edges.begin(); }
+  ConstNodeIterator nodes_begin() const {
+    return _frozen ? ConstNodeIterator(_frozen_nodes.data()) : ConstNodeIterator(_nodes.begin());
+  }
+
+  ConstNodeIterator nodes_end() const {
+    return _frozen ? ConstNodeIterator(_frozen_nodes.data() + _frozen_nodes.size())
+                   : ConstNodeIterator(_nodes.end());
+  }
+
+  EdgeIterator edges_begin() {
+    return _frozen ? EdgeIterator(_frozen_edges.data()) : EdgeIterator(_edges.begin());
+  }
 
-  typename EdgeMap::iterator edges_end() { return _edges.end(); }
+  EdgeIterator edges_end() {
+    return _frozen ? EdgeIterator(_frozen_edges.data() + _frozen_edges.size())
+                   : EdgeIterator(_edges.end());
+  }
+
+  ConstEdgeIterator edges_begin() const {
+    return _frozen ? ConstEdgeIterator(_frozen_edges.data()) : ConstEdgeIterator(_edges.begin());
+  }
+
+  ConstEdgeIterator edges_end() const {
+    return _frozen ? ConstEdgeIterator(_frozen_edges.data() + _frozen_edges.size())
+                   : ConstEdgeIterator(_edges.end());
+  }
 
   size_t outgoing_edge_size(const Index &index) const noexcept {
+    if (_frozen) {
+      return _frozen_outgoing_edges.edges(index).size();
+    }
     if (_outgoing_edges.find(index) == _outgoing_edges.end()) {
       return 0;
     }
     return _outgoing_edges.at(index).size();
   }
 
-  const Set<EdgeIndex> &outgoing_edges(const Index &index) const noexcept {
-    return _outgoing_edges.at(index);
+  NeighborEdges outgoing_edges(const Index &index) const noexcept {
+    if (_frozen) {
+      return _frozen_outgoing_edges.edges(index);
+    }
+    return NeighborEdges(_outgoing_edges.at(index));
   }
 
   size_t incoming_edge_size(const Index &index) const noexcept {
+    if (_frozen) {
+      return _frozen_incoming_edges.edges(index).size();
+    }
     if (_incoming_edges.find(index) == _incoming_edges.end()) {
       return 0;
     }
     return _incoming_edges.at(index).size();
   }
 
-  const Set<EdgeIndex> &incoming_edges(const Index &index) const noexcept {
-    return _incoming_edges.at(index);
+  NeighborEdges incoming_edges(const Index &index) const noexcept {
+    if (_frozen) {
+      return _frozen_incoming_edges.edges(index);
+    }
+    return NeighborEdges(_incoming_edges.at(index));
   }
 
   // Edge methods
-  bool has_edge(const EdgeIndex &edge_index) const noexcept { return _edges.has(edge_index); }
+  bool has_edge(const EdgeIndex &edge_index) const noexcept {
+    if (_frozen) {
+      return frozen_find(_frozen_edges, edge_index) != NULL;
+    }
+    return _edges.has(edge_index);
+  }
 
   template <typename... Args>
   void add_edge(EdgeIndex &&edge_index, Args &&... edge) noexcept {
+    thaw();
     typename EdgeMap::iterator iter;
     bool inserted;
     std::tie(iter, inserted) =
@@ -63,6 +208,7 @@ class Graph {
 
   template <typename... Args>
   void add_edge(const EdgeIndex &edge_index, Args &&... edge) noexcept {
+    thaw();
     typename EdgeMap::iterator iter;
     bool inserted;
     std::tie(iter, inserted) =
@@ -74,43 +220,170 @@ class Graph {
   }
 
   void remove_edge(const EdgeIndex &edge_index) {
+    thaw();
     _incoming_edges[edge_index.to].erase(edge_index);
     _outgoing_edges[edge_index.from].erase(edge_index);
     _edges.erase(edge_index);
   }
 
   // Node methods
-  bool has_node(const Index &index) const noexcept { return _nodes.find(index) != _nodes.end(); }
+  bool has_node(const Index &index) const noexcept {
+    if (_frozen) {
+      return frozen_find(_frozen_nodes, index) != NULL;
+    }
+    return _nodes.find(index) != _nodes.end();
+  }
 
   template <typename... Args>
   void add_node(Index &&index, Args &&... args) noexcept {
+    thaw();
     _nodes.try_emplace(std::forward<Index>(index), std::forward<Args>(args)...);
   }
 
   template <typename... Args>
   void add_node(const Index &index, Args &&... args) noexcept {
+    thaw();
     _nodes.try_emplace(index, std::forward<Args>(args)...);
   }
 
-  void remove_node(const Index &index) { _nodes.erase(index); }
+  void remove_node(const Index &index) {
+    thaw();
+    _nodes.erase(index);
+  }
 
-  Edge &edge(const EdgeIndex &edge_index) noexcept { return _edges.at(edge_index); }
+  Edge &edge(const EdgeIndex &edge_index) noexcept {
+    return _frozen ? frozen_at(_frozen_edges, edge_index).second : _edges.at(edge_index);
+  }
 
-  Edge &edge(const EdgeIndex &edge_index) const noexcept { return _edges.at(edge_index); }
+  Edge &edge(const EdgeIndex &edge_index) const noexcept {
+    return _frozen ? frozen_at(_frozen_edges, edge_index).second : _edges.at(edge_index);
+  }
 
-  Node &node(const Index &index) noexcept { return _nodes.at(index); }
+  Node &node(const Index &index) noexcept {
+    return _frozen ? frozen_at(_frozen_nodes, index).second : _nodes.at(index);
+  }
+
+  Node &node(const Index &index) const noexcept {
+    return _frozen ? frozen_at(_frozen_nodes, index).second : _nodes.at(index);
+  }
+
+  size_t size() const noexcept { return _frozen ? _frozen_nodes.size() : _nodes.size(); }
+
+  size_t edge_size() const noexcept { return _frozen ? _frozen_edges.size() : _edges.size(); }
 
-  Node &node(const Index &index) const noexcept { return _nodes.at(index); }
+  bool frozen() const noexcept { return _frozen; }
 
-  size_t size() const noexcept { return _nodes.size(); }
+  /**
+   * @brief Move the graph into arrays, the order of nodes, edges, and neighbor edges is kept
+   */
+  void freeze() {
+    if (_frozen) {
+      return;
+    }
 
-  size_t edge_size() const noexcept { return _edges.size(); }
+    _frozen_nodes.reserve(_nodes.size());
+    for (auto &iter : _nodes) {
+      _frozen_nodes.emplace_back(iter.first, std::move(iter.second));
+    }
+    _frozen_edges.reserve(_edges.size());
+    for (auto &iter : _edges) {
+      _frozen_edges.emplace_back(iter.first, std::move(iter.second));
+    }
+    _frozen_incoming_edges.build(_incoming_edges, _edges.size());
+    _frozen_outgoing_edges.build(_outgoing_edges, _edges.size());
+
+    _nodes = NodeMap();
+    _edges = EdgeMap();
+    _incoming_edges = NeighborEdgeMap();
+    _outgoing_edges = NeighborEdgeMap();
+    _frozen = true;
+  }
+
+  /**
+   * @brief Move a frozen graph back into tree containers
+   */
+  void thaw() {
+    if (!_frozen) {
+      return;
+    }
+
+    _frozen = false;
+    for (auto &iter : _frozen_nodes) {
+      _nodes.emplace_hint(_nodes.end(), iter.first, std::move(iter.second));
+    }
+    for (auto &iter : _frozen_edges) {
+      add_edge(EdgeIndex(iter.first), std::move(iter.second));
+    }
+
+    _frozen_nodes = Vector<typename NodeMap::value_type>();
+    _frozen_edges = Vector<typename EdgeMap::value_type>();
+    _frozen_incoming_edges = FrozenNeighborEdges();
+    _frozen_outgoing_edges = FrozenNeighborEdges();
+  }
+
+ private:
+  // Compressed sparse row of the neighbor edges of each node
+  struct FrozenNeighborEdges {
+    // Sorted nodes with neighbor edges
+    Vector<Index> indices;
+    // Neighbor edges of indices[i] are edge_indices[offsets[i], offsets[i + 1])
+    Vector<size_t> offsets;
+    Vector<EdgeIndex> edge_indices;
+
+    void build(const NeighborEdgeMap &neighbor_edges, size_t num_edges) {
+      indices.reserve(neighbor_edges.size());
+      offsets.reserve(neighbor_edges.size() + 1);
+      edge_indices.reserve(num_edges);
+      for (auto &iter : neighbor_edges) {
+        indices.push_back(iter.first);
+        offsets.push_back(edge_indices.size());
+        edge_indices.insert(edge_indices.end(), iter.second.begin(), iter.second.end());
+      }
+      offsets.push_back(edge_indices.size());
+    }
+
+    NeighborEdges edges(const Index &index) const {
+      auto iter = std::lower_bound(indices.begin(), indices.end(), index);
+      if (iter == indices.end() || index < *iter) {
+        return NeighborEdges();
+      }
+      auto i = iter - indices.begin();
+      return NeighborEdges(edge_indices.data() + offsets[i], edge_indices.data() + offsets[i + 1]);
+    }
+  };
+
+  template <typename Value, typename Key>
+  static Value *frozen_find(const Vector<Value> &values, const Key &key) {
+    auto iter = std::lower_bound(values.begin(), values.end(), key,
+                                 [](const Value &value, const Key &key) { return value.first < key; });
+    if (iter == values.end() || key < iter->first) {
+      return NULL;
+    }
+    // As node() and edge() declare, the const overloads return mutable references
+    return const_cast<Value *>(&(*iter));
+  }
+
+  // Same as at() of the thawed maps, throws if key is not found
+  template <typename Value, typename Key>
+  static Value &frozen_at(const Vector<Value> &values, const Key &key) {
+    auto *value = frozen_find(values, key);
+    if (value == NULL) {
+      throw std::out_of_range("Graph: key not found in the frozen graph");
+    }
+    return *value;
+  }
 
  private:
   NeighborEdgeMap _incoming_edges;
   NeighborEdgeMap _outgoing_edges;
   EdgeMap _edges;
   NodeMap _nodes;
+
+  bool _frozen = false;
+  Vector<typename NodeMap::value_type> _frozen_nodes;
+  Vector<typename EdgeMap::value_type> _frozen_edges;
+  FrozenNeighborEdges _frozen_incoming_edges;
+  FrozenNeighborEdges _frozen_outgoing_edges;
 };
 
 }  // namespace redshow
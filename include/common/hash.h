@@ -1,6 +1,8 @@
 #ifndef REDSHOW_HASH_H
 #define REDSHOW_HASH_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace redshow {
@@ -14,6 +16,16 @@ namespace redshow {
  */
 std::string sha256(void *input, unsigned int length);
 
+/**
+ * @brief xxHash64, a fast non-cryptographic hash for large inputs
+ *
+ * @param input input bytes
+ * @param length number of bytes
+ * @param seed
+ * @return uint64_t hash
+ */
+uint64_t xxhash64(const void *input, size_t length, uint64_t seed = 0);
+
 class SHA256 {
  protected:
   typedef unsigned char uint8;
@@ -4,6 +4,8 @@
 #include <map>
 #include <mutex>
 
+#include "common/stats.h"
+
 namespace redshow {
 
 template <typename K, typename V>
@@ -38,7 +40,7 @@ class Map : public std::map<K, V> {
 template <typename K, typename V>
 class LockableMap : public Map<K, V> {
  public:
-  void lock() const { _lock.lock(); }
+  void lock() const { stats_lock(_lock); }
   void unlock() const { _lock.unlock(); }
 
   LockableMap() = default;
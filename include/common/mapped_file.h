@@ -0,0 +1,35 @@
+#ifndef REDSHOW_COMMON_MAPPED_FILE_H
+#define REDSHOW_COMMON_MAPPED_FILE_H
+
+#include <string>
+
+#include "common/utils.h"
+
+namespace redshow {
+
+/**
+ * @brief Read-only memory mapping of a whole file, data() is NULL if the file cannot be mapped
+ * or is empty
+ */
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string &file_path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  const char *data() const { return _data; }
+
+  size_t size() const { return _size; }
+
+ private:
+  const char *_data = NULL;
+  size_t _size = 0;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_COMMON_MAPPED_FILE_H
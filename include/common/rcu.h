@@ -0,0 +1,118 @@
+#ifndef REDSHOW_COMMON_RCU_H
+#define REDSHOW_COMMON_RCU_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "common/map.h"
+#include "common/stats.h"
+#include "common/utils.h"
+
+namespace redshow {
+
+/**
+ * @brief Epoch based read-copy-update.
+ *
+ * Readers announce the global epoch when they enter a read section and never block. Writers
+ * replace a published object, then retire the old one, which is reclaimed once every reader that
+ * might still see it has left its read section.
+ */
+class Rcu {
+ public:
+  /**
+   * @brief Enter a read section, sections can be nested
+   */
+  static void read_lock();
+
+  static void read_unlock();
+
+  /**
+   * @brief Run reclaim once readers that entered before now have left
+   *
+   * The object must have been unpublished before it is retired.
+   */
+  static void retire(std::function<void()> reclaim);
+
+  /**
+   * @brief Reclaim retired objects that no reader can see
+   */
+  static void reclaim();
+};
+
+class RcuReadLock {
+ public:
+  RcuReadLock() { Rcu::read_lock(); }
+
+  ~RcuReadLock() { Rcu::read_unlock(); }
+
+  RcuReadLock(const RcuReadLock &) = delete;
+
+  RcuReadLock &operator=(const RcuReadLock &) = delete;
+};
+
+/**
+ * @brief A map published through RCU.
+ *
+ * Readers use read() or find() inside a read section without locking. Writers serialize on
+ * update(), which copies the map, so values are shared pointers and only the modified values have
+ * to be copied.
+ */
+template <typename K, typename V>
+class RcuMap {
+ public:
+  typedef Map<K, std::shared_ptr<const V>> Version;
+
+ public:
+  RcuMap() : _version(new Version()) {}
+
+  ~RcuMap() { delete _version.load(); }
+
+  RcuMap(const RcuMap &) = delete;
+
+  RcuMap &operator=(const RcuMap &) = delete;
+
+  /**
+   * @brief The current map, valid until the end of the caller's read section or update
+   */
+  const Version &read() const { return *_version.load(std::memory_order_acquire); }
+
+  /**
+   * @brief The value of k, NULL if there is none, valid as long as read()
+   */
+  const V *find(const K &k) const {
+    auto &version = read();
+    auto iter = version.find(k);
+    return iter == version.end() ? NULL : iter->second.get();
+  }
+
+  bool has(const K &k) const { return read().has(k); }
+
+  /**
+   * @brief Apply update(Version &) on a copy of the map and publish the copy if update returns true
+   */
+  template <typename Update>
+  void update(Update update) {
+    std::unique_lock<std::mutex> lock(_lock, std::defer_lock);
+    stats_lock(lock);
+
+    auto *version = new Version(read());
+    if (!update(*version)) {
+      delete version;
+      return;
+    }
+
+    auto *old_version = _version.exchange(version);
+    Rcu::retire([old_version]() { delete old_version; });
+  }
+
+ private:
+  std::atomic<Version *> _version;
+  // Serializes writers
+  std::mutex _lock;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_COMMON_RCU_H
@@ -0,0 +1,48 @@
+#ifndef REDSHOW_COMMON_SIMD_H
+#define REDSHOW_COMMON_SIMD_H
+
+#include "common/utils.h"
+#include "redshow.h"
+
+namespace redshow {
+
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2, SIMD_LEVEL_COUNT = 3 };
+
+/**
+ * @brief Routines over the GPU_PATCH_WARP_SIZE lanes of a record.
+ *
+ * On x86-64, the vector versions are compiled for their instruction sets regardless of the build
+ * flags and selected by the CPU at runtime, and all versions produce the same bits. A level may
+ * keep the scalar version of a routine that its instructions do not speed up. Other architectures
+ * only have the scalar versions.
+ * In a value block, lane j starts at block + j * GPU_PATCH_MAX_ACCESS_SIZE, as in
+ * gpu_patch_record_t::value, and units are read at offsets that are multiples of their size.
+ */
+struct SimdWarpFunctions {
+  // values[j] = the 32-bit unit at offset of lane j, zero extended, & mask
+  void (*extract_u32)(const u8 *block, u32 offset, u64 mask, u64 *values);
+  // values[j] = the 64-bit unit at offset of lane j & mask
+  void (*extract_u64)(const u8 *block, u32 offset, u64 mask, u64 *values);
+  // dst[j] = src[j] & mask, dst may be src
+  void (*mask)(const u64 *src, u64 mask, u64 *dst);
+};
+
+/**
+ * @brief The best level supported by the CPU
+ */
+SimdLevel simd_level();
+
+bool simd_supported(SimdLevel level);
+
+const char *simd_level_name(SimdLevel level);
+
+/**
+ * @brief Functions of a supported level, functions of simd_level() by default
+ */
+const SimdWarpFunctions &simd_warp_functions(SimdLevel level);
+
+const SimdWarpFunctions &simd_warp_functions();
+
+}  // namespace redshow
+
+#endif  // REDSHOW_COMMON_SIMD_H
@@ -0,0 +1,174 @@
+#ifndef REDSHOW_COMMON_STATS_H
+#define REDSHOW_COMMON_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+#include "common/utils.h"
+#include "redshow.h"
+
+namespace redshow {
+
+enum StatsPhase {
+  STATS_PHASE_BEGIN = 0,
+  STATS_PHASE_ACCESS = 1,
+  STATS_PHASE_END = 2,
+  STATS_PHASE_OP_CALLBACK = 3,
+  STATS_PHASE_FLUSH = 4,
+  STATS_PHASE_COUNT = 5
+};
+
+/*
+ * Counter slots. A timed section takes two adjacent slots, <count, ns>.
+ */
+enum StatsCounter {
+  // <count, ns> per GPUPatchType
+  STATS_TRACE = 0,
+  // Records per GPUPatchType
+  STATS_TRACE_RECORDS = STATS_TRACE + 2 * GPU_PATCH_TYPE_COUNT,
+  // <count, ns>
+  STATS_CUBIN = STATS_TRACE_RECORDS + GPU_PATCH_TYPE_COUNT,
+  STATS_TRACE_COPY = STATS_CUBIN + 2,
+  STATS_TRACE_COPY_BYTES = STATS_TRACE_COPY + 1,
+  // <count, ns>
+  STATS_DTOH = STATS_TRACE_COPY_BYTES + 1,
+  STATS_DTOH_BYTES = STATS_DTOH + 2,
+  // Lanes dropped because the access crosses the end of its memory object
+  STATS_OUT_OF_BOUNDS_ACCESSES = STATS_DTOH_BYTES + 1,
+  // Lanes dropped because no memory object contains the address
+  STATS_UNKNOWN_MEMORY_ACCESSES = STATS_OUT_OF_BOUNDS_ACCESSES + 1,
+  // <count, ns> of contended lock acquisitions
+  STATS_LOCK_WAIT = STATS_UNKNOWN_MEMORY_ACCESSES + 1,
+  // Instruction files loaded from the instruction cache
+  STATS_INSTRUCTION_CACHE_HITS = STATS_LOCK_WAIT + 2,
+  // Instruction files parsed although the instruction cache is enabled
+  STATS_INSTRUCTION_CACHE_MISSES = STATS_INSTRUCTION_CACHE_HITS + 1,
+  // Cubins sharing the instruction graph of a cubin with an identical instruction file
+  STATS_INSTRUCTION_SHARED = STATS_INSTRUCTION_CACHE_MISSES + 1,
+  // Modules whose cubin was found parsed when first analyzed
+  STATS_CUBIN_PREFETCH_HITS = STATS_INSTRUCTION_SHARED + 1,
+  // <count, ns> of waits for a prefetch worker still parsing the cubin
+  STATS_CUBIN_PREFETCH_WAIT = STATS_CUBIN_PREFETCH_HITS + 1,
+  // Lanes resolved by the memory TLB of a trace, or searched in the memory index
+  STATS_MEMORY_TLB_HITS = STATS_CUBIN_PREFETCH_WAIT + 2,
+  STATS_MEMORY_TLB_MISSES = STATS_MEMORY_TLB_HITS + 1,
+  // Default trace records folded into an identical record
+  STATS_DEDUPLICATED_RECORDS = STATS_MEMORY_TLB_MISSES + 1,
+  // <count, ns> per analysis type and phase
+  STATS_ANALYSIS = STATS_DEDUPLICATED_RECORDS + 1,
+  STATS_COUNTER_COUNT = STATS_ANALYSIS + 2 * REDSHOW_ANALYSIS_COUNT * STATS_PHASE_COUNT
+};
+
+inline u32 stats_trace(u32 type) { return STATS_TRACE + 2 * type; }
+
+inline u32 stats_analysis(u32 analysis, StatsPhase phase) {
+  return STATS_ANALYSIS + 2 * (analysis * STATS_PHASE_COUNT + phase);
+}
+
+/**
+ * @brief Self-profiling counters of redshow.
+ *
+ * Every thread updates its own slots without read-modify-write instructions. Slots of all
+ * threads, including exited ones, are only summed when stats are queried.
+ */
+class Stats {
+ public:
+  static void add(u32 counter, u64 value) {
+    auto &slot = local().values[counter];
+    slot.store(slot.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief Sum of all threads
+   */
+  static void get(redshow_stats_t *stats);
+
+  /**
+   * @brief Write merged stats to file_name in json
+   */
+  static void dump(const std::string &file_name);
+
+ private:
+  struct ThreadStats {
+    std::atomic<u64> values[STATS_COUNTER_COUNT];
+
+    ThreadStats();
+
+    ~ThreadStats();
+  };
+
+  static ThreadStats &local() {
+    static thread_local ThreadStats stats;
+    return stats;
+  }
+
+  static void merge(u64 *values);
+};
+
+/**
+ * @brief Accumulate the time of a scope into a <count, ns> pair
+ */
+class StatsTimer {
+ public:
+  explicit StatsTimer(u32 counter) : _counter(counter), _start(std::chrono::steady_clock::now()) {}
+
+  ~StatsTimer() {
+    auto end = std::chrono::steady_clock::now();
+    Stats::add(_counter, 1);
+    Stats::add(_counter + 1,
+               std::chrono::duration_cast<std::chrono::nanoseconds>(end - _start).count());
+  }
+
+ private:
+  u32 _counter;
+  std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @brief Count a scope into a <count, ns> pair, and time it only if timed is set.
+ * Used on paths called per warp, where reading the clock costs as much as the work.
+ */
+class StatsCountTimer {
+ public:
+  StatsCountTimer(u32 counter, bool timed) : _counter(counter), _timed(timed) {
+    if (timed) {
+      _start = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~StatsCountTimer() {
+    Stats::add(_counter, 1);
+    if (_timed) {
+      auto end = std::chrono::steady_clock::now();
+      Stats::add(_counter + 1,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(end - _start).count());
+    }
+  }
+
+ private:
+  u32 _counter;
+  bool _timed;
+  std::chrono::steady_clock::time_point _start;
+};
+
+// Only contended acquisitions are timed
+template <typename Lockable>
+void stats_lock(Lockable &lockable) {
+  if (!lockable.try_lock()) {
+    StatsTimer timer(STATS_LOCK_WAIT);
+    lockable.lock();
+  }
+}
+
+template <typename Lockable>
+void stats_lock_shared(Lockable &lockable) {
+  if (!lockable.try_lock_shared()) {
+    StatsTimer timer(STATS_LOCK_WAIT);
+    lockable.lock_shared();
+  }
+}
+
+}  // namespace redshow
+
+#endif  // REDSHOW_COMMON_STATS_H
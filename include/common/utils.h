@@ -57,6 +57,10 @@ const int MEM_VIEWS_LIMIT = 10;
 
 const int OMP_SEQ_LEN = 100000;
 
+const int ASYNC_NUM_WORKERS = 4;
+// Bytes of trace copies waiting for analysis before redshow_analyze_async blocks
+const u64 ASYNC_QUEUE_BYTES = 1024ul * 1024ul * 1024ul;
+
 struct ThreadId {
   u32 flat_block_id;
   u32 flat_thread_id;
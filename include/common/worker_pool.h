@@ -0,0 +1,77 @@
+#ifndef REDSHOW_COMMON_WORKER_POOL_H
+#define REDSHOW_COMMON_WORKER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "common/utils.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+/**
+ * @brief A fixed set of worker threads, each draining its own FIFO queue.
+ *
+ * Tasks submitted with the same key run on the same worker in submission order.
+ * Submission blocks while the bytes held by queued tasks exceed the budget.
+ */
+class WorkerPool {
+ public:
+  typedef std::function<void()> Task;
+
+  WorkerPool() = default;
+
+  ~WorkerPool() { stop(); }
+
+  /**
+   * @brief Spawn num_workers threads, no-op if the pool is running
+   */
+  void start(u32 num_workers, u64 budget);
+
+  /**
+   * @brief Wait for all the queued tasks and join the workers
+   */
+  void stop();
+
+  /**
+   * @brief Queue task to the worker of key, blocks if the queue is over budget
+   *
+   * @param bytes Memory held by the task until it finishes
+   */
+  void submit(u64 key, u64 bytes, Task task);
+
+  /**
+   * @brief Wait until all the submitted tasks are done
+   */
+  void drain();
+
+  bool running() const;
+
+ private:
+  struct Worker {
+    std::thread thread;
+    std::deque<std::pair<u64, Task>> tasks;
+    std::condition_variable ready;
+  };
+
+  void work(Worker &worker);
+
+ private:
+  Vector<std::unique_ptr<Worker>> _workers;
+  mutable std::mutex _lock;
+  // Signaled when a task finishes
+  std::condition_variable _done;
+  u64 _budget = 0;
+  u64 _queued_bytes = 0;
+  u64 _pending = 0;
+  bool _running = false;
+  bool _stopping = false;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_COMMON_WORKER_POOL_H
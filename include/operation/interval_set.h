@@ -0,0 +1,89 @@
+#ifndef REDSHOW_OPERATION_INTERVAL_SET_H
+#define REDSHOW_OPERATION_INTERVAL_SET_H
+
+#include "common/utils.h"
+#include "common/vector.h"
+#include "operation/memory.h"
+
+namespace redshow {
+
+/**
+ * @brief A set of [start, end) address ranges, stored sorted and coalesced.
+ *
+ * Overlapping and adjacent ranges are merged into one. Ranges are appended with add() in any
+ * order and coalesced by normalize(), so building a set of n ranges takes O(n log n), and
+ * O(n) if they are added in ascending order, as the lanes of a coalesced access are. Two
+ * normalized sets are merged in linear time.
+ */
+class IntervalSet {
+ public:
+  typedef Vector<MemoryRange>::const_iterator const_iterator;
+
+ public:
+  IntervalSet() = default;
+
+  /**
+   * @brief Add [start, end), the set must be normalized before it is read
+   */
+  void add(u64 start, u64 end) {
+    if (start >= end) {
+      return;
+    }
+
+    if (!_ranges.empty() && _normalized) {
+      auto &back = _ranges.back();
+      if (start >= back.start) {
+        if (start <= back.end) {
+          // Extends the last range
+          back.end = MAX2(back.end, end);
+          return;
+        }
+      } else {
+        _normalized = false;
+      }
+    }
+    _ranges.emplace_back(start, end);
+  }
+
+  void add(const MemoryRange &range) { add(range.start, range.end); }
+
+  /**
+   * @brief Sort and coalesce ranges added out of order
+   */
+  void normalize();
+
+  /**
+   * @brief Add all the ranges of other, both sets must be normalized
+   */
+  void merge(const IntervalSet &other);
+
+  bool normalized() const { return _normalized; }
+
+  bool empty() const { return _ranges.empty(); }
+
+  size_t size() const { return _ranges.size(); }
+
+  // Total length of the ranges
+  u64 bytes() const;
+
+  void clear() {
+    _ranges.clear();
+    _normalized = true;
+  }
+
+  const MemoryRange &front() const { return _ranges.front(); }
+
+  const MemoryRange &back() const { return _ranges.back(); }
+
+  const_iterator begin() const { return _ranges.begin(); }
+
+  const_iterator end() const { return _ranges.end(); }
+
+ private:
+  Vector<MemoryRange> _ranges;
+  bool _normalized = true;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_OPERATION_INTERVAL_SET_H
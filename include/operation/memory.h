@@ -2,6 +2,7 @@
 #define REDSHOW_OPERATION_MEMORY_H
 
 #include <memory>
+#include <type_traits>
 
 #include "common/utils.h"
 #include "operation/operation.h"
@@ -47,6 +48,29 @@ struct Memory : public Operation {
   virtual ~Memory() {}
 };
 
+/**
+ * @brief The part of a memory object seen by an access.
+ *
+ * Passed by value on the access path of every lane, so it has no virtual functions and owns no
+ * buffers. Memory is only used for registered objects.
+ */
+struct MemoryView {
+  u64 op_id;
+  i32 ctx_id;
+  MemoryRange memory_range;
+  size_t len;
+
+  MemoryView() = default;
+
+  MemoryView(u64 op_id, i32 ctx_id, u64 start, size_t len)
+      : op_id(op_id), ctx_id(ctx_id), memory_range(start, start + len), len(len) {}
+
+  bool operator<(const MemoryView &other) const { return this->memory_range < other.memory_range; }
+};
+
+static_assert(std::is_trivially_copyable<MemoryView>::value,
+              "MemoryView is copied on the access path of every lane");
+
 /**
  * @brief calculate a hash for the memory region
  *
@@ -0,0 +1,243 @@
+#ifndef REDSHOW_OPERATION_MEMORY_INDEX_H
+#define REDSHOW_OPERATION_MEMORY_INDEX_H
+
+#include <deque>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+
+#include "common/map.h"
+#include "common/stats.h"
+#include "common/utils.h"
+#include "common/vector.h"
+#include "operation/memory.h"
+#include "redshow.h"
+
+namespace redshow {
+
+/**
+ * @brief Memory objects indexed by address and lifetime.
+ *
+ * Objects alive as of each registering or freeing operation form a version of a persistent tree
+ * ordered by start address. An update copies only the O(log n) nodes on its path and shares the
+ * rest with the previous version, so the object containing an address is looked up as of any host
+ * op id by a binary search over versions and a single tree search, without keeping a copy of all
+ * live objects per operation.
+ */
+class MemoryIndex {
+ public:
+  MemoryIndex() = default;
+
+  /**
+   * @brief Register a memory object allocated at memory->op_id
+   *
+   * @return REDSHOW_ERROR_DUPLICATE_ENTRY if an object with the same start is alive
+   */
+  redshow_result_t insert(std::shared_ptr<Memory> memory);
+
+  /**
+   * @brief End the lifetime of the object starting at memory_range.start at op_id
+   */
+  redshow_result_t erase(u64 op_id, const MemoryRange &memory_range);
+
+  /**
+   * @brief Get the object containing addr as of op_id, NULL if there is none
+   */
+  const Memory *find(u64 op_id, u64 addr) const;
+
+  /**
+   * @brief Drop versions before op_id, they cannot be queried anymore. Objects freed before op_id
+   * are released with the last version referring to them.
+   */
+  void prune(u64 op_id);
+
+  /**
+   * @brief Incremented by every update, results of find() stay valid while it is unchanged
+   */
+  u64 version() const { return _version; }
+
+  /**
+   * @brief If any object was registered or freed at or before op_id
+   */
+  bool has_snapshot(u64 op_id) const { return op_id >= _first_op_id; }
+
+  /**
+   * @brief Visit objects alive as of op_id in the ascending order of addresses
+   */
+  template <typename Visitor>
+  void visit(u64 op_id, Visitor visitor) const {
+    visit(root(op_id), visitor);
+  }
+
+  /**
+   * @brief Number of objects alive as of op_id
+   */
+  size_t visit_size(u64 op_id) const {
+    auto *node = root(op_id);
+    return node == NULL ? 0 : node->size;
+  }
+
+  void lock() const { stats_lock(_lock); }
+  void unlock() const { _lock.unlock(); }
+  void lock_shared() const { stats_lock_shared(_lock); }
+  void unlock_shared() const { _lock.unlock_shared(); }
+
+ private:
+  static const u64 ALIVE = std::numeric_limits<u64>::max();
+
+  struct Node;
+
+  // Nodes are immutable once built and shared by versions
+  typedef std::shared_ptr<const Node> NodePtr;
+
+  // Treap node keyed by memory_range.start
+  struct Node {
+    u64 start;
+    u64 priority;
+    size_t size;
+    std::shared_ptr<Memory> memory;
+    NodePtr left;
+    NodePtr right;
+  };
+
+  // Objects alive from op_id to the op_id of the next version
+  struct Version {
+    u64 op_id;
+    NodePtr root;
+  };
+
+  static NodePtr make_node(const Node &node, NodePtr left, NodePtr right);
+
+  // left gets the nodes before start, right the others
+  static void split(const NodePtr &node, u64 start, NodePtr &left, NodePtr &right);
+
+  static NodePtr merge(const NodePtr &left, const NodePtr &right);
+
+  static NodePtr insert_node(const NodePtr &root, std::shared_ptr<Memory> memory);
+
+  static NodePtr erase_node(const NodePtr &root, u64 start);
+
+  // The node with the greatest start not above addr
+  static const Node *lower_node(const Node *node, u64 addr);
+
+  static const Node *find_node(const Node *node, u64 start) {
+    node = lower_node(node, start);
+    return node != NULL && node->start == start ? node : NULL;
+  }
+
+  template <typename Visitor>
+  static void visit(const Node *node, Visitor &visitor) {
+    if (node != NULL) {
+      visit(node->left.get(), visitor);
+      visitor(*node->memory);
+      visit(node->right.get(), visitor);
+    }
+  }
+
+  // Root of the version as of op_id
+  const Node *root(u64 op_id) const;
+
+  // Version of op_id, created from the previous version if there is none
+  std::deque<Version>::iterator version_at(u64 op_id);
+
+ private:
+  // Sorted by op_id
+  std::deque<Version> _versions;
+  u64 _first_op_id = ALIVE;
+  u64 _version = 0;
+
+  mutable std::shared_mutex _lock;
+};
+
+/**
+ * @brief Direct-mapped cache of MemoryIndex::find results as of a single op_id.
+ *
+ * Lanes of a warp, and consecutive records of a trace, mostly access the same objects. Entries
+ * are keyed by address page and checked before the tree search, and the last object found is
+ * checked before the entries, so a warp whose lanes access one object resolves it once. One cache
+ * is used by a single trace, its hits and misses are added to the stats when it is destroyed.
+ */
+class MemoryTLB {
+ public:
+  static const u32 PAGE_SHIFT = 12;
+  static const u32 NUM_ENTRIES = 64;
+
+ public:
+  MemoryTLB(const MemoryIndex *memory_index, u64 op_id)
+      : _memory_index(memory_index), _op_id(op_id), _version(INVALID_VERSION) {}
+
+  ~MemoryTLB() {
+    Stats::add(STATS_MEMORY_TLB_HITS, _hits);
+    Stats::add(STATS_MEMORY_TLB_MISSES, _misses);
+  }
+
+  MemoryTLB(const MemoryTLB &) = delete;
+
+  MemoryTLB &operator=(const MemoryTLB &) = delete;
+
+  /**
+   * @brief Same as memory_index->find(op_id, addr), the index must be locked
+   */
+  const Memory *find(u64 addr) {
+    if (_version != _memory_index->version()) {
+      // Objects may have been freed or pruned since the last lookup
+      flush();
+    }
+
+    if (_last != NULL && contains(_last, addr)) {
+      ++_hits;
+      return _last;
+    }
+
+    auto page = addr >> PAGE_SHIFT;
+    auto &entry = _entries[page & (NUM_ENTRIES - 1)];
+    if (entry.page == page && entry.memory != NULL && contains(entry.memory, addr)) {
+      ++_hits;
+      _last = entry.memory;
+      return _last;
+    }
+
+    ++_misses;
+    auto *memory = _memory_index->find(_op_id, addr);
+    if (memory != NULL) {
+      entry.page = page;
+      entry.memory = memory;
+      _last = memory;
+    }
+    return memory;
+  }
+
+ private:
+  // The index is not locked at construction, the first find() flushes
+  static const u64 INVALID_VERSION = std::numeric_limits<u64>::max();
+
+  struct Entry {
+    u64 page = 0;
+    const Memory *memory = NULL;
+  };
+
+  static bool contains(const Memory *memory, u64 addr) {
+    return addr >= memory->memory_range.start && addr < memory->memory_range.end;
+  }
+
+  void flush() {
+    for (auto &entry : _entries) {
+      entry = Entry();
+    }
+    _last = NULL;
+    _version = _memory_index->version();
+  }
+
+ private:
+  const MemoryIndex *_memory_index;
+  u64 _op_id;
+  u64 _version;
+  const Memory *_last = NULL;
+  Entry _entries[NUM_ENTRIES];
+  u64 _hits = 0;
+  u64 _misses = 0;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_OPERATION_MEMORY_INDEX_H
@@ -19,8 +19,8 @@ typedef enum redshow_analysis_type {
   REDSHOW_ANALYSIS_MEMORY_HEATMAP = 6,
   REDSHOW_ANALYSIS_MEMORY_LIVENESS = 7,
   REDSHOW_ANALYSIS_DATA_DEPENDENCY = 8,
-  REDSHOW_ANALYSIS_TORCH_MONITOR = 9
-  
+  REDSHOW_ANALYSIS_TORCH_MONITOR = 9,
+  REDSHOW_ANALYSIS_COUNT = 10
 } redshow_analysis_type_t;
 
 typedef enum redshow_analysis_config_type {
@@ -89,6 +89,58 @@ typedef struct redshow_record_data {
   redshow_record_view_t *views;
 } redshow_record_data_t;
 
+// Number of calls and accumulated nanoseconds of each analysis callback
+typedef struct redshow_analysis_stats {
+  uint64_t begin_count;
+  uint64_t begin_ns;
+  uint64_t access_count;
+  // Only accumulated if enabled by redshow_access_timing_config
+  uint64_t access_ns;
+  uint64_t end_count;
+  uint64_t end_ns;
+  uint64_t op_callback_count;
+  uint64_t op_callback_ns;
+  uint64_t flush_count;
+  uint64_t flush_ns;
+} redshow_analysis_stats_t;
+
+typedef struct redshow_stats {
+  // Indexed by GPUPatchType
+  uint64_t trace_count[GPU_PATCH_TYPE_COUNT];
+  uint64_t trace_ns[GPU_PATCH_TYPE_COUNT];
+  uint64_t trace_records[GPU_PATCH_TYPE_COUNT];
+  uint64_t cubin_count;
+  uint64_t cubin_ns;
+  // Trace buffers copied by redshow_analyze_async
+  uint64_t trace_copy_count;
+  uint64_t trace_copy_bytes;
+  uint64_t dtoh_count;
+  uint64_t dtoh_ns;
+  uint64_t dtoh_bytes;
+  // Dropped lanes
+  uint64_t out_of_bounds_accesses;
+  uint64_t unknown_memory_accesses;
+  // Contended lock acquisitions
+  uint64_t lock_wait_count;
+  uint64_t lock_wait_ns;
+  // Instruction files loaded from or missing in the instruction cache
+  uint64_t instruction_cache_hits;
+  uint64_t instruction_cache_misses;
+  // Cubins sharing the parse of an identical instruction file
+  uint64_t instruction_shared;
+  // Modules whose cubin was found parsed, or waited for, when first analyzed
+  uint64_t cubin_prefetch_hits;
+  uint64_t cubin_prefetch_wait_count;
+  uint64_t cubin_prefetch_wait_ns;
+  // Memory object lookups resolved by or missing in the per-trace memory TLB
+  uint64_t memory_tlb_hits;
+  uint64_t memory_tlb_misses;
+  // Default trace records folded into an identical record by record deduplication
+  uint64_t deduplicated_records;
+  // Indexed by redshow_analysis_type_t
+  redshow_analysis_stats_t analysis[REDSHOW_ANALYSIS_COUNT];
+} redshow_stats_t;
+
 /**
  * @brief Config default output directory
  *
@@ -100,6 +152,60 @@ typedef struct redshow_record_data {
 EXTERNC redshow_result_t redshow_output_dir_config(redshow_analysis_type_t analysis,
                                                    const char *dir);
 
+/**
+ * @brief Config the directory of parsed instruction files.
+ * Cubins whose instruction files were parsed by a previous run are loaded from dir without
+ * parsing. The cache is disabled if dir is NULL or empty.
+ *
+ * @param dir
+ * @return EXTERNC
+ *
+ * @thread-safe: No
+ */
+EXTERNC redshow_result_t redshow_instruction_cache_config(const char *dir);
+
+/**
+ * @brief Config background parsing of cubins registered by redshow_cubin_cache_register.
+ * Cubins listed in hint_file are parsed first, followed by the most recently registered ones.
+ * Analyzing a kernel waits only if its cubin is being parsed. redshow_flush stops the workers
+ * and writes the cubins used by this run to hint_file.
+ *
+ * @param num_workers prefetching is disabled if 0
+ * @param hint_file not used if NULL or empty
+ * @return EXTERNC
+ *
+ * @thread-safe: No
+ */
+EXTERNC redshow_result_t redshow_cubin_prefetch_config(uint32_t num_workers,
+                                                       const char *hint_file);
+
+/**
+ * @brief Config run-length deduplication of default trace records.
+ * A record identical to the previous record of the same pc and thread, including its active
+ * lanes, addresses, and values, is analyzed once with a repeat count. Deduplication only applies
+ * if all the enabled analyses of default traces are weighted, e.g., spatial redundancy and value
+ * pattern, so their results do not change. Disabled by default.
+ *
+ * @param enable
+ * @return EXTERNC
+ *
+ * @thread-safe: No
+ */
+EXTERNC redshow_result_t redshow_record_dedup_config(bool enable);
+
+/**
+ * @brief Config timing of the per-warp access callbacks of analyses.
+ * Access callbacks are always counted, but reading the clock around each of them costs as much as
+ * a cheap analysis, so their time is only accumulated into access_ns if enabled. Disabled by
+ * default.
+ *
+ * @param enable
+ * @return EXTERNC
+ *
+ * @thread-safe: No
+ */
+EXTERNC redshow_result_t redshow_access_timing_config(bool enable);
+
 /**
  * @brief Config default data type
  *
@@ -173,6 +279,7 @@ EXTERNC redshow_result_t redshow_torch_enable();
 
 /**
  * @brief This function is used to setup specific analysis types.
+ * Traces pending in redshow_analyze_async are analyzed first.
  *
  * @param analysis_type
  * @return reshow_result_t
@@ -193,6 +300,7 @@ EXTERNC redshow_result_t redshow_analysis_enabled(redshow_analysis_type_t analys
 
 /**
  * @brief This function is used to cancel specific analysis types.
+ * Traces pending in redshow_analyze_async are analyzed first.
  *
  * @param analysis_type
  * @return reshow_result_t
@@ -424,6 +532,46 @@ EXTERNC redshow_result_t redshow_analyze(uint32_t cpu_thread, uint32_t cubin_id,
                                          int32_t kernel_id, uint64_t host_op_id, uint32_t stream_id,
                                          gpu_patch_buffer_t *trace_data);
 
+/**
+ * @brief Configure the worker pool used by redshow_analyze_async.
+ * Takes effect before the first asynchronous analysis.
+ *
+ * @param num_workers Number of analysis threads
+ * @param queue_bytes Memory budget of queued traces, redshow_analyze_async blocks beyond it
+ * @return reshow_result_t
+ *
+ * @thread-safe NO
+ */
+EXTERNC redshow_result_t redshow_analysis_async_config(uint32_t num_workers, uint64_t queue_bytes);
+
+/**
+ * @brief Same as redshow_analyze, but trace_data is copied and analyzed by a worker thread.
+ * redshow_log_data_callback_func is called with the original buffer before returning, so the
+ * buffer can be reused by the GPU while the copy is analyzed.
+ *
+ * Traces of the same cpu_thread and kernel_id are analyzed in submission order, traces of
+ * different kernels may be analyzed at the same time. Operations registered afterwards wait for
+ * pending traces if an enabled analysis depends on the order, e.g., data flow and memory
+ * liveness.
+ *
+ * @return reshow_result_t Errors of the analysis itself are not reported
+ *
+ * @thread-safe YES
+ */
+EXTERNC redshow_result_t redshow_analyze_async(uint32_t cpu_thread, uint32_t cubin_id,
+                                               uint32_t mod_id, int32_t kernel_id,
+                                               uint64_t host_op_id, uint32_t stream_id,
+                                               gpu_patch_buffer_t *trace_data);
+
+/**
+ * @brief Wait until all the traces submitted by redshow_analyze_async are analyzed
+ *
+ * @return reshow_result_t
+ *
+ * @thread-safe YES
+ */
+EXTERNC redshow_result_t redshow_analysis_drain();
+
 /**
  * @brief Callback function prototype
  *
@@ -460,6 +608,40 @@ EXTERNC redshow_result_t redshow_kernel_begin(uint32_t cpu_thread, int32_t kerne
 EXTERNC redshow_result_t redshow_kernel_end(uint32_t cpu_thread, uint32_t stream_id, int32_t kernel_id,
                                             uint64_t host_op_id);
 
+/**
+ * @brief Record every following state-changing API call, including the raw trace buffers and
+ * device memory read through redshow_tool_dtoh_func, into a capture file.
+ * The file can be replayed without a GPU by redshow_replay.
+ *
+ * @param path Capture file, truncated if it exists
+ * @return reshow_result_t
+ *
+ * @thread-safe NO
+ */
+EXTERNC redshow_result_t redshow_capture_enable(const char *path);
+
+/**
+ * @brief Stop recording and close the capture file
+ *
+ * Returns REDSHOW_ERROR_NO_SUCH_FILE if a write failed and the capture stopped early.
+ *
+ * @return reshow_result_t
+ *
+ * @thread-safe NO
+ */
+EXTERNC redshow_result_t redshow_capture_disable();
+
+/**
+ * @brief Get the time and counters redshow itself spent so far, summed over all threads.
+ * The same stats are written to redshow_stats.json by redshow_flush.
+ *
+ * @param stats
+ * @return reshow_result_t
+ *
+ * @thread-safe YES
+ */
+EXTERNC redshow_result_t redshow_stats_get(redshow_stats_t *stats);
+
 /**
  * @brief Mark the begin of the current analysis region
  *
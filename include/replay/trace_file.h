@@ -0,0 +1,200 @@
+#ifndef REDSHOW_REPLAY_TRACE_FILE_H
+#define REDSHOW_REPLAY_TRACE_FILE_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+#include "common/utils.h"
+#include "common/vector.h"
+#include "redshow.h"
+
+namespace redshow {
+
+/*
+ * Capture file layout (native endianness):
+ *
+ * header: magic[8] version:u32 reserved:u32
+ * event:  type:u32 reserved:u32 payload_len:u64 payload[payload_len]
+ *
+ * Payload fields are written back to back in the order of the corresponding API arguments.
+ * Strings and byte arrays are prefixed by a u64 length.
+ */
+const char TRACE_FILE_MAGIC[8] = {'R', 'S', 'T', 'R', 'A', 'C', 'E', '\0'};
+// Bump on any change of the event payloads
+const u32 TRACE_FILE_VERSION = 2;
+
+enum TraceEventType {
+  TRACE_EVENT_NONE = 0,
+  TRACE_EVENT_OUTPUT_DIR_CONFIG = 1,
+  TRACE_EVENT_DATA_TYPE_CONFIG = 2,
+  TRACE_EVENT_APPROX_LEVEL_CONFIG = 3,
+  TRACE_EVENT_ANALYSIS_ENABLE = 4,
+  TRACE_EVENT_ANALYSIS_DISABLE = 5,
+  TRACE_EVENT_ANALYSIS_CONFIG = 6,
+  TRACE_EVENT_RECORD_DATA_CONFIG = 7,
+  TRACE_EVENT_CUBIN_REGISTER = 8,
+  TRACE_EVENT_CUBIN_CACHE_REGISTER = 9,
+  TRACE_EVENT_CUBIN_UNREGISTER = 10,
+  TRACE_EVENT_MEMORY_REGISTER = 11,
+  TRACE_EVENT_MEMORY_UNREGISTER = 12,
+  TRACE_EVENT_SUBMEMORY_REGISTER = 13,
+  TRACE_EVENT_SUBMEMORY_UNREGISTER = 14,
+  TRACE_EVENT_MEMCPY_REGISTER = 15,
+  TRACE_EVENT_MEMSET_REGISTER = 16,
+  TRACE_EVENT_KERNEL_BEGIN = 17,
+  TRACE_EVENT_KERNEL_END = 18,
+  TRACE_EVENT_ANALYZE = 19,
+  TRACE_EVENT_ANALYSIS_BEGIN = 20,
+  TRACE_EVENT_ANALYSIS_END = 21,
+  TRACE_EVENT_FLUSH_THREAD = 22,
+  TRACE_EVENT_FLUSH = 23,
+  // Device memory copied by redshow_tool_dtoh_func during the preceding event
+  TRACE_EVENT_DTOH = 24,
+  TRACE_EVENT_COUNT = 25
+};
+
+/**
+ * @brief A gpu_patch_buffer_t that owns its records and aux dictionaries
+ */
+struct TraceBuffer {
+  gpu_patch_buffer_t buffer;
+  std::unique_ptr<u8[]> records;
+  std::unique_ptr<gpu_patch_aux_address_dict_t> aux;
+  std::unique_ptr<gpu_patch_aux_address_dict_t> torch_aux;
+
+  TraceBuffer() : buffer() {}
+
+  /**
+   * @brief Deep copy the first head_index records and the aux dictionaries of trace_data
+   */
+  void copy(const gpu_patch_buffer_t *trace_data);
+
+  // Bytes of valid records
+  size_t records_size() const { return record_size(buffer.type) * buffer.head_index; }
+
+  static size_t record_size(u32 type);
+};
+
+/**
+ * @brief Serialized payload of a single API call
+ */
+class TraceEvent {
+ public:
+  TraceEvent() : type(TRACE_EVENT_NONE), _offset(0) {}
+
+  explicit TraceEvent(TraceEventType type) : type(type), _offset(0) {}
+
+  template <typename T>
+  TraceEvent &put(T value) {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Fixed-size field");
+    auto *bytes = reinterpret_cast<const u8 *>(&value);
+    _payload.insert(_payload.end(), bytes, bytes + sizeof(T));
+    return *this;
+  }
+
+  TraceEvent &put_bytes(const void *data, u64 len);
+
+  TraceEvent &put_string(const char *str);
+
+  TraceEvent &put_buffer(const gpu_patch_buffer_t *trace_data);
+
+  template <typename T>
+  T get() {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Fixed-size field");
+    T value = T();
+    if (_offset + sizeof(T) <= _payload.size()) {
+      memcpy(&value, _payload.data() + _offset, sizeof(T));
+    }
+    _offset += sizeof(T);
+    return value;
+  }
+
+  // Returned pointer is valid until the event is overwritten
+  const u8 *get_bytes(u64 &len);
+
+  std::string get_string();
+
+  void get_buffer(TraceBuffer &trace_buffer);
+
+  // If a get went past the end of the payload
+  bool truncated() const { return _offset > _payload.size(); }
+
+  const Vector<u8> &payload() const { return _payload; }
+
+  Vector<u8> &payload() {
+    _offset = 0;
+    return _payload;
+  }
+
+ public:
+  TraceEventType type;
+
+ private:
+  Vector<u8> _payload;
+  size_t _offset;
+};
+
+class TraceWriter {
+ public:
+  TraceWriter() = default;
+
+  ~TraceWriter() { close(); }
+
+  bool open(const std::string &path);
+
+  void close();
+
+  // Checked by every capture hook without taking the lock
+  bool is_open() const { return _open.load(std::memory_order_acquire); }
+
+  // If the file was closed by a failed write since the last open
+  bool failed() const;
+
+  /**
+   * @brief Append an event, thread-safe
+   *
+   * On a short write the file is closed, so the capture ends at the last complete event.
+   */
+  bool write(const TraceEvent &event);
+
+ private:
+  FILE *_file = NULL;
+  // Cleared before _file is closed
+  std::atomic<bool> _open{false};
+  bool _failed = false;
+  mutable std::mutex _lock;
+};
+
+class TraceReader {
+ public:
+  TraceReader() = default;
+
+  ~TraceReader() { close(); }
+
+  /**
+   * @brief Open path and validate the header
+   */
+  bool open(const std::string &path);
+
+  void close();
+
+  u32 version() const { return _version; }
+
+  /**
+   * @brief Read the next event, false at the end of file or on a truncated event
+   */
+  bool read(TraceEvent &event);
+
+ private:
+  FILE *_file = NULL;
+  u32 _version = 0;
+};
+
+}  // namespace redshow
+
+#endif  // REDSHOW_REPLAY_TRACE_FILE_H
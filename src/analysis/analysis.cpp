@@ -4,4 +4,80 @@ namespace redshow {
 
 Trace::~Trace() {}
 
+void Analysis::warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access) {
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((access.active & (0x1u << j)) == 0) {
+      continue;
+    }
+    for (u32 m = 0; m < access.num_units; ++m) {
+      unit_access(kernel_id, host_op_id, access.thread_ids[j], access.access_kind,
+                  access.memories[j], access.pc, access.values[m][j], access.addresses[j], m,
+                  access.flags);
+    }
+  }
+}
+
+void Analysis::weighted_warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access,
+                                    u32 count) {
+  for (u32 i = 0; i < count; ++i) {
+    warp_access(kernel_id, host_op_id, access);
+  }
+}
+
+void AccessRanges::normalize() {
+  for (auto &iter : _ranges) {
+    iter.second.reads.normalize();
+    iter.second.writes.normalize();
+  }
+}
+
+MemoryAccessRanges &AccessRanges::ranges(const MemoryView &memory) {
+  auto iter = _ranges.find(memory.op_id);
+  if (iter == _ranges.end()) {
+    iter = _ranges.emplace(memory.op_id, MemoryAccessRanges(memory.op_id, memory.ctx_id)).first;
+  }
+  return iter->second;
+}
+
+void AnalysisDispatch::build(
+    const Map<redshow_analysis_type_t, std::shared_ptr<Analysis>> &analyses) {
+  *this = AnalysisDispatch();
+  bool unweighted[GPU_PATCH_TYPE_COUNT] = {};
+
+  for (auto &iter : analyses) {
+    auto *analysis = iter.second.get();
+    auto capabilities = analysis->capabilities();
+    AnalysisSubscriber subscriber(iter.first, analysis);
+
+    for (u32 i = 0; i < GPU_PATCH_TYPE_COUNT; ++i) {
+      if ((capabilities.trace_types & trace_type_mask(static_cast<GPUPatchType>(i))) == 0) {
+        continue;
+      }
+      traces[i].push_back(subscriber);
+      if (capabilities.accesses && capabilities.ranges_only) {
+        ranges[i].push_back(subscriber);
+      } else if (capabilities.accesses) {
+        accesses[i].push_back(subscriber);
+        values[i] = values[i] || capabilities.values;
+        thread_ids[i] = thread_ids[i] || capabilities.thread_ids;
+        unweighted[i] = unweighted[i] || !capabilities.weighted;
+      }
+    }
+
+    if (capabilities.block_exit) {
+      block_exits.push_back(subscriber);
+    }
+
+    for (u32 i = 0; i < OPERATION_TYPE_COUNT; ++i) {
+      if (capabilities.op_types & op_type_mask(static_cast<OperationType>(i))) {
+        op_callbacks[i].push_back(subscriber);
+      }
+    }
+  }
+
+  for (u32 i = 0; i < GPU_PATCH_TYPE_COUNT; ++i) {
+    weighted[i] = !accesses[i].empty() && !unweighted[i];
+  }
+}
+
 }  // namespace redshow
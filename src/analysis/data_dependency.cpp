@@ -244,6 +244,16 @@ void DataDependency::memcpy_op_callback(std::shared_ptr<Memcpy> op) {
   }
 }
 
+AnalysisCapabilities DataDependency::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = TRACE_TYPE_ADDRESS;
+  capabilities.accesses = true;
+  capabilities.ranges_only = true;
+  // Every operation is a node of the graph
+  capabilities.op_types = OP_TYPE_ALL;
+  return capabilities;
+}
+
 void DataDependency::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
   // Add a calling context node
   lock();
@@ -296,97 +306,40 @@ void DataDependency::block_exit(const ThreadId &thread_id) {
   // No operation
 }
 
-void DataDependency::merge_memory_range(Set<MemoryRange> &memory, const MemoryRange &memory_range) {
-  auto start = memory_range.start;
-  auto end = memory_range.end;
-
-  auto liter = memory.prev(memory_range);
-  if (liter != memory.end()) {
-    if (liter->end >= memory_range.start) {
-      if (liter->end < memory_range.end) {
-        // overlap and not covered
-        start = liter->start;
-        liter = memory.erase(liter);
-      } else {
-        // Fully covered
-        return;
-      }
-    } else {
-      liter++;
-    }
-  }
+void DataDependency::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           GPUPatchFlags flags) {
+  // Accesses are received as merged ranges by range_access
+}
 
-  bool range_delete = false;
-  auto riter = liter;
-  if (riter != memory.end()) {
-    if (riter->start <= memory_range.end) {
-      if (riter->end < memory_range.end) {
-        // overlap and not covered
-        range_delete = true;
-        riter = memory.erase(riter);
-      } else if (riter->start == memory_range.start) {
-        // riter->end >= memory_range.end
-        // Fully covered
-        return;
-      } else {
-        // riter->end >= memory_range.end
-        // Partial covered
-        end = riter->end;
-        riter = memory.erase(riter);
-      }
+void DataDependency::range_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                  const AccessRanges &ranges) {
+  for (auto &iter : ranges) {
+    auto &memory_ranges = iter.second;
+    // TODO(Keren): handle other memories
+    if (memory_ranges.op_id <= REDSHOW_MEMORY_HOST) {
+      continue;
     }
-  }
 
-  while (range_delete) {
-    range_delete = false;
-    if (riter != memory.end()) {
-      if (riter->start <= memory_range.end) {
-        if (riter->end < memory_range.end) {
-          // overlap and not covered
-          range_delete = true;
-        } else {
-          // Partial covered
-          end = riter->end;
-        }
-        riter = memory.erase(riter);
+    if (!memory_ranges.reads.empty()) {
+      auto &read_memory = _trace->read_memory[memory_ranges.op_id];
+      if (_configs[REDSHOW_ANALYSIS_READ_TRACE_IGNORE] == false) {
+        read_memory.merge(memory_ranges.reads);
+      } else if (read_memory.empty()) {
+        read_memory.add(memory_ranges.reads.front());
       }
     }
-  }
-
-  if (riter != memory.end()) {
-    // Hint for constant time insert: emplace(h, p) if p is before h
-    memory.emplace_hint(riter, start, end);
-  } else {
-    memory.emplace(start, end);
-  }
-}
-
-void DataDependency::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
-                           GPUPatchFlags flags) {
-  // TODO(Keren): handle other memories
-  if (memory.op_id <= REDSHOW_MEMORY_HOST) {
-    return;
-  }
-
-  auto &memory_range = memory.memory_range;
-  if (flags & GPU_PATCH_READ) {
-    if (_configs[REDSHOW_ANALYSIS_READ_TRACE_IGNORE] == false) {
-      merge_memory_range(_trace->read_memory[memory.op_id], memory_range);
-    } else if (_trace->read_memory[memory.op_id].empty()) {
-      _trace->read_memory[memory.op_id].insert(memory_range);
+    if (!memory_ranges.writes.empty()) {
+      _trace->write_memory[memory_ranges.op_id].merge(memory_ranges.writes);
     }
   }
-  if (flags & GPU_PATCH_WRITE) {
-    merge_memory_range(_trace->write_memory[memory.op_id], memory_range);
-  }
 }
 
 void DataDependency::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback) {}
 
-void DataDependency::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void DataDependency::flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback) {
   Map<i32, Map<i32, bool>> duplicate;
   analyze_duplicate(duplicate);
@@ -400,7 +353,7 @@ void DataDependency::flush(const std::string &output_dir, const LockableMap<u32,
     std::cout << "node: (" << node_id << ", " << node.type << ")" << std::endl;
     std::cout << "edge: ";
     if (_graph.incoming_edge_size(node_id) > 0) {
-      auto &incoming_edges = _graph.incoming_edges(node_id);
+      auto incoming_edges = _graph.incoming_edges(node_id);
 
       for (auto &edge_index : incoming_edges) {
         std::cout << edge_index.to << ",";
@@ -532,7 +485,7 @@ void DataDependency::dump(const std::string &output_dir, const Map<i32, Map<i32,
     auto v = vertice[node.ctx_id];
 
     if (_graph.incoming_edge_size(node.ctx_id) > 0) {
-      auto &incoming_edges = _graph.incoming_edges(node.ctx_id);
+      auto incoming_edges = _graph.incoming_edges(node.ctx_id);
 
       for (auto &edge_index : incoming_edges) {
         auto &incoming_node = _graph.node(edge_index.from);
@@ -42,6 +42,16 @@ void MemoryHeatmap::memory_op_callback(std::shared_ptr<Memory> op, bool is_subme
  
 }
 
+AnalysisCapabilities MemoryHeatmap::capabilities() const {
+  AnalysisCapabilities capabilities;
+  // Counts unit accesses of all traces, values are not used
+  capabilities.trace_types = TRACE_TYPE_ALL;
+  capabilities.accesses = true;
+  capabilities.weighted = true;
+  capabilities.op_types = op_type_mask(OPERATION_TYPE_MEMORY);
+  return capabilities;
+}
+
 void MemoryHeatmap::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
 // TODO(@Mao):
   lock();
@@ -61,7 +71,10 @@ void MemoryHeatmap::op_callback(OperationPtr op, bool is_submemory /* default =
 void MemoryHeatmap::analysis_begin(u32 cpu_thread, i32 kernel_id, u64 host_op_id, u32 stream_id,
                                   u32 cubin_id, u32 mod_id, GPUPatchType type, void* aux) {
     gpu_patch_buffer_t* buffer = static_cast<gpu_patch_buffer_t*>(aux);
+    // Traces of different kernels are analyzed by concurrent async workers
+    lock();
     _total_access += buffer->size;
+    unlock();
 
 }
 
@@ -80,7 +93,8 @@ void MemoryHeatmap::block_exit(const ThreadId &thread_id) {
 
 }
 
-void MemoryHeatmap::update_heatmap_list(u64 op_id, MemoryRange memory_range, uint32_t unit_size) {
+void MemoryHeatmap::update_heatmap_list(u64 op_id, MemoryRange memory_range, uint32_t unit_size,
+                                        int count) {
   auto &heatmap = _heatmap_list[op_id];
 
   auto memory = _memories.at(op_id);
@@ -88,29 +102,21 @@ void MemoryHeatmap::update_heatmap_list(u64 op_id, MemoryRange memory_range, uin
   auto end = (memory_range.end - memory->memory_range.start) / unit_size;
 
   for (int i = start; i < end; i++) {
-    *(heatmap.array + i) += 1;
+    *(heatmap.array + i) += count;
     
   }
   
 }
 
 
-// not a whole buffer, but a part buffer in a memory object
-void MemoryHeatmap::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
-                           GPUPatchFlags flags) {
-
-if (memory.op_id <= REDSHOW_MEMORY_HOST) {
-    return;
-  }
-
+void MemoryHeatmap::heatmap_access(const MemoryView &memory, uint32_t unit_size, int count) {
   auto &memory_range = memory.memory_range;
   // printf("op_id:%lu, start:%lu, end:%lu, len:%lu\n", memory.op_id, memory_range.start, memory_range.end, memory.len);
 
   auto heatmap = _heatmap_list.find(memory.op_id);
   if (heatmap == _heatmap_list.end()) {
     auto object = _memories.at(memory.op_id);
-    size_t len = object->len / access_kind.unit_size;
+    size_t len = object->len / unit_size;
     
     int* arr = (int*) malloc(sizeof(int) * len);
     memset(arr, 0, sizeof(int) * len);
@@ -120,19 +126,72 @@ if (memory.op_id <= REDSHOW_MEMORY_HOST) {
     _heatmap_list[memory.op_id] = heatmap;
   }
   
-  update_heatmap_list(memory.op_id, memory_range, access_kind.unit_size);
+  update_heatmap_list(memory.op_id, memory_range, unit_size, count);
+}
+
+
+// not a whole buffer, but a part buffer in a memory object
+void MemoryHeatmap::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           GPUPatchFlags flags) {
+
+if (memory.op_id <= REDSHOW_MEMORY_HOST) {
+    return;
+  }
 
+  lock();
+  heatmap_access(memory, access_kind.unit_size, 1);
+  unlock();
+
+}
+
+
+void MemoryHeatmap::warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access) {
+  weighted_warp_access(kernel_id, host_op_id, access, 1);
+}
+
+
+void MemoryHeatmap::weighted_warp_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                         const WarpAccess &access, u32 count) {
+  // Every unit access counts the whole object once, so count the units of each object in the
+  // warp first. A warp touches only a few objects.
+  const MemoryView *memories[GPU_PATCH_WARP_SIZE];
+  u32 units[GPU_PATCH_WARP_SIZE];
+  u32 num_memories = 0;
+
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((access.active & (0x1u << j)) == 0 || access.memories[j].op_id <= REDSHOW_MEMORY_HOST) {
+      continue;
+    }
+
+    u32 i = 0;
+    while (i < num_memories && memories[i]->op_id != access.memories[j].op_id) {
+      ++i;
+    }
+    if (i == num_memories) {
+      memories[num_memories] = &access.memories[j];
+      units[num_memories] = 0;
+      ++num_memories;
+    }
+    units[i] += access.num_units;
+  }
+
+  lock();
+  for (u32 i = 0; i < num_memories; ++i) {
+    heatmap_access(*memories[i], access.access_kind.unit_size, units[i] * count);
+  }
+  unlock();
 }
 
   // Flush
 void MemoryHeatmap::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback) {
 
 }
 
 
-void MemoryHeatmap::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void MemoryHeatmap::flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback) {
   
   std::ofstream out(output_dir + "memory_heatmap" + ".csv");
@@ -213,6 +213,15 @@ void MemoryLiveness::memory_operation_register(
 
 }
 
+AnalysisCapabilities MemoryLiveness::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = TRACE_TYPE_ADDRESS;
+  capabilities.accesses = true;
+  capabilities.ranges_only = true;
+  capabilities.op_types = OP_TYPE_ALL;
+  return capabilities;
+}
+
 void MemoryLiveness::op_callback(OperationPtr op, bool is_submemory) {
   lock();
   
@@ -503,25 +512,44 @@ void MemoryLiveness::block_exit(const ThreadId &thread_id) {}
 
 void MemoryLiveness::unit_access(
   i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-  const Memory &memory, u64 pc, u64 value, u64 addr, u32 index, GPUPatchFlags flags
+  const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index, GPUPatchFlags flags
 ) {
+  // Accesses are received as merged ranges by range_access
+}
+
+void MemoryLiveness::range_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                  const AccessRanges &ranges) {
 #ifndef REDSHOW_GPU_ANALYSIS
-  if (memory.op_id <= REDSHOW_MEMORY_HOST) {
-    return;
-  }
+  for (auto &iter : ranges) {
+    auto &memory_ranges = iter.second;
+    if (memory_ranges.op_id <= REDSHOW_MEMORY_HOST) {
+      continue;
+    }
 
-  if (!_trace->access_memory.has(memory.op_id)) {
-    _trace->access_memory.emplace(memory.op_id, true);
-  }
-  
-#ifdef REDSHOW_TORCH_SUBMEMORY_ANALYSIS
-  auto iter = _sub_addresses_map.prev(memory.memory_range.start); 
+    if (!_trace->access_memory.has(memory_ranges.op_id)) {
+      _trace->access_memory.emplace(memory_ranges.op_id, true);
+    }
 
-  // memory_operation_register(riter->second, host_op_id, ACCESS, true);
-  if (!_trace->access_submemory.has(iter->second)) {
-    _trace->access_submemory.emplace(iter->second, true);
-  }
+#ifdef REDSHOW_TORCH_SUBMEMORY_ANALYSIS
+    for (auto *interval_set : {&memory_ranges.reads, &memory_ranges.writes}) {
+      for (auto &range : *interval_set) {
+        // A merged range may cover several submemories
+        auto iter = _sub_addresses_map.prev(range.start);
+        if (iter == _sub_addresses_map.end()) {
+          iter = _sub_addresses_map.lower_bound(range.start);
+        }
+        for (; iter != _sub_addresses_map.end() && iter->first < range.end; ++iter) {
+          if (!_trace->access_submemory.has(iter->second)) {
+            _trace->access_submemory.emplace(iter->second, true);
+          }
+        }
+      }
+    }
 #endif
+  }
+#else
+  // Accesses are analyzed on the GPU
+  (void)ranges;
 #endif
 }
 
@@ -869,13 +897,13 @@ void MemoryLiveness::output_torch_libunwind_backtrace(std::string filename) {
 void MemoryLiveness::flush_thread(
   u32 cpu_thread,
   const std::string &output_dir,
-  const LockableMap<u32, Cubin> &cubins,
+  const CubinMap &cubins,
   redshow_record_data_callback_func record_data_callback
 ) {}
 
 void MemoryLiveness::flush(
   const std::string &output_dir,
-  const LockableMap<u32, Cubin> &cubins,
+  const CubinMap &cubins,
   redshow_record_data_callback_func record_data_callback
 ) 
 {
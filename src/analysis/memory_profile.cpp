@@ -256,6 +256,17 @@ void MemoryProfile::kernel_op_callback(std::shared_ptr<Kernel> op) {
 }
 
 
+AnalysisCapabilities MemoryProfile::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = TRACE_TYPE_ADDRESS;
+  capabilities.accesses = true;
+  capabilities.ranges_only = true;
+  capabilities.op_types = op_type_mask(OPERATION_TYPE_KERNEL) |
+                          op_type_mask(OPERATION_TYPE_MEMORY) |
+                          op_type_mask(OPERATION_TYPE_MEMFREE);
+  return capabilities;
+}
+
 void MemoryProfile::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
 // TODO(@Mao):
   lock();
@@ -309,99 +320,36 @@ void MemoryProfile::block_exit(const ThreadId &thread_id) {
 }
 
 
-void MemoryProfile::merge_memory_range(Set<MemoryRange> &memory, const MemoryRange &memory_range) {
-  auto start = memory_range.start;
-  auto end = memory_range.end;
-
-  auto liter = memory.prev(memory_range);
-  if (liter != memory.end()) { // @Mao: xxx.end is not the last iterator but the next of the last iterator and has no meaning
-    if (liter->end >= memory_range.start) {
-      if (liter->end < memory_range.end) {
-        // overlap and not covered
-        start = liter->start;
-        liter = memory.erase(liter);
-      } else {
-        // Fully covered
-        return;
-      }
-    } else {
-      liter++;
-    }
-  }
-
-  bool range_delete = false;
-  auto riter = liter;
-  if (riter != memory.end()) {
-    if (riter->start <= memory_range.end) {
-      if (riter->end < memory_range.end) {
-        // overlap and not covered
-        range_delete = true;
-        riter = memory.erase(riter);
-      } else if (riter->start == memory_range.start) {
-        // riter->end >= memory_range.end
-        // Fully covered
-        return;
-      } else {
-        // riter->end >= memory_range.end
-        // Partial covered
-        end = riter->end;
-        riter = memory.erase(riter);
-      }
-    }
-  }
-
-  while (range_delete) {
-    range_delete = false;
-    if (riter != memory.end()) {
-      if (riter->start <= memory_range.end) {
-        if (riter->end < memory_range.end) {
-          // overlap and not covered
-          range_delete = true;
-        } else {
-          // Partial covered
-          end = riter->end;
-        }
-        riter = memory.erase(riter);
-      }
-    }
-  }
-
-  if (riter != memory.end()) {
-    // Hint for constant time insert: emplace(h, p) if p is before h
-    memory.emplace_hint(riter, start, end);
-  } else {
-    memory.emplace(start, end);
-  }
-}
-
-
 // not a whole buffer, but a part buffer in a memory object
 void MemoryProfile::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id, const AccessKind &access_kind,
-                           const Memory &memory, u64 pc, u64 value, u64 addr, u32 index,
+                           const MemoryView &memory, u64 pc, u64 value, u64 addr, u32 index,
                            GPUPatchFlags flags) {
+  // Accesses are received as merged ranges by range_access
+}
 
-if (memory.op_id <= REDSHOW_MEMORY_HOST) {
-    return;
-  }
-
-  auto &memory_range = memory.memory_range;
+void MemoryProfile::range_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                 const AccessRanges &ranges) {
+  // for access trace, no need to identify read or write
+  for (auto &iter : ranges) {
+    auto &memory_ranges = iter.second;
+    if (memory_ranges.op_id <= REDSHOW_MEMORY_HOST) {
+      continue;
+    }
 
-  if (_trace->access_memory[memory.op_id].empty()) {
-    _trace->access_memory[memory.op_id].insert(memory_range);
-  } else {
-    merge_memory_range(_trace->access_memory[memory.op_id], memory_range);
+    auto &access_memory = _trace->access_memory[memory_ranges.op_id];
+    access_memory.merge(memory_ranges.reads);
+    access_memory.merge(memory_ranges.writes);
   }
-
 }
 
   // Flush
 void MemoryProfile::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback) {
 
 }
 
-void MemoryProfile::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void MemoryProfile::flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback) {
   
   std::ofstream out(output_dir + "memory_profile" + ".csv");
@@ -2,12 +2,22 @@
 
 #include <cstring>
 
+#include "common/rcu.h"
 #include "common/vector.h"
 #include "operation/kernel.h"
 #include "redshow.h"
 
 namespace redshow {
 
+AnalysisCapabilities SpatialRedundancy::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = trace_type_mask(GPU_PATCH_TYPE_DEFAULT);
+  capabilities.accesses = true;
+  capabilities.values = true;
+  capabilities.weighted = true;
+  return capabilities;
+}
+
 void SpatialRedundancy::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
   // Nothing
 }
@@ -42,7 +52,7 @@ void SpatialRedundancy::block_exit(const ThreadId &thread_id) {
 }
 
 void SpatialRedundancy::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id,
-                                    const AccessKind &access_kind, const Memory &memory, u64 pc,
+                                    const AccessKind &access_kind, const MemoryView &memory, u64 pc,
                                     u64 value, u64 addr, u32 index, GPUPatchFlags flags) {
   addr += index * access_kind.unit_size / 8;
   
@@ -59,13 +69,54 @@ void SpatialRedundancy::unit_access(i32 kernel_id, u64 host_op_id, const ThreadI
   }
 }
 
+void SpatialRedundancy::warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access) {
+  weighted_warp_access(kernel_id, host_op_id, access, 1);
+}
+
+void SpatialRedundancy::weighted_warp_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                             const WarpAccess &access, u32 count) {
+  u64 units = static_cast<u64>(__builtin_popcount(access.active)) * access.num_units * count;
+
+  if (access.flags & GPU_PATCH_READ) {
+    update_spatial_trace(access, count, _trace->read_spatial_trace);
+    _trace->read_pc_count[access.pc] += units;
+  }
+
+  if (access.flags & GPU_PATCH_WRITE) {
+    update_spatial_trace(access, count, _trace->write_spatial_trace);
+    _trace->write_pc_count[access.pc] += units;
+  }
+}
+
+void SpatialRedundancy::update_spatial_trace(const WarpAccess &access, u32 count,
+                                             SpatialTrace &spatial_trace) {
+  // Lanes usually hit the same memory object, so only look up {value: count} on changes
+  Map<u64, u64> *value_count = NULL;
+  u64 memory_op_id = 0;
+
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((access.active & (0x1u << j)) == 0) {
+      continue;
+    }
+
+    if (value_count == NULL || access.memories[j].op_id != memory_op_id) {
+      memory_op_id = access.memories[j].op_id;
+      value_count = &spatial_trace[std::make_pair(memory_op_id, access.access_kind)][access.pc];
+    }
+
+    for (u32 m = 0; m < access.num_units; ++m) {
+      (*value_count)[access.values[m][j]] += count;
+    }
+  }
+}
+
 void SpatialRedundancy::update_spatial_trace(u64 pc, u64 value, u64 memory_op_id,
                                              AccessKind access_kind, SpatialTrace &spatial_trace) {
   spatial_trace[std::make_pair(memory_op_id, access_kind)][pc][value] += 1;
 }
 
 void SpatialRedundancy::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                                     const LockableMap<u32, Cubin> &cubins,
+                                     const CubinMap &cubins,
                                      redshow_record_data_callback_func record_data_callback) {
   u32 pc_views_limit = 0;
   u32 mem_views_limit = 0;
@@ -101,9 +152,9 @@ void SpatialRedundancy::flush_thread(u32 cpu_thread, const std::string &output_d
     u64 kernel_count = 0;
     SpatialStatistics read_spatial_stats;
     SpatialStatistics write_spatial_stats;
-    cubins.lock();
-    auto &symbols = cubins.at(cubin_id).symbols.at(mod_id);
-    cubins.unlock();
+    // Keeps the cubin alive if it is unregistered meanwhile
+    RcuReadLock read_lock;
+    auto &symbols = cubins.find(cubin_id)->symbols.at(mod_id);
 
     record_data.analysis_type = REDSHOW_ANALYSIS_SPATIAL_REDUNDANCY;
     // read
@@ -171,7 +222,7 @@ void SpatialRedundancy::flush_thread(u32 cpu_thread, const std::string &output_d
   delete[] record_data.views;
 }
 
-void SpatialRedundancy::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void SpatialRedundancy::flush(const std::string &output_dir, const CubinMap &cubins,
                               redshow_record_data_callback_func record_data_callback) {}
 
 void SpatialRedundancy::record_spatial_trace(u32 pc_views_limit, u32 mem_views_limit,
@@ -2,11 +2,23 @@
 
 #include <cstring>
 
+#include "common/rcu.h"
 #include "operation/kernel.h"
 #include "redshow.h"
 
 namespace redshow {
 
+AnalysisCapabilities TemporalRedundancy::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = trace_type_mask(GPU_PATCH_TYPE_DEFAULT);
+  capabilities.accesses = true;
+  capabilities.values = true;
+  capabilities.thread_ids = true;
+  // Temporal records of a block are dropped when it exits
+  capabilities.block_exit = true;
+  return capabilities;
+}
+
 void TemporalRedundancy::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
   // Nothing
 }
@@ -43,8 +55,8 @@ void TemporalRedundancy::block_exit(const ThreadId &thread_id) {
 }
 
 void TemporalRedundancy::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id,
-                                     const AccessKind &access_kind, const Memory &memory, u64 pc,
-                                     u64 value, u64 addr, u32 index, GPUPatchFlags flags) {
+                                     const AccessKind &access_kind, const MemoryView &memory,
+                                     u64 pc, u64 value, u64 addr, u32 index, GPUPatchFlags flags) {
   addr += index * access_kind.unit_size / 8;
 
   if (flags & GPU_PATCH_READ) {
@@ -62,8 +74,23 @@ void TemporalRedundancy::unit_access(i32 kernel_id, u64 host_op_id, const Thread
   }
 }
 
+void TemporalRedundancy::warp_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                     const WarpAccess &access) {
+  u64 units = static_cast<u64>(__builtin_popcount(access.active)) * access.num_units;
+
+  if (access.flags & GPU_PATCH_READ) {
+    update_temporal_trace(access, _trace->read_temporal_trace, _trace->read_pc_pairs);
+    _trace->read_pc_count[access.pc] += units;
+  }
+
+  if (access.flags & GPU_PATCH_WRITE) {
+    update_temporal_trace(access, _trace->write_temporal_trace, _trace->write_pc_pairs);
+    _trace->write_pc_count[access.pc] += units;
+  }
+}
+
 void TemporalRedundancy::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                                      const LockableMap<u32, Cubin> &cubins,
+                                      const CubinMap &cubins,
                                       redshow_record_data_callback_func record_data_callback) {
   u32 pc_views_limit = 0;
   u32 mem_views_limit = 0;
@@ -99,9 +126,9 @@ void TemporalRedundancy::flush_thread(u32 cpu_thread, const std::string &output_
     u64 kernel_count = 0;
     TemporalStatistics read_temporal_stats;
     TemporalStatistics write_temporal_stats;
-    cubins.lock();
-    auto &symbols = cubins.at(cubin_id).symbols.at(mod_id);
-    cubins.unlock();
+    // Keeps the cubin alive if it is unregistered meanwhile
+    RcuReadLock read_lock;
+    auto &symbols = cubins.find(cubin_id)->symbols.at(mod_id);
 
     record_data.analysis_type = REDSHOW_ANALYSIS_TEMPORAL_REDUNDANCY;
     // Read
@@ -168,7 +195,7 @@ void TemporalRedundancy::flush_thread(u32 cpu_thread, const std::string &output_
   delete[] record_data.views;
 }
 
-void TemporalRedundancy::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void TemporalRedundancy::flush(const std::string &output_dir, const CubinMap &cubins,
                                redshow_record_data_callback_func record_data_callback) {}
 
 void TemporalRedundancy::update_temporal_trace(u64 pc, ThreadId thread_id, u64 addr, u64 value,
@@ -199,6 +226,36 @@ void TemporalRedundancy::update_temporal_trace(u64 pc, ThreadId thread_id, u64 a
   }
 }
 
+void TemporalRedundancy::update_temporal_trace(const WarpAccess &access,
+                                               TemporalTrace &temporal_trace, PCPairs &pc_pairs) {
+  auto pc = access.pc;
+  auto unit_bytes = access.access_kind.unit_size >> 3;
+
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((access.active & (0x1u << j)) == 0) {
+      continue;
+    }
+
+    // {address : <pc, value>} of the current thread
+    auto &thread_trace = temporal_trace[access.thread_ids[j]];
+    for (u32 m = 0; m < access.num_units; ++m) {
+      auto addr = access.addresses[j] + m * unit_bytes;
+      auto value = access.values[m][j];
+      auto m_it = thread_trace.find(addr);
+      if (m_it == thread_trace.end()) {
+        thread_trace.emplace(addr, std::make_pair(pc, value));
+      } else {
+        auto prev_pc = m_it->second.first;
+        auto prev_value = m_it->second.second;
+        if (prev_value == value) {
+          pc_pairs[pc][prev_pc][std::make_pair(prev_value, access.access_kind)] += 1;
+        }
+        m_it->second = std::make_pair(pc, value);
+      }
+    }
+  }
+}
+
 void TemporalRedundancy::record_temporal_trace(u32 pc_views_limit, u32 mem_views_limit,
                                                PCPairs &pc_pairs, PCAccessCount &pc_access_count,
                                                TemporalStatistics &temporal_stats,
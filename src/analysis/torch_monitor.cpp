@@ -13,6 +13,14 @@
 namespace redshow {
 
 
+AnalysisCapabilities TorchMonitor::capabilities() const {
+  AnalysisCapabilities capabilities;
+  // Only kernel auxiliary data is used, accesses are ignored
+  capabilities.trace_types = TRACE_TYPE_ADDRESS;
+  capabilities.op_types = OP_TYPE_ALL;
+  return capabilities;
+}
+
 void TorchMonitor::op_callback(OperationPtr op, bool is_submemory /* default = false */) {
   // Add a calling context node
   lock();
@@ -157,15 +165,19 @@ void TorchMonitor::block_exit(const ThreadId &thread_id) {
 }
 
 void TorchMonitor::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id,
-                               const AccessKind &access_kind, const Memory &memory, u64 pc,
+                               const AccessKind &access_kind, const MemoryView &memory, u64 pc,
                                u64 value, u64 addr, u32 index, GPUPatchFlags flags) {
 }
 
+void TorchMonitor::warp_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                               const WarpAccess & /* access */) {
+}
+
 void TorchMonitor::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                            const LockableMap<u32, Cubin> &cubins,
+                            const CubinMap &cubins,
                             redshow_record_data_callback_func record_data_callback) {}
 
-void TorchMonitor::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void TorchMonitor::flush(const std::string &output_dir, const CubinMap &cubins,
                      redshow_record_data_callback_func record_data_callback) {
   std::ofstream output(output_dir + "memory_info.txt");
   output << "GPU memory peak: " << _memory_peak << " B" << std::endl;
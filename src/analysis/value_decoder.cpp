@@ -0,0 +1,101 @@
+#include "analysis/value_decoder.h"
+
+#include <cstring>
+
+#include "common/simd.h"
+
+namespace redshow {
+
+static const u32 DECODE_UNIT_SIZES = 4;
+static const u32 DECODE_NUM_UNITS = 5;
+
+ValueDecoder::ValueDecoder(const AccessKind &access_kind, int decimal_degree_f32,
+                           int decimal_degree_f64)
+    : _decode(select(access_kind)),
+      _unit_kind(access_kind.unit_size, access_kind.unit_size, access_kind.data_type),
+      _mask(0xffffffffffffffff),
+      _decimal_degree_f32(decimal_degree_f32),
+      _decimal_degree_f64(decimal_degree_f64) {
+  // Same as value_to_basic_type
+  if (access_kind.data_type == REDSHOW_DATA_FLOAT) {
+    if (access_kind.unit_size == 32) {
+      _mask = value_to_float(_mask, decimal_degree_f32);
+    } else if (access_kind.unit_size == 64) {
+      _mask = value_to_double(_mask, decimal_degree_f64);
+    }
+  }
+}
+
+template <typename T, u32 NUM_UNITS>
+void ValueDecoder::decode_units(const ValueDecoder &decoder, const gpu_patch_record_t *record,
+                                WarpAccess &warp_access) {
+  const u64 mask = decoder._mask;
+  auto &simd = simd_warp_functions();
+  for (u32 m = 0; m < NUM_UNITS; ++m) {
+    auto *values = warp_access.values[m];
+    if (sizeof(T) == sizeof(u32)) {
+      simd.extract_u32(record->value[0], m * sizeof(T), mask, values);
+    } else if (sizeof(T) == sizeof(u64)) {
+      simd.extract_u64(record->value[0], m * sizeof(T), mask, values);
+    } else {
+      for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+        T value;
+        memcpy(&value, &record->value[j][m * sizeof(T)], sizeof(T));
+        values[j] = static_cast<u64>(value) & mask;
+      }
+    }
+  }
+}
+
+void ValueDecoder::decode_generic(const ValueDecoder &decoder, const gpu_patch_record_t *record,
+                                  WarpAccess &warp_access) {
+  auto unit_kind = decoder._unit_kind;
+  uint32_t byte_size = unit_kind.unit_size >> 3u;
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((warp_access.active & (0x1u << j)) == 0) {
+      continue;
+    }
+
+    for (u32 m = 0; m < warp_access.num_units; m++) {
+      uint64_t value = 0;
+      memcpy(&value, &record->value[j][m * byte_size], byte_size);
+      // The 7th digit in float number's decimal part is partial valid, so we set the deault
+      // approx level to REDSHOW_APPROX_MIN.
+      warp_access.values[m][j] = unit_kind.value_to_basic_type(
+          value, decoder._decimal_degree_f32, decoder._decimal_degree_f64);
+    }
+  }
+}
+
+ValueDecoder::DecodeFunction ValueDecoder::select(const AccessKind &access_kind) {
+  // <log2(unit_size / 8), log2(num_units)>, NULL if the vector is larger than 128 bits
+  static const DecodeFunction decode_functions[DECODE_UNIT_SIZES][DECODE_NUM_UNITS] = {
+      {decode_units<u8, 1>, decode_units<u8, 2>, decode_units<u8, 4>, decode_units<u8, 8>,
+       decode_units<u8, 16>},
+      {decode_units<u16, 1>, decode_units<u16, 2>, decode_units<u16, 4>, decode_units<u16, 8>,
+       NULL},
+      {decode_units<u32, 1>, decode_units<u32, 2>, decode_units<u32, 4>, NULL, NULL},
+      {decode_units<u64, 1>, decode_units<u64, 2>, NULL, NULL, NULL}};
+
+  auto unit_size = access_kind.unit_size;
+  auto vec_size = access_kind.vec_size;
+  if (unit_size < 8 || unit_size > 64 || (unit_size & (unit_size - 1)) != 0 ||
+      vec_size % unit_size != 0) {
+    return decode_generic;
+  }
+
+  auto num_units = vec_size / unit_size;
+  if (num_units == 0 || (num_units & (num_units - 1)) != 0) {
+    return decode_generic;
+  }
+
+  u32 unit_index = __builtin_ctz(unit_size >> 3);
+  u32 num_units_index = __builtin_ctz(num_units);
+  if (num_units_index >= DECODE_NUM_UNITS ||
+      decode_functions[unit_index][num_units_index] == NULL) {
+    return decode_generic;
+  }
+  return decode_functions[unit_index][num_units_index];
+}
+
+}  // namespace redshow
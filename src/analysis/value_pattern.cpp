@@ -9,6 +9,7 @@
 #include <tuple>
 #include <utility>
 
+#include "common/simd.h"
 #include "common/utils.h"
 #include "common/vector.h"
 #include "operation/kernel.h"
@@ -16,6 +17,15 @@
 
 namespace redshow {
 
+AnalysisCapabilities ValuePattern::capabilities() const {
+  AnalysisCapabilities capabilities;
+  capabilities.trace_types = trace_type_mask(GPU_PATCH_TYPE_DEFAULT);
+  capabilities.accesses = true;
+  capabilities.values = true;
+  capabilities.weighted = true;
+  return capabilities;
+}
+
 void ValuePattern::op_callback(OperationPtr operation, bool is_submemory /* default = false */) {
   // Do nothing
 }
@@ -51,16 +61,16 @@ void ValuePattern::block_exit(const ThreadId &thread_id) {
 }
 
 void ValuePattern::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &thread_id,
-                               const AccessKind &access_kind, const Memory &memory, u64 pc,
+                               const AccessKind &access_kind, const MemoryView &memory, u64 pc,
                                u64 value, u64 addr, u32 index, GPUPatchFlags flags) {
   addr += index * access_kind.unit_size / 8;
   if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-    // If unknown, try each data type
+    // If unknown, try each data type. addr already points at the unit, so do not offset it again.
     auto enum_access_kind = access_kind;
     enum_access_kind.data_type = REDSHOW_DATA_FLOAT;
-    unit_access(kernel_id, host_op_id, thread_id, enum_access_kind, memory, pc, value, addr, index, flags);
+    unit_access(kernel_id, host_op_id, thread_id, enum_access_kind, memory, pc, value, addr, 0, flags);
     enum_access_kind.data_type = REDSHOW_DATA_INT;
-    unit_access(kernel_id, host_op_id, thread_id, enum_access_kind, memory, pc, value, addr, index, flags);
+    unit_access(kernel_id, host_op_id, thread_id, enum_access_kind, memory, pc, value, addr, 0, flags);
 
     return;
   }
@@ -100,8 +110,95 @@ void ValuePattern::unit_access(i32 kernel_id, u64 host_op_id, const ThreadId &th
   }
 }
 
+void ValuePattern::warp_access(i32 kernel_id, u64 host_op_id, const WarpAccess &access) {
+  weighted_warp_access(kernel_id, host_op_id, access, 1);
+}
+
+void ValuePattern::weighted_warp_access(i32 /* kernel_id */, u64 /* host_op_id */,
+                                        const WarpAccess &access, u32 count) {
+  if (access.access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
+    // If unknown, try each data type
+    auto enum_access_kind = access.access_kind;
+    enum_access_kind.data_type = REDSHOW_DATA_FLOAT;
+    update_value_dist(enum_access_kind, access, count);
+    enum_access_kind.data_type = REDSHOW_DATA_INT;
+    update_value_dist(enum_access_kind, access, count);
+  } else {
+    update_value_dist(access.access_kind, access, count);
+  }
+}
+
+void ValuePattern::update_value_dist(const AccessKind &access_kind, const WarpAccess &access,
+                                     u32 count) {
+  auto unit_bytes = access_kind.unit_size >> 3;
+  bool approx = false;
+  int decimal_degree_f32;
+  int decimal_degree_f64;
+
+  if (access_kind.data_type == REDSHOW_DATA_FLOAT) {
+    redshow_approx_get(&decimal_degree_f32, &decimal_degree_f64);
+
+    if (decimal_degree_f32 == VALID_FLOAT_DIGITS) {
+      vp_approx_level_config(REDSHOW_APPROX_MIN, decimal_degree_f32, decimal_degree_f64);
+      approx = access_kind.unit_size == 32 || access_kind.unit_size == 64;
+    }
+  }
+
+  // Truncate the units of all lanes at once
+  const u64(*values)[GPU_PATCH_WARP_SIZE] = access.values;
+  u64 approx_values[WARP_ACCESS_MAX_UNITS][GPU_PATCH_WARP_SIZE];
+  if (approx) {
+    auto approx_mask = access_kind.unit_size == 32
+                           ? value_to_float(0xffffffffffffffff, decimal_degree_f32)
+                           : value_to_double(0xffffffffffffffff, decimal_degree_f64);
+    auto &simd = simd_warp_functions();
+    for (u32 m = 0; m < access.num_units; ++m) {
+      simd.mask(access.values[m], approx_mask, approx_values[m]);
+    }
+    values = approx_values;
+  }
+
+  // Lanes usually hit the same memory object, so only look up the distributions on changes
+  ItemsValueCount *r_items = NULL;
+  ItemsValueCount *w_items = NULL;
+  u64 memory_op_id = 0;
+  bool looked_up = false;
+
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((access.active & (0x1u << j)) == 0) {
+      continue;
+    }
+
+    auto &memory = access.memories[j];
+    if (!looked_up || memory.op_id != memory_op_id) {
+      looked_up = true;
+      memory_op_id = memory.op_id;
+      if (access.flags & GPU_PATCH_READ) {
+        r_items = &_trace->r_value_dist[memory][access_kind];
+      }
+      if (access.flags & GPU_PATCH_WRITE) {
+        w_items = &_trace->w_value_dist[memory][access_kind];
+      }
+    }
+
+    for (u32 m = 0; m < access.num_units; ++m) {
+      auto addr = access.addresses[j] + m * unit_bytes;
+      auto offset = (addr - memory.memory_range.start) / unit_bytes;
+      auto value = values[m][j];
+
+      if (r_items != NULL) {
+        (*r_items)[offset][value] += count;
+      }
+
+      if (w_items != NULL) {
+        (*w_items)[offset][value] += count;
+      }
+    }
+  }
+}
+
 void ValuePattern::flush_thread(u32 cpu_thread, const std::string &output_dir,
-                                const LockableMap<u32, Cubin> &cubins,
+                                const CubinMap &cubins,
                                 redshow_record_data_callback_func record_data_callback) {
   if (!this->_kernel_trace.has(cpu_thread)) {
     return;
@@ -191,7 +288,7 @@ void ValuePattern::check_pattern_for_value_dist(ValueDist &value_dist, std::ofst
   }
 }
 
-void ValuePattern::flush(const std::string &output_dir, const LockableMap<u32, Cubin> &cubins,
+void ValuePattern::flush(const std::string &output_dir, const CubinMap &cubins,
                          redshow_record_data_callback_func record_data_callback) {}
 
 /**This function is used to check how many significant bits are zeros.
@@ -0,0 +1,41 @@
+#include "bench/peak_rss.h"
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <fstream>
+#include <string>
+
+namespace redshow {
+
+void reset_peak_rss() {
+  // Supported since Linux 4.0, otherwise we report the peak of the process
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs.good()) {
+    clear_refs << "5";
+  }
+}
+
+u64 peak_rss_kb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6));
+    }
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+u64 heap_bytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  return mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace redshow
@@ -0,0 +1,156 @@
+#include "bench/trace_generator.h"
+
+namespace redshow {
+
+const char *trace_access_pattern_name(TraceAccessPattern pattern) {
+  switch (pattern) {
+    case TRACE_ACCESS_COALESCED:
+      return "coalesced";
+    case TRACE_ACCESS_STRIDED:
+      return "strided";
+    case TRACE_ACCESS_RANDOM:
+      return "random";
+    case TRACE_ACCESS_WARP_UNIFORM:
+      return "warp_uniform";
+    default:
+      return "unknown";
+  }
+}
+
+const char *trace_value_redundancy_name(TraceValueRedundancy redundancy) {
+  switch (redundancy) {
+    case TRACE_VALUE_LOW:
+      return "low";
+    case TRACE_VALUE_HIGH:
+      return "high";
+    default:
+      return "unknown";
+  }
+}
+
+TraceGenerator::TraceGenerator(const TraceGeneratorConfig &config)
+    : _config(config), _rng(config.seed) {
+  _config.num_memories = MAX2(_config.num_memories, 1u);
+  _config.num_pcs = MAX2(_config.num_pcs, 1u);
+  _config.repeats = MAX2(_config.repeats, 1u);
+  _config.access_size = MIN2(MAX2(_config.access_size, 1u), GPU_PATCH_MAX_ACCESS_SIZE);
+  // Every lane access stays inside its memory object
+  _config.memory_size = MAX2(_config.memory_size, static_cast<u64>(_config.access_size));
+  _config.memory_size -= _config.memory_size % _config.access_size;
+
+  // Leave a gap after each object such that neighbors never merge
+  u64 slot = (_config.memory_size + 4095) / 4096 * 4096 * 2;
+  for (u32 i = 0; i < _config.num_memories; ++i) {
+    u64 start = TRACE_GENERATOR_ADDRESS_START + i * slot;
+    _memories.emplace_back(start, start + _config.memory_size);
+  }
+}
+
+u64 TraceGenerator::lane_address(u32 record, u32 lane) {
+  auto access_size = _config.access_size;
+  auto memory_size = _config.memory_size;
+
+  if (_config.pattern == TRACE_ACCESS_RANDOM) {
+    auto &memory = _memories[_rng() % _memories.size()];
+    return memory.start + _rng() % (memory_size / access_size) * access_size;
+  }
+
+  // Each warp walks through its memory object, records of the same pc hit the same object
+  auto &memory = _memories[record % _memories.size()];
+  u64 offset = 0;
+  if (_config.pattern == TRACE_ACCESS_COALESCED) {
+    offset = static_cast<u64>(record) * GPU_PATCH_WARP_SIZE * access_size + lane * access_size;
+  } else if (_config.pattern == TRACE_ACCESS_STRIDED) {
+    offset = static_cast<u64>(record) * GPU_PATCH_WARP_SIZE * _config.stride +
+             static_cast<u64>(lane) * _config.stride;
+  } else {
+    offset = static_cast<u64>(record) * access_size;
+  }
+  offset %= memory_size;
+  offset -= offset % access_size;
+  return memory.start + offset;
+}
+
+void TraceGenerator::generate_default(gpu_patch_record_t *records) {
+  for (u32 i = 0; i < _config.num_records; ++i) {
+    auto *record = records + i;
+    if (i % _config.repeats != 0) {
+      *record = *(record - 1);
+      continue;
+    }
+    auto warp = i % (_config.num_pcs * TRACE_GENERATOR_WARPS_PER_BLOCK);
+
+    record->pc = TRACE_GENERATOR_PC_START + (i % _config.num_pcs) * 16;
+    record->size = _config.access_size;
+    record->active = _config.active;
+    record->flat_block_id = i / (_config.num_pcs * TRACE_GENERATOR_WARPS_PER_BLOCK);
+    record->flat_thread_id = (warp / _config.num_pcs) * GPU_PATCH_WARP_SIZE;
+    // One store every four accesses
+    record->flags = (i % 4 == 3) ? GPU_PATCH_WRITE : GPU_PATCH_READ;
+
+    // The same value per pc for high redundancy
+    u64 uniform_value = (i % _config.num_pcs) + 1;
+    for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+      record->address[j] = lane_address(i, j);
+      for (u32 k = 0; k < GPU_PATCH_MAX_ACCESS_SIZE; k += sizeof(u64)) {
+        u64 value = _config.redundancy == TRACE_VALUE_HIGH ? uniform_value : _rng();
+        memcpy(&record->value[j][k], &value, MIN2(sizeof(u64), GPU_PATCH_MAX_ACCESS_SIZE - k));
+      }
+    }
+  }
+}
+
+void TraceGenerator::generate_address_patch(gpu_patch_record_address_t *records) {
+  for (u32 i = 0; i < _config.num_records; ++i) {
+    auto *record = records + i;
+
+    record->size = _config.access_size;
+    record->active = _config.active;
+    record->flags = (i % 4 == 3) ? GPU_PATCH_WRITE : GPU_PATCH_READ;
+    for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+      record->address[j] = lane_address(i, j);
+    }
+  }
+}
+
+void TraceGenerator::generate_address_analysis(gpu_patch_analysis_address_t *records) {
+  for (u32 i = 0; i < _config.num_records; ++i) {
+    auto *record = records + i;
+
+    // The range touched by a warp, clamped to its memory object
+    u64 start = lane_address(i, 0);
+    u64 end = start + _config.access_size;
+    if (_config.pattern != TRACE_ACCESS_RANDOM) {
+      u64 last = lane_address(i, GPU_PATCH_WARP_SIZE - 1) + _config.access_size;
+      end = MAX2(end, last);
+    }
+    record->start = start;
+    record->end = end;
+  }
+}
+
+void TraceGenerator::generate(TraceBuffer &trace_buffer) {
+  auto &buffer = trace_buffer.buffer;
+  memset(&buffer, 0, sizeof(buffer));
+  buffer.type = _config.type;
+  buffer.head_index = _config.num_records;
+  buffer.size = _config.num_records;
+  buffer.num_threads = GPU_PATCH_WARP_SIZE * TRACE_GENERATOR_WARPS_PER_BLOCK;
+  buffer.flags = GPU_PATCH_READ | GPU_PATCH_WRITE;
+
+  auto len = trace_buffer.records_size();
+  trace_buffer.records.reset(new u8[len]());
+  trace_buffer.aux.reset();
+  trace_buffer.torch_aux.reset();
+  buffer.records = trace_buffer.records.get();
+
+  if (_config.type == GPU_PATCH_TYPE_DEFAULT) {
+    generate_default(reinterpret_cast<gpu_patch_record_t *>(buffer.records));
+  } else if (_config.type == GPU_PATCH_TYPE_ADDRESS_PATCH) {
+    generate_address_patch(reinterpret_cast<gpu_patch_record_address_t *>(buffer.records));
+  } else if (_config.type == GPU_PATCH_TYPE_ADDRESS_ANALYSIS) {
+    generate_address_analysis(reinterpret_cast<gpu_patch_analysis_address_t *>(buffer.records));
+  }
+}
+
+}  // namespace redshow
@@ -0,0 +1,78 @@
+#include "binutils/access_kind_table.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace redshow {
+
+// Instructions are 8 bytes before Volta and 16 bytes since
+static const u32 MAX_SLOT_SHIFT = 4;
+
+void AccessKindTable::build(const InstructionGraph &inst_graph, const SymbolVector &symbols) {
+  _start = 0;
+  _shift = MAX_SLOT_SHIFT;
+  _slots.clear();
+
+  if (inst_graph.size() == 0) {
+    return;
+  }
+
+  // Nodes are sorted by cubin offset
+  u64 start = inst_graph.nodes_begin()->first;
+  u64 end = start;
+  u64 stride = 0;
+  for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
+    stride = std::gcd(stride, iter->first - start);
+    end = iter->first;
+  }
+
+  // Largest power of two dividing all instruction distances
+  u32 shift = 0;
+  while (shift < MAX_SLOT_SHIFT && stride != 0 && (stride & (1ul << shift)) == 0) {
+    ++shift;
+  }
+  if (stride == 0) {
+    // A single instruction
+    shift = MAX_SLOT_SHIFT;
+  }
+
+  // Functions sorted by cubin offset. Entries that were only resized but not parsed are skipped.
+  Vector<std::pair<u64, u32>> functions;
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (symbols[i].index == i) {
+      functions.emplace_back(symbols[i].offset, symbols[i].index);
+    }
+  }
+  std::sort(functions.begin(), functions.end());
+
+  _start = start;
+  _shift = shift;
+  _slots.resize(((end - start) >> shift) + 1);
+
+  for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
+    auto &inst = iter->second;
+    if (inst.access_kind.get() == NULL) {
+      continue;
+    }
+
+    auto &access_kind = *inst.access_kind;
+    if (access_kind.vec_size > UINT8_MAX || access_kind.unit_size > UINT8_MAX) {
+      // Cannot be packed, fall back to default mode
+      continue;
+    }
+
+    auto &slot = _slots[(iter->first - start) >> shift];
+    slot.access_kind.vec_size = access_kind.vec_size;
+    slot.access_kind.unit_size = access_kind.unit_size;
+    slot.access_kind.data_type = access_kind.data_type;
+    slot.access_kind.valid = 1;
+
+    auto function_iter = std::upper_bound(functions.begin(), functions.end(),
+                                          std::make_pair(iter->first, UINT32_MAX));
+    if (function_iter != functions.begin()) {
+      slot.function_index = (function_iter - 1)->second;
+    }
+  }
+}
+
+}  // namespace redshow
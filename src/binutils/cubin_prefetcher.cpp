@@ -0,0 +1,174 @@
+#include "binutils/cubin_prefetcher.h"
+
+#include <fstream>
+#include <limits>
+
+#include "common/stats.h"
+
+namespace redshow {
+
+void CubinPrefetcher::start(u32 num_workers, Parse parse) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_running) {
+    return;
+  }
+
+  _parse = std::move(parse);
+  _stopping = false;
+  _running = true;
+  for (u32 i = 0; i < MAX2(num_workers, 1u); ++i) {
+    _workers.emplace_back([this]() { work(); });
+  }
+}
+
+void CubinPrefetcher::stop() {
+  {
+    std::unique_lock<std::mutex> lock(_lock);
+    if (!_running) {
+      return;
+    }
+    _stopping = true;
+    _ready.notify_all();
+  }
+
+  for (auto &worker : _workers) {
+    worker.join();
+  }
+
+  std::unique_lock<std::mutex> lock(_lock);
+  _workers.clear();
+  _running = false;
+}
+
+bool CubinPrefetcher::running() const {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  return _running;
+}
+
+void CubinPrefetcher::load_hints(const std::string &file_name) {
+  std::ifstream in(file_name);
+  std::unique_lock<std::mutex> lock(_lock);
+
+  std::string path;
+  while (std::getline(in, path)) {
+    if (!path.empty() && !_hints.has(path)) {
+      _hints[path] = _hint_paths.size();
+      _hint_paths.push_back(path);
+    }
+  }
+}
+
+void CubinPrefetcher::store_hints(const std::string &file_name) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  std::ofstream out(file_name);
+  for (auto &path : _used) {
+    out << path << std::endl;
+  }
+  // Cubins of other workloads sharing the hint file
+  for (auto &path : _hint_paths) {
+    if (!_used_paths.has(path)) {
+      out << path << std::endl;
+    }
+  }
+}
+
+void CubinPrefetcher::submit(u32 cubin_id, u32 nsymbols, const std::string &path) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (!_running || _tasks.has(cubin_id)) {
+    return;
+  }
+
+  auto task = std::make_shared<Task>();
+  task->path = path;
+  task->parse = std::make_shared<CubinParse>(nsymbols);
+  auto hint = _hints.find(path);
+  if (hint != _hints.end()) {
+    task->priority = std::make_pair(hint->second, cubin_id);
+  } else {
+    // Later submissions first, after all the hinted cubins
+    task->priority = std::make_pair(std::numeric_limits<u64>::max() - _submitted, cubin_id);
+  }
+  ++_submitted;
+
+  _tasks[cubin_id] = task;
+  _queue.insert(task->priority);
+  _ready.notify_one();
+}
+
+std::shared_ptr<CubinParse> CubinPrefetcher::take(u32 cubin_id) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  auto iter = _tasks.find(cubin_id);
+  if (iter == _tasks.end()) {
+    return NULL;
+  }
+  // Erase may drop the entry while this thread waits
+  auto task = iter->second;
+
+  if (!_used_paths.has(task->path)) {
+    _used_paths.insert(task->path);
+    _used.push_back(task->path);
+  }
+
+  if (task->state == TASK_QUEUED) {
+    // Not worth waiting for a worker
+    _queue.erase(task->priority);
+    run(lock, *task);
+  } else if (task->state == TASK_RUNNING) {
+    StatsTimer timer(STATS_CUBIN_PREFETCH_WAIT);
+    _done.wait(lock, [&]() { return task->state == TASK_DONE; });
+  } else {
+    Stats::add(STATS_CUBIN_PREFETCH_HITS, 1);
+  }
+
+  return task->parse;
+}
+
+void CubinPrefetcher::erase(u32 cubin_id) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  auto iter = _tasks.find(cubin_id);
+  if (iter == _tasks.end()) {
+    return;
+  }
+
+  auto task = iter->second;
+  if (task->state == TASK_QUEUED) {
+    _queue.erase(task->priority);
+  }
+  _tasks.erase(iter);
+}
+
+void CubinPrefetcher::run(std::unique_lock<std::mutex> &lock, Task &task) {
+  task.state = TASK_RUNNING;
+
+  lock.unlock();
+  _parse(task.path, *task.parse);
+  lock.lock();
+
+  task.state = TASK_DONE;
+  _done.notify_all();
+}
+
+void CubinPrefetcher::work() {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  while (true) {
+    _ready.wait(lock, [&]() { return _stopping || !_queue.empty(); });
+    if (_stopping) {
+      break;
+    }
+
+    auto cubin_id = _queue.begin()->second;
+    _queue.erase(_queue.begin());
+    // Keep the task alive if it is erased during the parse
+    auto task = _tasks.at(cubin_id);
+    run(lock, *task);
+  }
+}
+
+}  // namespace redshow
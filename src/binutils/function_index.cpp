@@ -0,0 +1,143 @@
+#include "binutils/function_index.h"
+
+#include <algorithm>
+
+namespace redshow {
+
+const FunctionInterval *FunctionSnapshot::lookup(u32 cubin_id, u32 mod_id, u64 pc,
+                                                 u64 &end) const {
+  auto *interval = lookup(_intervals, pc, end);
+  if (interval != NULL && interval->cubin_id == cubin_id && interval->mod_id == mod_id) {
+    return interval;
+  }
+
+  auto *module = this->module(cubin_id, mod_id);
+  if (module == NULL) {
+    return NULL;
+  }
+  return lookup(module->intervals, pc, end);
+}
+
+const FunctionInterval *FunctionSnapshot::lookup(const Vector<FunctionInterval> &intervals, u64 pc,
+                                                 u64 &end) {
+  auto iter = std::upper_bound(
+      intervals.begin(), intervals.end(), pc,
+      [](u64 pc, const FunctionInterval &interval) { return pc < interval.pc; });
+
+  if (iter == intervals.begin()) {
+    return NULL;
+  }
+
+  end = iter == intervals.end() ? UINT64_MAX : iter->pc;
+  return &*(iter - 1);
+}
+
+const FunctionSnapshot::Module *FunctionSnapshot::module(u32 cubin_id, u32 mod_id) const {
+  auto key = std::make_pair(cubin_id, mod_id);
+  auto iter = std::lower_bound(_modules.begin(), _modules.end(), key,
+                               [](const Module &module, const std::pair<u32, u32> &key) {
+                                 return std::make_pair(module.cubin_id, module.mod_id) < key;
+                               });
+  if (iter == _modules.end() || iter->cubin_id != cubin_id || iter->mod_id != mod_id) {
+    return NULL;
+  }
+  return &*iter;
+}
+
+void FunctionIndex::insert(u32 cubin_id, u32 mod_id, const SymbolVector &symbols,
+                           std::shared_ptr<const AccessKindTable> access_kinds) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  auto &module = _modules[std::make_pair(cubin_id, mod_id)];
+  module.symbols = symbols;
+  module.access_kinds = std::move(access_kinds);
+
+  publish(cubin_id, mod_id, &module);
+}
+
+void FunctionIndex::erase(u32 cubin_id, u32 mod_id) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_modules.erase(std::make_pair(cubin_id, mod_id)) != 0) {
+    publish(cubin_id, mod_id, NULL);
+  }
+}
+
+std::shared_ptr<const FunctionSnapshot> FunctionIndex::snapshot() const {
+  static thread_local const FunctionIndex *owner = NULL;
+  static thread_local u64 version = 0;
+  static thread_local std::shared_ptr<const FunctionSnapshot> snapshot;
+
+  if (owner != this || version != _version.load(std::memory_order_acquire)) {
+    std::unique_lock<std::mutex> lock(_lock);
+    owner = this;
+    version = _version.load(std::memory_order_relaxed);
+    snapshot = _snapshot;
+  }
+
+  return snapshot;
+}
+
+void FunctionIndex::publish(u32 cubin_id, u32 mod_id, const Module *module) {
+  auto key = std::make_pair(cubin_id, mod_id);
+  auto &old_snapshot = *_snapshot;
+  auto snapshot = std::make_shared<FunctionSnapshot>();
+
+  FunctionSnapshot::Module snapshot_module;
+  if (module != NULL) {
+    snapshot_module.cubin_id = cubin_id;
+    snapshot_module.mod_id = mod_id;
+    snapshot_module.access_kinds = module->access_kinds;
+    snapshot_module.intervals.reserve(module->symbols.size());
+    // Symbols are sorted by pc
+    for (auto &symbol : module->symbols) {
+      FunctionInterval interval;
+      interval.pc = symbol.pc;
+      interval.offset = symbol.offset;
+      interval.cubin_id = cubin_id;
+      interval.mod_id = mod_id;
+      interval.function_index = symbol.index;
+      interval.access_kinds = module->access_kinds.get();
+      snapshot_module.intervals.push_back(interval);
+    }
+  }
+
+  // Other modules are copied from the old snapshot, the changed module replaces its old version
+  snapshot->_modules.reserve(old_snapshot._modules.size() + 1);
+  bool inserted = module == NULL;
+  for (auto &old_module : old_snapshot._modules) {
+    auto old_key = std::make_pair(old_module.cubin_id, old_module.mod_id);
+    if (!inserted && key <= old_key) {
+      snapshot->_modules.push_back(snapshot_module);
+      inserted = true;
+    }
+    if (old_key != key) {
+      snapshot->_modules.push_back(old_module);
+    }
+  }
+  if (!inserted) {
+    snapshot->_modules.push_back(snapshot_module);
+  }
+
+  // Merge the sorted functions of the changed module into the sorted functions of the others.
+  // Functions at the same pc keep the order of modules.
+  snapshot->_intervals.reserve(old_snapshot._intervals.size() + snapshot_module.intervals.size());
+  auto iter = snapshot_module.intervals.begin();
+  for (auto &interval : old_snapshot._intervals) {
+    auto interval_key = std::make_pair(interval.cubin_id, interval.mod_id);
+    if (interval_key == key) {
+      continue;
+    }
+    while (iter != snapshot_module.intervals.end() &&
+           (iter->pc < interval.pc || (iter->pc == interval.pc && key < interval_key))) {
+      snapshot->_intervals.push_back(*iter++);
+    }
+    snapshot->_intervals.push_back(interval);
+  }
+  snapshot->_intervals.insert(snapshot->_intervals.end(), iter, snapshot_module.intervals.end());
+
+  _snapshot = snapshot;
+  _version.fetch_add(1, std::memory_order_release);
+}
+
+}  // namespace redshow
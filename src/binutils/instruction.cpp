@@ -7,11 +7,16 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <queue>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "binutils/instruction_reader.h"
 #include "binutils/symbol.h"
 #include "common/utils.h"
+#include "common/vector.h"
 #include "redshow.h"
 
 #ifdef DEBUG_INSTRUCTION
@@ -22,206 +27,358 @@
 
 namespace redshow {
 
-void InstructionParser::default_access_kind(Instruction &inst) {
-  if (inst.access_kind->vec_size == 0) {
+u32 instruction_op_flags(const std::string &op) {
+  static const std::pair<const char *, u32> words[] = {
+      {"MEMORY", INSTRUCTION_OP_MEMORY},   {"INTEGER", INSTRUCTION_OP_INTEGER},
+      {"FLOAT", INSTRUCTION_OP_FLOAT},     {"CONVERT", INSTRUCTION_OP_CONVERT},
+      {"MOVE", INSTRUCTION_OP_MOVE},       {"UNIFORM", INSTRUCTION_OP_UNIFORM},
+      {"STORE", INSTRUCTION_OP_ANY_STORE}};
+  // Tokens starting with '.' are only compared at dots
+  static const std::pair<std::string, u32> dot_words[] = {
+      {".STORE", INSTRUCTION_OP_STORE},        {".LOAD", INSTRUCTION_OP_LOAD},
+      {".SHARED", INSTRUCTION_OP_SHARED},      {".LOCAL", INSTRUCTION_OP_LOCAL},
+      {".128", INSTRUCTION_OP_128},            {".64", INSTRUCTION_OP_64},
+      {".32", INSTRUCTION_OP_32},              {".16", INSTRUCTION_OP_16},
+      {".8", INSTRUCTION_OP_8},                {".I2F", INSTRUCTION_OP_I2F},
+      {".F2F", INSTRUCTION_OP_F2F},            {".F2I", INSTRUCTION_OP_F2I},
+      {".I2I", INSTRUCTION_OP_I2I},            {"._64_TO_32", INSTRUCTION_OP_64_TO_32},
+      {"._32_TO_64", INSTRUCTION_OP_32_TO_64}};
+
+  u32 flags = 0;
+  for (auto &word : words) {
+    if (op.find(word.first) != std::string::npos) {
+      flags |= word.second;
+    }
+  }
+  for (auto pos = op.find('.'); pos != std::string::npos; pos = op.find('.', pos + 1)) {
+    for (auto &word : dot_words) {
+      if (op.compare(pos, word.first.size(), word.first) == 0) {
+        flags |= word.second;
+      }
+    }
+  }
+  return flags;
+}
+
+namespace {
+
+void default_access_kind(const Instruction &inst, AccessKind &access_kind) {
+  if (access_kind.vec_size == 0) {
     // Determine the vec size of data,
-    if (inst.op.find(".128") != std::string::npos) {
-      inst.access_kind->vec_size = 128;
-    } else if (inst.op.find(".64") != std::string::npos) {
-      inst.access_kind->vec_size = 64;
-    } else if (inst.op.find(".32") != std::string::npos) {
-      inst.access_kind->vec_size = 32;
-    } else if (inst.op.find(".16") != std::string::npos) {
-      inst.access_kind->vec_size = 16;
-    } else if (inst.op.find(".8") != std::string::npos) {
-      inst.access_kind->vec_size = 8;
+    if (inst.op_flags & INSTRUCTION_OP_128) {
+      access_kind.vec_size = 128;
+    } else if (inst.op_flags & INSTRUCTION_OP_64) {
+      access_kind.vec_size = 64;
+    } else if (inst.op_flags & INSTRUCTION_OP_32) {
+      access_kind.vec_size = 32;
+    } else if (inst.op_flags & INSTRUCTION_OP_16) {
+      access_kind.vec_size = 16;
+    } else if (inst.op_flags & INSTRUCTION_OP_8) {
+      access_kind.vec_size = 8;
     } else {
-      inst.access_kind->vec_size = 32;
+      access_kind.vec_size = 32;
     }
   }
 
   // Default mode
-  if (inst.access_kind->unit_size == 0) {
+  if (access_kind.unit_size == 0) {
     // If unit size is not determined
-    inst.access_kind->unit_size = MIN2(32, inst.access_kind->vec_size);
+    access_kind.unit_size = MIN2(32, access_kind.vec_size);
   }
 
-  if (inst.access_kind->data_type == REDSHOW_DATA_UNKNOWN) {
+  if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
     // If type is not determined
     // TODO(Keren): it makes more sense to classify it as INT
-    redshow_data_type_get(&(inst.access_kind->data_type));
+    redshow_data_type_get(&(access_kind.data_type));
   }
 }
 
-AccessKind InstructionParser::init_access_kind(Instruction &inst, InstructionGraph &inst_graph,
-                                               std::set<unsigned int> &visited, bool load) {
-  if (visited.find(inst.pc) != visited.end()) {
-    // This node was visited before in the search for inst
-    // It is still unknown as it appears again
-    return AccessKind();
-  }
-  visited.insert(inst.pc);
-
-  AccessKind access_kind;
-  // Determine the vec size of data,
-  if (inst.op.find(".128") != std::string::npos) {
-    access_kind.vec_size = 128;
-  } else if (inst.op.find(".64") != std::string::npos) {
-    access_kind.vec_size = 64;
-  } else if (inst.op.find(".32") != std::string::npos) {
-    access_kind.vec_size = 32;
-  } else if (inst.op.find(".16") != std::string::npos) {
-    access_kind.vec_size = 16;
-  } else if (inst.op.find(".8") != std::string::npos) {
-    access_kind.vec_size = 8;
-  } else {
-    access_kind.vec_size = 32;
-  }
+/*
+ * Access kind inference of the memory instructions in one function.
+ *
+ * An instruction's access kind is decided by its first neighbors with a known data type and unit
+ * size, following loaded values to their users and stored values to their producers. Transit
+ * (MOVE) nodes forward the result of their own neighbors, which is computed once per direction
+ * and memoized. The search keeps an explicit stack, so long chains neither recurse nor get walked
+ * again for every memory instruction. A node reached again while its own search is in progress,
+ * i.e., on a cycle, is unknown.
+ */
+class AccessKindInference {
+ public:
+  // Instructions in [start, end) are updated, others are only read
+  AccessKindInference(InstructionGraph &inst_graph, u64 start, u64 end)
+      : _inst_graph(inst_graph), _start(start), _end(end) {}
+
+  void infer(Instruction &inst) {
+    // If access kind is not determined, allocate one
+    inst.access_kind = std::make_shared<AccessKind>();
 
-  // Special handling for uniform register instructions
-  if (inst.op.find("UNIFORM") != std::string::npos) {
-    access_kind.data_type = REDSHOW_DATA_INT;
+    // Associate access type with instruction
+    if (inst.op_flags & INSTRUCTION_OP_STORE) {
+      *inst.access_kind = search(inst, false);
+    } else if (inst.op_flags & INSTRUCTION_OP_LOAD) {
+      *inst.access_kind = search(inst, true);
+    }
+
+    default_access_kind(inst, *inst.access_kind);
   }
 
-  if ((load && inst_graph.outgoing_edge_size(inst.pc) == 0) ||
-      (!load && inst_graph.incoming_edge_size(inst.pc) == 0)) {
-    return access_kind;
+ private:
+  enum FrameKind {
+    // The memory instruction being inferred
+    FRAME_ROOT = 0,
+    // MOVE, memoized
+    FRAME_TRANSIT = 1,
+    // Producer of a stored value, inferred as a load and cached on the instruction
+    FRAME_MEMORY = 2,
+    // FRAME_MEMORY of another function, memoized
+    FRAME_REMOTE_MEMORY = 3
+  };
+
+  struct Frame {
+    Instruction *inst;
+    bool load;
+    FrameKind kind;
+    AccessKind access_kind;
+    // Next neighbor edge
+    InstructionGraph::NeighborEdges::const_iterator iter;
+    InstructionGraph::NeighborEdges::const_iterator end;
+  };
+
+  static u64 memo_key(u64 pc, bool load) { return (pc << 1) | (load ? 1 : 0); }
+
+  void push(Instruction &inst, bool load, FrameKind kind) {
+    Frame frame;
+    frame.inst = &inst;
+    frame.load = load;
+    frame.kind = kind;
+
+    // Determine the vec size of data,
+    if (inst.op_flags & INSTRUCTION_OP_128) {
+      frame.access_kind.vec_size = 128;
+    } else if (inst.op_flags & INSTRUCTION_OP_64) {
+      frame.access_kind.vec_size = 64;
+    } else if (inst.op_flags & INSTRUCTION_OP_32) {
+      frame.access_kind.vec_size = 32;
+    } else if (inst.op_flags & INSTRUCTION_OP_16) {
+      frame.access_kind.vec_size = 16;
+    } else if (inst.op_flags & INSTRUCTION_OP_8) {
+      frame.access_kind.vec_size = 8;
+    } else {
+      frame.access_kind.vec_size = 32;
+    }
+
+    // Special handling for uniform register instructions
+    if (inst.op_flags & INSTRUCTION_OP_UNIFORM) {
+      frame.access_kind.data_type = REDSHOW_DATA_INT;
+    }
+
+    if ((load && _inst_graph.outgoing_edge_size(inst.pc) != 0) ||
+        (!load && _inst_graph.incoming_edge_size(inst.pc) != 0)) {
+      auto edges =
+          load ? _inst_graph.outgoing_edges(inst.pc) : _inst_graph.incoming_edges(inst.pc);
+      frame.iter = edges.begin();
+      frame.end = edges.end();
+    }
+
+    _in_progress.insert(memo_key(inst.pc, load));
+    _stack.push_back(frame);
   }
 
-  auto &edges = load ? inst_graph.outgoing_edges(inst.pc) : inst_graph.incoming_edges(inst.pc);
+  AccessKind search(Instruction &root, bool load) {
+    AccessKind result;
 
-  for (auto iter = edges.begin(); iter != edges.end(); ++iter) {
-    auto pc = load ? iter->to : iter->from;
-    auto &neighbor_inst = inst_graph.node(pc);
-    AccessKind neighbor_access_kind;
+    push(root, load, FRAME_ROOT);
+    while (!_stack.empty()) {
+      if (visit(_stack.back())) {
+        // A neighbor is pushed, the current edge is visited again once it finishes
+        continue;
+      }
 
-    // Direct unit size detect
-    if (access_kind.unit_size == 0) {
-      if (neighbor_inst.op.find(".64") != std::string::npos) {
-        access_kind.unit_size = MIN2(64, access_kind.vec_size);
-      } else if (neighbor_inst.op.find(".32") != std::string::npos) {
-        access_kind.unit_size = MIN2(32, access_kind.vec_size);
-      } else if (neighbor_inst.op.find(".16") != std::string::npos) {
-        access_kind.unit_size = MIN2(16, access_kind.vec_size);
-      } else if (neighbor_inst.op.find(".8") != std::string::npos) {
-        access_kind.unit_size = MIN2(8, access_kind.vec_size);
-      } else if (neighbor_inst.op.find("._64_TO_32") != std::string::npos) {
-        if (load) {
-          access_kind.unit_size = MIN2(64, access_kind.vec_size);
-        } else {
-          access_kind.unit_size = MIN2(32, access_kind.vec_size);
-        }
-      } else if (neighbor_inst.op.find("._32_TO_64") != std::string::npos) {
-        if (load) {
-          access_kind.unit_size = MIN2(32, access_kind.vec_size);
-        } else {
-          access_kind.unit_size = MIN2(64, access_kind.vec_size);
-        }
+      auto frame = _stack.back();
+      _stack.pop_back();
+      _in_progress.erase(memo_key(frame.inst->pc, frame.load));
+
+      if (frame.kind == FRAME_TRANSIT) {
+        _transits[memo_key(frame.inst->pc, frame.load)] = frame.access_kind;
+      } else if (frame.kind == FRAME_MEMORY) {
+        default_access_kind(*frame.inst, frame.access_kind);
+        frame.inst->access_kind = std::make_shared<AccessKind>(frame.access_kind);
+      } else if (frame.kind == FRAME_REMOTE_MEMORY) {
+        default_access_kind(*frame.inst, frame.access_kind);
+        _remote_memories[frame.inst->pc] = frame.access_kind;
+      } else {
+        result = frame.access_kind;
       }
     }
 
-    if (neighbor_inst.op.find("MOVE") != std::string::npos) {
-      // Transit node
-      // INTEGER.IMAD.MOVE is handled here
-      // Since a transit node is never a memory instruction, so do not cache its result
-      neighbor_access_kind = init_access_kind(neighbor_inst, inst_graph, visited, load);
-      if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-        access_kind.data_type = neighbor_access_kind.data_type;
-      }
+    return result;
+  }
+
+  // Instructions of other functions are never cached on, as they may be inferred concurrently
+  bool local(const Instruction &inst) const { return inst.pc >= _start && inst.pc < _end; }
+
+  // Merge a transit or memory neighbor's result
+  static void merge(AccessKind &access_kind, const AccessKind &neighbor_access_kind) {
+    if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
+      access_kind.data_type = neighbor_access_kind.data_type;
+    }
+    if (access_kind.unit_size == 0) {
+      access_kind.unit_size = neighbor_access_kind.unit_size;
+    }
+  }
+
+  /**
+   * @brief Visit the remaining neighbors of frame
+   *
+   * @return true if a neighbor has to be searched first
+   */
+  bool visit(Frame &frame) {
+    auto &inst = *frame.inst;
+    auto &access_kind = frame.access_kind;
+    bool load = frame.load;
+
+    for (; frame.iter != frame.end; ++frame.iter) {
+      auto pc = load ? frame.iter->to : frame.iter->from;
+      auto &neighbor_inst = _inst_graph.node(pc);
+
+      // Direct unit size detect
       if (access_kind.unit_size == 0) {
-        access_kind.unit_size = neighbor_access_kind.unit_size;
-      }
-    } else if (neighbor_inst.op.find("MEMORY") != std::string::npos) {
-      if (load) {
-        // Decided by memory hierarchy
-        if (neighbor_inst.op.find(".SHARED") != std::string::npos ||
-            neighbor_inst.op.find(".LOCAL") != std::string::npos) {
-          if (std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[0]) !=
-              inst.dsts.end()) {
-            if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-              access_kind.data_type = REDSHOW_DATA_INT;
-            }
-            if (access_kind.unit_size == 0) {
-              access_kind.unit_size = 32;
-            }
+        if (neighbor_inst.op_flags & INSTRUCTION_OP_64) {
+          access_kind.unit_size = MIN2(64, access_kind.vec_size);
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_32) {
+          access_kind.unit_size = MIN2(32, access_kind.vec_size);
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_16) {
+          access_kind.unit_size = MIN2(16, access_kind.vec_size);
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_8) {
+          access_kind.unit_size = MIN2(8, access_kind.vec_size);
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_64_TO_32) {
+          if (load) {
+            access_kind.unit_size = MIN2(64, access_kind.vec_size);
+          } else {
+            access_kind.unit_size = MIN2(32, access_kind.vec_size);
           }
-        } else {
-          if (std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[0]) !=
-                  inst.dsts.end() ||
-              std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[1]) !=
-                  inst.dsts.end()) {
-            if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-              access_kind.data_type = REDSHOW_DATA_INT;
-            }
-            if (access_kind.unit_size == 0) {
-              access_kind.unit_size = 64;
-            }
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_32_TO_64) {
+          if (load) {
+            access_kind.unit_size = MIN2(32, access_kind.vec_size);
+          } else {
+            access_kind.unit_size = MIN2(64, access_kind.vec_size);
           }
         }
-      } else {
-        // Transit node and reverse search direction
-        if (neighbor_inst.access_kind.get() == NULL) {
-          // Cache result
-          neighbor_inst.access_kind = std::make_shared<AccessKind>(
-              init_access_kind(neighbor_inst, inst_graph, visited, !load));
-          default_access_kind(neighbor_inst);
-        }
-        neighbor_access_kind = *neighbor_inst.access_kind;
+      }
 
-        if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-          access_kind.data_type = neighbor_access_kind.data_type;
-        }
-        if (access_kind.unit_size == 0) {
-          access_kind.unit_size = neighbor_access_kind.unit_size;
+      if (neighbor_inst.op_flags & INSTRUCTION_OP_MOVE) {
+        // Transit node
+        // INTEGER.IMAD.MOVE is handled here
+        auto key = memo_key(neighbor_inst.pc, load);
+        auto transit = _transits.find(key);
+        if (transit != _transits.end()) {
+          merge(access_kind, transit->second);
+        } else if (_in_progress.find(key) != _in_progress.end()) {
+          // On a cycle
+          merge(access_kind, AccessKind());
+        } else {
+          push(neighbor_inst, load, FRAME_TRANSIT);
+          return true;
         }
-      }
-    } else if (neighbor_inst.op.find("INTEGER") != std::string::npos ||
-               neighbor_inst.op.find("UNIFORM") != std::string::npos) {
-      access_kind.data_type = REDSHOW_DATA_INT;
-    } else if (neighbor_inst.op.find("FLOAT") != std::string::npos) {
-      access_kind.data_type = REDSHOW_DATA_FLOAT;
-    } else if (neighbor_inst.op.find("CONVERT") != std::string::npos) {
-      if (neighbor_inst.op.find(".I2F") != std::string::npos) {
+      } else if (neighbor_inst.op_flags & INSTRUCTION_OP_MEMORY) {
         if (load) {
-          access_kind.data_type = REDSHOW_DATA_INT;
+          // Decided by memory hierarchy
+          if (neighbor_inst.op_flags & (INSTRUCTION_OP_SHARED | INSTRUCTION_OP_LOCAL)) {
+            if (std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[0]) !=
+                inst.dsts.end()) {
+              if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
+                access_kind.data_type = REDSHOW_DATA_INT;
+              }
+              if (access_kind.unit_size == 0) {
+                access_kind.unit_size = 32;
+              }
+            }
+          } else {
+            if (std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[0]) !=
+                    inst.dsts.end() ||
+                std::find(inst.dsts.begin(), inst.dsts.end(), neighbor_inst.srcs[1]) !=
+                    inst.dsts.end()) {
+              if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
+                access_kind.data_type = REDSHOW_DATA_INT;
+              }
+              if (access_kind.unit_size == 0) {
+                access_kind.unit_size = 64;
+              }
+            }
+          }
         } else {
-          access_kind.data_type = REDSHOW_DATA_FLOAT;
+          // Transit node and reverse search direction
+          auto remote = local(neighbor_inst) ? _remote_memories.end()
+                                             : _remote_memories.find(neighbor_inst.pc);
+          if (local(neighbor_inst) && neighbor_inst.access_kind.get() != NULL) {
+            merge(access_kind, *neighbor_inst.access_kind);
+          } else if (remote != _remote_memories.end()) {
+            merge(access_kind, remote->second);
+          } else if (_in_progress.find(memo_key(neighbor_inst.pc, true)) != _in_progress.end()) {
+            merge(access_kind, AccessKind());
+          } else {
+            // Cache result
+            push(neighbor_inst, true, local(neighbor_inst) ? FRAME_MEMORY : FRAME_REMOTE_MEMORY);
+            return true;
+          }
         }
-      } else if (neighbor_inst.op.find(".F2F") != std::string::npos) {
+      } else if (neighbor_inst.op_flags & (INSTRUCTION_OP_INTEGER | INSTRUCTION_OP_UNIFORM)) {
+        access_kind.data_type = REDSHOW_DATA_INT;
+      } else if (neighbor_inst.op_flags & INSTRUCTION_OP_FLOAT) {
         access_kind.data_type = REDSHOW_DATA_FLOAT;
-      } else if (neighbor_inst.op.find(".F2I") != std::string::npos) {
-        if (load) {
+      } else if (neighbor_inst.op_flags & INSTRUCTION_OP_CONVERT) {
+        if (neighbor_inst.op_flags & INSTRUCTION_OP_I2F) {
+          if (load) {
+            access_kind.data_type = REDSHOW_DATA_INT;
+          } else {
+            access_kind.data_type = REDSHOW_DATA_FLOAT;
+          }
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_F2F) {
           access_kind.data_type = REDSHOW_DATA_FLOAT;
-        } else {
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_F2I) {
+          if (load) {
+            access_kind.data_type = REDSHOW_DATA_FLOAT;
+          } else {
+            access_kind.data_type = REDSHOW_DATA_INT;
+          }
+        } else if (neighbor_inst.op_flags & INSTRUCTION_OP_I2I) {
+          access_kind.data_type = REDSHOW_DATA_INT;
+        }
+      } else {
+        if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
           access_kind.data_type = REDSHOW_DATA_INT;
         }
-      } else if (neighbor_inst.op.find(".I2I") != std::string::npos) {
-        access_kind.data_type = REDSHOW_DATA_INT;
       }
-    } else {
-      if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
-        access_kind.data_type = REDSHOW_DATA_INT;
+
+      if (access_kind.data_type != REDSHOW_DATA_UNKNOWN && access_kind.unit_size != 0) {
+        frame.iter = frame.end;
+        break;
       }
     }
 
-    if (access_kind.data_type != REDSHOW_DATA_UNKNOWN && access_kind.unit_size != 0) {
-      break;
-    }
+    return false;
   }
 
-  return access_kind;
-}
-
-bool InstructionParser::parse(const std::string &file_path, SymbolVector &symbols,
-                              InstructionGraph &inst_graph) {
+ private:
+  InstructionGraph &_inst_graph;
+  u64 _start;
+  u64 _end;
+  Vector<Frame> _stack;
+  // <pc and direction, access kind> of transit nodes
+  std::unordered_map<u64, AccessKind> _transits;
+  // <pc, access kind> of memory instructions in other functions
+  std::unordered_map<u64, AccessKind> _remote_memories;
+  std::unordered_set<u64> _in_progress;
+};
+
+}  // namespace
+
+void InstructionParser::read_tree(const std::string &file_path, SymbolVector &symbols,
+                                  InstructionGraph &inst_graph) {
   boost::property_tree::ptree root;
   boost::property_tree::read_json(file_path, root);
 
-#ifdef DEBUG_INSTRUCTION
-  // inst_pc-><symbol_index, inst_pc_offset>
-  std::map<int, std::pair<int, int>> pc_offsets;
-#endif
-
   // Read instructions
   for (auto &ptree_function : root) {
     int function_index = ptree_function.second.get<int>("index", 0);
@@ -281,23 +438,38 @@ bool InstructionParser::parse(const std::string &file_path, SymbolVector &symbol
 
         Instruction inst(op, pc, pred, dsts, srcs, udsts, usrcs, assign_pcs, uassign_pcs);
         inst_graph.add_node(pc, inst);
-
-#ifdef DEBUG_INSTRUCTION
-        pc_offsets[pc] = std::make_pair(function_index, pc - cubin_offset);
-#endif
       }
     }
   }
+}
+
+bool InstructionParser::parse(const std::string &file_path, SymbolVector &symbols,
+                              InstructionGraph &inst_graph, InstructionReaderMode mode) {
+  bool read = false;
+  if (mode == INSTRUCTION_READER_STREAM) {
+    // Keep the given symbols in case the streaming reader stops halfway
+    SymbolVector init_symbols = symbols;
+    read = InstructionReader::read(file_path, symbols, inst_graph);
+    if (!read) {
+      symbols = init_symbols;
+      inst_graph = InstructionGraph();
+    }
+  }
+
+  if (!read) {
+    read_tree(file_path, symbols, inst_graph);
+  }
 
   // Build a instruction dependency graph
   for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
     auto &inst = iter->second;
+    // Opcodes are decoded once, inference visits an instruction from each of its neighbors
+    inst.op_flags = instruction_op_flags(inst.op);
 
     size_t i = 0;
-    if (inst.op.find("STORE") != std::string::npos) {
+    if (inst.op_flags & INSTRUCTION_OP_ANY_STORE) {
       // If store operation has more than one src, skip the first or two src
-      if (inst.op.find(".SHARED") != std::string::npos ||
-          inst.op.find(".LOCAL") != std::string::npos) {
+      if (inst.op_flags & (INSTRUCTION_OP_SHARED | INSTRUCTION_OP_LOCAL)) {
         i = 1;
       } else {
         i = 2;
@@ -323,46 +495,74 @@ bool InstructionParser::parse(const std::string &file_path, SymbolVector &symbol
     }
   }
 
+  // The graph is only traversed from now on
+  inst_graph.freeze();
+
+  infer_access_kinds(symbols, inst_graph);
+
+#ifdef DEBUG_INSTRUCTION
   // Analyze memory instruction's access kind
   for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
     auto &inst = iter->second;
-
-    if (inst.op.find("MEMORY") == std::string::npos) {
-      continue;
-    }
-
-    if (inst.access_kind.get() != NULL) {
-      // If access kind is cached
-      continue;
+    if (inst.op_flags & INSTRUCTION_OP_MEMORY) {
+      // The function with the largest offset before the instruction
+      Symbol symbol;
+      for (auto &iter : symbols) {
+        if (iter.offset <= inst.pc && iter.offset >= symbol.offset) {
+          symbol = iter;
+        }
+      }
+      std::cout << "Func Index: " << symbol.index << ", PC: " << std::hex
+                << inst.pc - symbol.offset << ", TYPE: " << inst.access_kind->to_string()
+                << std::dec << std::endl;
     }
+  }
+#endif
 
-    // If access kind is not determined, allocate one
-    inst.access_kind = std::make_shared<AccessKind>();
-    std::set<unsigned int> visited;
+  return true;
+}
 
-    // Associate access type with instruction
-    if (inst.op.find(".STORE") != std::string::npos) {
-      *inst.access_kind = init_access_kind(inst, inst_graph, visited, false);
-    } else if (inst.op.find(".LOAD") != std::string::npos) {
-      *inst.access_kind = init_access_kind(inst, inst_graph, visited, true);
+void InstructionParser::infer_access_kinds(const SymbolVector &symbols,
+                                           InstructionGraph &inst_graph) {
+  // Memory instructions of each function, dependencies do not cross functions
+  Vector<u64> function_offsets;
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (symbols[i].index == i) {
+      function_offsets.push_back(symbols[i].offset);
     }
-
-    default_access_kind(inst);
   }
+  std::sort(function_offsets.begin(), function_offsets.end());
+  function_offsets.erase(std::unique(function_offsets.begin(), function_offsets.end()),
+                         function_offsets.end());
 
-#ifdef DEBUG_INSTRUCTION
-  // Analyze memory instruction's access kind
+  Vector<Vector<Instruction *>> function_insts(function_offsets.size() + 1);
+  size_t function = 0;
   for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
     auto &inst = iter->second;
-    if (inst.op.find("MEMORY") != std::string::npos) {
-      std::cout << "Func Index: " << pc_offsets[inst.pc].first << ", PC: " << std::hex
-                << pc_offsets[inst.pc].second << ", TYPE: " << inst.access_kind->to_string()
-                << std::dec << std::endl;
+    while (function < function_offsets.size() && function_offsets[function] <= inst.pc) {
+      ++function;
+    }
+    if (inst.op_flags & INSTRUCTION_OP_MEMORY) {
+      function_insts[function].push_back(&inst);
     }
   }
-#endif
 
-  return true;
+  // Analyze memory instruction's access kind
+#ifdef OPENMP
+#pragma omp parallel for schedule(dynamic) if (function_insts.size() > 1)
+#endif
+  for (size_t i = 0; i < function_insts.size(); ++i) {
+    u64 start = i == 0 ? 0 : function_offsets[i - 1];
+    u64 end = i == function_offsets.size() ? std::numeric_limits<u64>::max() : function_offsets[i];
+    AccessKindInference inference(inst_graph, start, end);
+    for (auto *inst : function_insts[i]) {
+      if (inst->access_kind.get() != NULL) {
+        // If access kind is cached
+        continue;
+      }
+      inference.infer(*inst);
+    }
+  }
 }
 
 u64 AccessKind::value_to_basic_type(u64 a, int decimal_degree_f32, int decimal_degree_f64) {
@@ -0,0 +1,302 @@
+#include "binutils/instruction_cache.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "common/hash.h"
+#include "common/mapped_file.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+namespace {
+
+class CacheWriter {
+ public:
+  template <typename T>
+  void put(T value) {
+    static_assert(std::is_trivially_copyable<T>::value, "Fixed-size field");
+    _bytes.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void put_bytes(const void *data, size_t len) {
+    _bytes.append(reinterpret_cast<const char *>(data), len);
+  }
+
+  void put_string(const std::string &str) {
+    put<u32>(str.size());
+    put_bytes(str.data(), str.size());
+  }
+
+  void put_registers(const std::vector<int> &registers) {
+    put<u32>(registers.size());
+    put_bytes(registers.data(), registers.size() * sizeof(int));
+  }
+
+  void put_assign_pcs(const std::map<int, std::vector<int>> &assign_pcs) {
+    put<u32>(assign_pcs.size());
+    for (auto &iter : assign_pcs) {
+      put<i32>(iter.first);
+      put_registers(iter.second);
+    }
+  }
+
+  const std::string &bytes() const { return _bytes; }
+
+ private:
+  std::string _bytes;
+};
+
+class CacheCursor {
+ public:
+  CacheCursor(const char *begin, const char *end) : _cur(begin), _end(end) {}
+
+  template <typename T>
+  T get() {
+    static_assert(std::is_trivially_copyable<T>::value, "Fixed-size field");
+    T value = T();
+    if (sizeof(T) <= static_cast<size_t>(_end - _cur)) {
+      memcpy(&value, _cur, sizeof(T));
+      _cur += sizeof(T);
+    } else {
+      _truncated = true;
+    }
+    return value;
+  }
+
+  // Returned pointer is valid as long as the mapping
+  const char *get_bytes(size_t len) {
+    if (len > static_cast<size_t>(_end - _cur)) {
+      _truncated = true;
+      return NULL;
+    }
+    auto *bytes = _cur;
+    _cur += len;
+    return bytes;
+  }
+
+  void get_string(std::string &str) {
+    auto len = get<u32>();
+    auto *bytes = get_bytes(len);
+    if (bytes != NULL) {
+      str.assign(bytes, len);
+    }
+  }
+
+  void get_registers(std::vector<int> &registers) {
+    auto len = get<u32>();
+    auto *bytes = get_bytes(len * sizeof(int));
+    if (bytes != NULL) {
+      registers.resize(len);
+      memcpy(registers.data(), bytes, len * sizeof(int));
+    }
+  }
+
+  void get_assign_pcs(std::map<int, std::vector<int>> &assign_pcs) {
+    auto len = get<u32>();
+    for (u32 i = 0; i < len && !_truncated; ++i) {
+      auto reg = get<i32>();
+      get_registers(assign_pcs[reg]);
+    }
+  }
+
+  // If a get went past the end of the file
+  bool truncated() const { return _truncated; }
+
+  bool done() const { return _cur == _end; }
+
+ private:
+  const char *_cur;
+  const char *_end;
+  bool _truncated = false;
+};
+
+std::string cache_path(const std::string &cache_dir, const std::string &key) {
+  return cache_dir + "/" + key + ".inst.bin";
+}
+
+}  // namespace
+
+std::string InstructionCache::key(const std::string &inst_path) {
+  MappedFile file(inst_path);
+  if (file.data() == NULL) {
+    return "";
+  }
+
+  // Undetermined access kinds take the configured default data type
+  redshow_data_type_t data_type = REDSHOW_DATA_UNKNOWN;
+  redshow_data_type_get(&data_type);
+
+  char key[64];
+  snprintf(key, sizeof(key), "%016lx-%lx-%u", xxhash64(file.data(), file.size()), file.size(),
+           data_type);
+  return std::string(key);
+}
+
+bool InstructionCache::load(const std::string &cache_dir, const std::string &key,
+                            SymbolVector &symbols, AccessKindTable &access_kinds,
+                            InstructionGraph *inst_graph) {
+  MappedFile file(cache_path(cache_dir, key));
+  if (file.data() == NULL) {
+    return false;
+  }
+
+  CacheCursor cursor(file.data(), file.data() + file.size());
+
+  auto *magic = cursor.get_bytes(sizeof(INSTRUCTION_CACHE_MAGIC));
+  if (magic == NULL ||
+      memcmp(magic, INSTRUCTION_CACHE_MAGIC, sizeof(INSTRUCTION_CACHE_MAGIC)) != 0 ||
+      cursor.get<u32>() != INSTRUCTION_CACHE_VERSION) {
+    return false;
+  }
+  // Reserved
+  cursor.get<u32>();
+
+  auto num_symbols = cursor.get<u64>();
+  if (num_symbols > file.size()) {
+    return false;
+  }
+  symbols.resize(MAX2(symbols.size(), num_symbols));
+  for (u64 i = 0; i < num_symbols; ++i) {
+    auto index = cursor.get<u32>();
+    auto offset = cursor.get<u64>();
+    symbols[i] = Symbol(index, offset);
+  }
+
+  auto start = cursor.get<u64>();
+  auto shift = cursor.get<u32>();
+  auto num_slots = cursor.get<u64>();
+  if (num_slots > file.size()) {
+    return false;
+  }
+  auto *slots = cursor.get_bytes(num_slots * sizeof(AccessKindSlot));
+  if (slots == NULL) {
+    return false;
+  }
+  access_kinds.assign(start, shift, reinterpret_cast<const AccessKindSlot *>(slots), num_slots);
+
+  if (inst_graph == NULL) {
+    return !cursor.truncated();
+  }
+
+  auto num_insts = cursor.get<u64>();
+  for (u64 i = 0; i < num_insts && !cursor.truncated(); ++i) {
+    Instruction inst;
+    inst.pc = cursor.get<u32>();
+    inst.predicate = cursor.get<i32>();
+    cursor.get_string(inst.op);
+    inst.op_flags = instruction_op_flags(inst.op);
+    if (cursor.get<u8>() != 0) {
+      auto vec_size = cursor.get<u32>();
+      auto unit_size = cursor.get<u32>();
+      auto data_type = static_cast<redshow_data_type_t>(cursor.get<u32>());
+      inst.access_kind = std::make_shared<AccessKind>(unit_size, vec_size, data_type);
+    }
+    cursor.get_registers(inst.dsts);
+    cursor.get_registers(inst.srcs);
+    cursor.get_registers(inst.udsts);
+    cursor.get_registers(inst.usrcs);
+    cursor.get_assign_pcs(inst.assign_pcs);
+    cursor.get_assign_pcs(inst.uassign_pcs);
+
+    u64 pc = inst.pc;
+    inst_graph->add_node(pc, std::move(inst));
+  }
+
+  auto num_edges = cursor.get<u64>();
+  for (u64 i = 0; i < num_edges && !cursor.truncated(); ++i) {
+    auto from = cursor.get<u64>();
+    auto to = cursor.get<u64>();
+    bool inter_function = cursor.get<u8>() != 0;
+    inst_graph->add_edge(InstructionDependencyIndex(from, to), inter_function);
+  }
+  inst_graph->freeze();
+
+  return !cursor.truncated() && cursor.done();
+}
+
+bool InstructionCache::store(const std::string &cache_dir, const std::string &key,
+                             const SymbolVector &symbols, const InstructionGraph &inst_graph,
+                             const AccessKindTable &access_kinds) {
+  CacheWriter writer;
+
+  writer.put_bytes(INSTRUCTION_CACHE_MAGIC, sizeof(INSTRUCTION_CACHE_MAGIC));
+  writer.put<u32>(INSTRUCTION_CACHE_VERSION);
+  writer.put<u32>(0);
+
+  writer.put<u64>(symbols.size());
+  for (auto &symbol : symbols) {
+    writer.put<u32>(symbol.index);
+    writer.put<u64>(symbol.offset);
+  }
+
+  auto &slots = access_kinds.slots();
+  writer.put<u64>(access_kinds.start());
+  writer.put<u32>(access_kinds.shift());
+  writer.put<u64>(slots.size());
+  writer.put_bytes(slots.data(), slots.size() * sizeof(AccessKindSlot));
+
+  writer.put<u64>(inst_graph.size());
+  for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
+    auto &inst = iter->second;
+    writer.put<u32>(inst.pc);
+    writer.put<i32>(inst.predicate);
+    writer.put_string(inst.op);
+    if (inst.access_kind.get() != NULL) {
+      writer.put<u8>(1);
+      writer.put<u32>(inst.access_kind->vec_size);
+      writer.put<u32>(inst.access_kind->unit_size);
+      writer.put<u32>(inst.access_kind->data_type);
+    } else {
+      writer.put<u8>(0);
+    }
+    writer.put_registers(inst.dsts);
+    writer.put_registers(inst.srcs);
+    writer.put_registers(inst.udsts);
+    writer.put_registers(inst.usrcs);
+    writer.put_assign_pcs(inst.assign_pcs);
+    writer.put_assign_pcs(inst.uassign_pcs);
+  }
+
+  writer.put<u64>(inst_graph.edge_size());
+  for (auto iter = inst_graph.edges_begin(); iter != inst_graph.edges_end(); ++iter) {
+    writer.put<u64>(iter->first.from);
+    writer.put<u64>(iter->first.to);
+    writer.put<u8>(iter->second.inter_function ? 1 : 0);
+  }
+
+  // The directory may have been created by another process
+  mkdir(cache_dir.c_str(), 0755);
+
+  // Readers never see a partial file
+  auto path = cache_path(cache_dir, key);
+  auto tmp_path = path + ".XXXXXX";
+  int fd = mkstemp(&tmp_path[0]);
+  if (fd < 0) {
+    return false;
+  }
+  // Shared by users of the same cache directory
+  fchmod(fd, 0644);
+  FILE *file = fdopen(fd, "wb");
+  if (file == NULL) {
+    close(fd);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+  auto &bytes = writer.bytes();
+  bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+  written = fclose(file) == 0 && written;
+  if (!written || rename(tmp_path.c_str(), path.c_str()) != 0) {
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace redshow
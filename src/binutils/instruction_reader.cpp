@@ -0,0 +1,352 @@
+#include "binutils/instruction_reader.h"
+
+#include <string_view>
+
+#include "common/mapped_file.h"
+#include "common/vector.h"
+
+namespace redshow {
+
+namespace {
+
+/*
+ * Minimal JSON scanner. Every method returns false on malformed or unsupported input, which
+ * makes the caller fall back to the tree reader.
+ */
+class JsonCursor {
+ public:
+  JsonCursor(const char *begin, const char *end) : _cur(begin), _end(end) {}
+
+  bool done() {
+    skip_space();
+    return _cur == _end;
+  }
+
+  // Consume c if it is the next token
+  bool accept(char c) {
+    skip_space();
+    if (_cur != _end && *_cur == c) {
+      ++_cur;
+      return true;
+    }
+    return false;
+  }
+
+  // Names and opcodes never contain escapes
+  bool string(std::string_view &str) {
+    if (!accept('"')) {
+      return false;
+    }
+    auto *start = _cur;
+    while (_cur != _end && *_cur != '"') {
+      if (*_cur == '\\') {
+        return false;
+      }
+      ++_cur;
+    }
+    if (_cur == _end) {
+      return false;
+    }
+    str = std::string_view(start, _cur - start);
+    ++_cur;
+    return true;
+  }
+
+  // Both 16 and "16" are accepted, as the tree reader does
+  bool integer(i64 &value) {
+    bool quoted = accept('"');
+    if (!quoted) {
+      skip_space();
+    }
+
+    bool negative = false;
+    if (_cur != _end && *_cur == '-') {
+      negative = true;
+      ++_cur;
+    }
+    if (_cur == _end || !is_digit(*_cur)) {
+      return false;
+    }
+
+    i64 result = 0;
+    while (_cur != _end && is_digit(*_cur)) {
+      result = result * 10 + (*_cur - '0');
+      ++_cur;
+    }
+    if (quoted) {
+      if (_cur == _end || *_cur != '"') {
+        return false;
+      }
+      ++_cur;
+    }
+
+    value = negative ? -result : result;
+    return true;
+  }
+
+  // Skip any value
+  bool skip() {
+    skip_space();
+    if (_cur == _end) {
+      return false;
+    }
+
+    if (*_cur != '{' && *_cur != '[' && *_cur != '"') {
+      // Number, true, false, or null
+      while (_cur != _end && *_cur != ',' && *_cur != '}' && *_cur != ']' && !is_space(*_cur)) {
+        ++_cur;
+      }
+      return true;
+    }
+
+    size_t depth = 0;
+    while (_cur != _end) {
+      char c = *_cur++;
+      if (c == '"') {
+        while (_cur != _end && *_cur != '"') {
+          // Skip the escaped character
+          _cur += *_cur == '\\' && _cur + 1 != _end ? 2 : 1;
+        }
+        if (_cur == _end) {
+          return false;
+        }
+        ++_cur;
+      } else if (c == '{' || c == '[') {
+        ++depth;
+      } else if (c == '}' || c == ']') {
+        --depth;
+      }
+      if (depth == 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Call visit on each element of an array, or each member value of an object
+   */
+  template <typename Visit>
+  bool elements(Visit &&visit) {
+    char close;
+    bool object;
+    if (accept('[')) {
+      close = ']';
+      object = false;
+    } else if (accept('{')) {
+      close = '}';
+      object = true;
+    } else {
+      return false;
+    }
+
+    if (accept(close)) {
+      return true;
+    }
+    do {
+      std::string_view key;
+      if (object && (!string(key) || !accept(':'))) {
+        return false;
+      }
+      if (!visit()) {
+        return false;
+      }
+    } while (accept(','));
+    return accept(close);
+  }
+
+  /**
+   * @brief Call visit(key) on each member of an object
+   */
+  template <typename Visit>
+  bool members(Visit &&visit) {
+    if (!accept('{')) {
+      return false;
+    }
+
+    if (accept('}')) {
+      return true;
+    }
+    do {
+      std::string_view key;
+      if (!string(key) || !accept(':')) {
+        return false;
+      }
+      if (!visit(key)) {
+        return false;
+      }
+    } while (accept(','));
+    return accept('}');
+  }
+
+ private:
+  static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+  static bool is_space(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+  void skip_space() {
+    while (_cur != _end && is_space(*_cur)) {
+      ++_cur;
+    }
+  }
+
+ private:
+  const char *_cur;
+  const char *_end;
+};
+
+bool read_registers(JsonCursor &cursor, std::vector<int> &registers) {
+  return cursor.elements([&]() {
+    i64 reg;
+    if (!cursor.integer(reg)) {
+      return false;
+    }
+    registers.push_back(reg);
+    return true;
+  });
+}
+
+// srcs: [{"id": reg, "assign_pcs": [pc...]}...]
+bool read_sources(JsonCursor &cursor, std::string_view pcs_key, std::vector<int> &srcs,
+                  std::map<int, std::vector<int>> &assign_pcs) {
+  std::vector<int> pcs;
+  return cursor.elements([&]() {
+    i64 src = 0;
+    pcs.clear();
+    bool ok = cursor.members([&](std::string_view key) {
+      if (key == "id") {
+        return cursor.integer(src);
+      } else if (key == pcs_key) {
+        return read_registers(cursor, pcs);
+      }
+      return cursor.skip();
+    });
+    if (!ok) {
+      return false;
+    }
+
+    srcs.push_back(src);
+    if (!pcs.empty()) {
+      auto &src_pcs = assign_pcs[src];
+      src_pcs.insert(src_pcs.end(), pcs.begin(), pcs.end());
+    }
+    return true;
+  });
+}
+
+bool read_instruction(JsonCursor &cursor, Instruction &inst) {
+  inst.pc = 0;
+  inst.predicate = -1;
+
+  return cursor.members([&](std::string_view key) {
+    if (key == "pc") {
+      i64 pc;
+      if (!cursor.integer(pc)) {
+        return false;
+      }
+      inst.pc = pc;
+      return true;
+    } else if (key == "op") {
+      std::string_view op;
+      if (!cursor.string(op)) {
+        return false;
+      }
+      inst.op.assign(op.data(), op.size());
+      return true;
+    } else if (key == "pred") {
+      i64 pred;
+      if (!cursor.integer(pred)) {
+        return false;
+      }
+      inst.predicate = pred;
+      return true;
+    } else if (key == "dsts") {
+      return read_registers(cursor, inst.dsts);
+    } else if (key == "udsts") {
+      return read_registers(cursor, inst.udsts);
+    } else if (key == "srcs") {
+      return read_sources(cursor, "assign_pcs", inst.srcs, inst.assign_pcs);
+    } else if (key == "usrcs") {
+      return read_sources(cursor, "uassign_pcs", inst.usrcs, inst.uassign_pcs);
+    }
+    return cursor.skip();
+  });
+}
+
+// Instruction pcs are relative to the function
+void relocate(Instruction &inst, int cubin_offset) {
+  inst.pc += cubin_offset;
+  for (auto &iter : inst.assign_pcs) {
+    for (auto &pc : iter.second) {
+      pc += cubin_offset;
+    }
+  }
+  for (auto &iter : inst.uassign_pcs) {
+    for (auto &pc : iter.second) {
+      pc += cubin_offset;
+    }
+  }
+}
+
+// The function's address may follow its blocks, so its instructions are relocated at the end
+bool read_function(JsonCursor &cursor, Vector<Instruction> &insts, SymbolVector &symbols,
+                   InstructionGraph &inst_graph) {
+  i64 function_index = 0;
+  i64 cubin_offset = 0;
+  insts.clear();
+
+  bool ok = cursor.members([&](std::string_view key) {
+    if (key == "index") {
+      return cursor.integer(function_index);
+    } else if (key == "address") {
+      return cursor.integer(cubin_offset);
+    } else if (key == "blocks") {
+      return cursor.elements([&]() {
+        return cursor.members([&](std::string_view key) {
+          if (key == "insts") {
+            return cursor.elements([&]() {
+              insts.emplace_back();
+              return read_instruction(cursor, insts.back());
+            });
+          }
+          return cursor.skip();
+        });
+      });
+    }
+    return cursor.skip();
+  });
+
+  if (!ok || function_index < 0) {
+    return false;
+  }
+
+  // Ensure space
+  symbols.resize(MAX2(symbols.size(), function_index + 1));
+  symbols[function_index] = Symbol(function_index, cubin_offset);
+
+  for (auto &inst : insts) {
+    relocate(inst, cubin_offset);
+    u64 pc = inst.pc;
+    inst_graph.add_node(pc, std::move(inst));
+  }
+  return true;
+}
+
+}  // namespace
+
+bool InstructionReader::read(const std::string &file_path, SymbolVector &symbols,
+                             InstructionGraph &inst_graph) {
+  MappedFile file(file_path);
+  if (file.data() == NULL) {
+    return false;
+  }
+
+  JsonCursor cursor(file.data(), file.data() + file.size());
+  // Reused across functions
+  Vector<Instruction> insts;
+  bool ok = cursor.elements([&]() { return read_function(cursor, insts, symbols, inst_graph); });
+
+  return ok && cursor.done();
+}
+
+}  // namespace redshow
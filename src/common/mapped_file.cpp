@@ -0,0 +1,35 @@
+#include "common/mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace redshow {
+
+MappedFile::MappedFile(const std::string &file_path) {
+  int fd = open(file_path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      // Files are scanned from the beginning to the end
+      madvise(data, st.st_size, MADV_SEQUENTIAL);
+      _data = reinterpret_cast<const char *>(data);
+      _size = st.st_size;
+    }
+  }
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (_data != NULL) {
+    munmap(const_cast<char *>(_data), _size);
+  }
+}
+
+}  // namespace redshow
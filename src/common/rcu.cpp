@@ -0,0 +1,129 @@
+#include "common/rcu.h"
+
+#include <deque>
+#include <limits>
+
+#include "common/vector.h"
+
+namespace redshow {
+
+struct RcuReader {
+  // Epoch announced by the outermost read section, 0 if the thread is not reading
+  std::atomic<u64> epoch{0};
+  std::atomic<bool> used{true};
+};
+
+struct RcuRetired {
+  u64 epoch;
+  std::function<void()> reclaim;
+
+  RcuRetired(u64 epoch, std::function<void()> reclaim) : epoch(epoch), reclaim(std::move(reclaim)) {}
+};
+
+struct RcuRegistry {
+  std::atomic<u64> epoch{1};
+  std::mutex lock;
+  // Readers are reused by later threads, never freed
+  Vector<RcuReader *> readers;
+  // Sorted by epoch
+  std::deque<RcuRetired> retired;
+};
+
+static RcuRegistry &registry() {
+  // Never destroyed, threads may exit after static destructors
+  static RcuRegistry *registry = new RcuRegistry();
+  return *registry;
+}
+
+namespace {
+
+struct RcuThread {
+  RcuReader *reader = NULL;
+  u32 depth = 0;
+
+  RcuThread() {
+    auto &rcu_registry = registry();
+    std::unique_lock<std::mutex> lock(rcu_registry.lock);
+    for (auto *unused_reader : rcu_registry.readers) {
+      if (!unused_reader->used.load(std::memory_order_relaxed)) {
+        unused_reader->used.store(true, std::memory_order_relaxed);
+        reader = unused_reader;
+        return;
+      }
+    }
+    reader = new RcuReader();
+    rcu_registry.readers.push_back(reader);
+  }
+
+  ~RcuThread() {
+    auto &rcu_registry = registry();
+    std::unique_lock<std::mutex> lock(rcu_registry.lock);
+    reader->epoch.store(0, std::memory_order_release);
+    reader->used.store(false, std::memory_order_relaxed);
+  }
+};
+
+RcuThread &rcu_thread() {
+  static thread_local RcuThread thread;
+  return thread;
+}
+
+}  // namespace
+
+void Rcu::read_lock() {
+  auto &thread = rcu_thread();
+  if (thread.depth++ == 0) {
+    thread.reader->epoch.store(registry().epoch.load(std::memory_order_seq_cst),
+                               std::memory_order_seq_cst);
+    // Objects are loaded after the announcement is visible to writers
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+void Rcu::read_unlock() {
+  auto &thread = rcu_thread();
+  if (--thread.depth == 0) {
+    thread.reader->epoch.store(0, std::memory_order_release);
+  }
+}
+
+void Rcu::retire(std::function<void()> reclaim) {
+  auto &rcu_registry = registry();
+  {
+    std::unique_lock<std::mutex> lock(rcu_registry.lock);
+    // Readers that announce a later epoch see the replacement
+    auto epoch = rcu_registry.epoch.fetch_add(1, std::memory_order_seq_cst);
+    rcu_registry.retired.emplace_back(epoch, std::move(reclaim));
+  }
+
+  Rcu::reclaim();
+}
+
+void Rcu::reclaim() {
+  auto &rcu_registry = registry();
+  std::deque<RcuRetired> reclaimable;
+  {
+    std::unique_lock<std::mutex> lock(rcu_registry.lock);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    auto min_epoch = std::numeric_limits<u64>::max();
+    for (auto *reader : rcu_registry.readers) {
+      auto epoch = reader->epoch.load(std::memory_order_seq_cst);
+      if (epoch != 0) {
+        min_epoch = MIN2(min_epoch, epoch);
+      }
+    }
+
+    while (!rcu_registry.retired.empty() && rcu_registry.retired.front().epoch < min_epoch) {
+      reclaimable.emplace_back(std::move(rcu_registry.retired.front()));
+      rcu_registry.retired.pop_front();
+    }
+  }
+
+  // Reclaim may retire other objects
+  for (auto &retired : reclaimable) {
+    retired.reclaim();
+  }
+}
+
+}  // namespace redshow
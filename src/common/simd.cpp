@@ -0,0 +1,166 @@
+#include "common/simd.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace redshow {
+
+static_assert(GPU_PATCH_WARP_SIZE % 8 == 0, "Vector loops process 8 lanes at a time");
+
+static void extract_u32_scalar(const u8 *block, u32 offset, u64 mask, u64 *values) {
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    u32 value;
+    memcpy(&value, block + j * GPU_PATCH_MAX_ACCESS_SIZE + offset, sizeof(value));
+    values[j] = value & mask;
+  }
+}
+
+static void extract_u64_scalar(const u8 *block, u32 offset, u64 mask, u64 *values) {
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    u64 value;
+    memcpy(&value, block + j * GPU_PATCH_MAX_ACCESS_SIZE + offset, sizeof(value));
+    values[j] = value & mask;
+  }
+}
+
+static void mask_scalar(const u64 *src, u64 mask, u64 *dst) {
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    dst[j] = src[j] & mask;
+  }
+}
+
+#if defined(__x86_64__)
+
+// Vector versions load whole lanes and pick the units with permutes, which needs lanes of
+// 16 bytes and offsets that are multiples of the unit size
+
+__attribute__((target("avx2"))) static void extract_u64_avx2(const u8 *block, u32 offset,
+                                                             u64 mask, u64 *values) {
+  const __m256i masks = _mm256_set1_epi64x(mask);
+  auto *lanes = reinterpret_cast<const __m256i *>(block);
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; j += 4, lanes += 2) {
+    __m256i a = _mm256_loadu_si256(lanes);
+    __m256i b = _mm256_loadu_si256(lanes + 1);
+    // <lane 0, lane 2, lane 1, lane 3>
+    __m256i units = offset == 0 ? _mm256_unpacklo_epi64(a, b) : _mm256_unpackhi_epi64(a, b);
+    units = _mm256_permute4x64_epi64(units, _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(values + j), _mm256_and_si256(units, masks));
+  }
+}
+
+__attribute__((target("avx2"))) static void mask_avx2(const u64 *src, u64 mask, u64 *dst) {
+  const __m256i masks = _mm256_set1_epi64x(mask);
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; j += 4) {
+    __m256i units = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + j));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + j), _mm256_and_si256(units, masks));
+  }
+}
+
+__attribute__((target("avx512f"))) static void extract_u32_avx512(const u8 *block, u32 offset,
+                                                                  u64 mask, u64 *values) {
+  // Unit k of the 8 lanes in a pair of vectors
+  const u32 k = offset / sizeof(u32);
+  const __m512i units = _mm512_add_epi32(
+      _mm512_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28, 0, 4, 8, 12, 16, 20, 24, 28),
+      _mm512_set1_epi32(k));
+  const __m512i masks = _mm512_set1_epi64(mask);
+  auto *lanes = reinterpret_cast<const __m512i *>(block);
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; j += 8, lanes += 2) {
+    __m512i a = _mm512_loadu_si512(lanes);
+    __m512i b = _mm512_loadu_si512(lanes + 1);
+    __m512i low = _mm512_cvtepu32_epi64(
+        _mm512_castsi512_si256(_mm512_permutex2var_epi32(a, units, b)));
+    _mm512_storeu_si512(values + j, _mm512_and_si512(low, masks));
+  }
+}
+
+__attribute__((target("avx512f"))) static void extract_u64_avx512(const u8 *block, u32 offset,
+                                                                  u64 mask, u64 *values) {
+  // Unit k of the 8 lanes in a pair of vectors
+  const u64 k = offset / sizeof(u64);
+  const __m512i units =
+      _mm512_add_epi64(_mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14), _mm512_set1_epi64(k));
+  const __m512i masks = _mm512_set1_epi64(mask);
+  auto *lanes = reinterpret_cast<const __m512i *>(block);
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; j += 8, lanes += 2) {
+    __m512i a = _mm512_loadu_si512(lanes);
+    __m512i b = _mm512_loadu_si512(lanes + 1);
+    __m512i units_ab = _mm512_permutex2var_epi64(a, units, b);
+    _mm512_storeu_si512(values + j, _mm512_and_si512(units_ab, masks));
+  }
+}
+
+__attribute__((target("avx512f"))) static void mask_avx512(const u64 *src, u64 mask, u64 *dst) {
+  const __m512i masks = _mm512_set1_epi64(mask);
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; j += 8) {
+    __m512i units = _mm512_loadu_si512(src + j);
+    _mm512_storeu_si512(dst + j, _mm512_and_si512(units, masks));
+  }
+}
+
+// The 32-bit extract of AVX2 needs two permutes and a widening per pair of lanes, and is slower
+// than the scalar loop
+static const SimdWarpFunctions SIMD_WARP_FUNCTIONS[SIMD_LEVEL_COUNT] = {
+    {extract_u32_scalar, extract_u64_scalar, mask_scalar},
+    {extract_u32_scalar, extract_u64_avx2, mask_avx2},
+    {extract_u32_avx512, extract_u64_avx512, mask_avx512}};
+
+static SimdLevel detect_simd_level() {
+  if (GPU_PATCH_MAX_ACCESS_SIZE != 16) {
+    return SIMD_SCALAR;
+  }
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SIMD_AVX512;
+  } else if (__builtin_cpu_supports("avx2")) {
+    return SIMD_AVX2;
+  }
+  return SIMD_SCALAR;
+}
+
+#else
+
+// Only scalar versions on other architectures
+static const SimdWarpFunctions SIMD_WARP_FUNCTIONS[SIMD_LEVEL_COUNT] = {
+    {extract_u32_scalar, extract_u64_scalar, mask_scalar},
+    {extract_u32_scalar, extract_u64_scalar, mask_scalar},
+    {extract_u32_scalar, extract_u64_scalar, mask_scalar}};
+
+static SimdLevel detect_simd_level() { return SIMD_SCALAR; }
+
+#endif
+
+SimdLevel simd_level() {
+  static const SimdLevel level = detect_simd_level();
+  return level;
+}
+
+bool simd_supported(SimdLevel level) { return level <= simd_level(); }
+
+const char *simd_level_name(SimdLevel level) {
+  switch (level) {
+    case SIMD_SCALAR:
+      return "scalar";
+    case SIMD_AVX2:
+      return "avx2";
+    case SIMD_AVX512:
+      return "avx512";
+    default:
+      return "unknown";
+  }
+}
+
+const SimdWarpFunctions &simd_warp_functions(SimdLevel level) {
+  return SIMD_WARP_FUNCTIONS[level];
+}
+
+const SimdWarpFunctions &simd_warp_functions() {
+  static const SimdWarpFunctions &functions = SIMD_WARP_FUNCTIONS[simd_level()];
+  return functions;
+}
+
+}  // namespace redshow
@@ -0,0 +1,181 @@
+#include "common/stats.h"
+
+#include <fstream>
+#include <mutex>
+
+#include "common/set.h"
+
+namespace redshow {
+
+struct StatsRegistry {
+  std::mutex lock;
+  Set<void *> threads;
+  // Slots of exited threads
+  u64 retired[STATS_COUNTER_COUNT] = {0};
+};
+
+static StatsRegistry &registry() {
+  // Never destroyed, threads may exit after static destructors
+  static StatsRegistry *registry = new StatsRegistry();
+  return *registry;
+}
+
+Stats::ThreadStats::ThreadStats() {
+  for (auto &value : values) {
+    value.store(0, std::memory_order_relaxed);
+  }
+
+  auto &stats_registry = registry();
+  std::unique_lock<std::mutex> lock(stats_registry.lock);
+  stats_registry.threads.insert(this);
+}
+
+Stats::ThreadStats::~ThreadStats() {
+  auto &stats_registry = registry();
+  std::unique_lock<std::mutex> lock(stats_registry.lock);
+  for (size_t i = 0; i < STATS_COUNTER_COUNT; ++i) {
+    stats_registry.retired[i] += values[i].load(std::memory_order_relaxed);
+  }
+  stats_registry.threads.erase(this);
+}
+
+void Stats::merge(u64 *values) {
+  // Make sure the calling thread is registered
+  local();
+
+  auto &stats_registry = registry();
+  std::unique_lock<std::mutex> lock(stats_registry.lock);
+  for (size_t i = 0; i < STATS_COUNTER_COUNT; ++i) {
+    values[i] = stats_registry.retired[i];
+  }
+  for (auto *thread : stats_registry.threads) {
+    auto *thread_stats = reinterpret_cast<ThreadStats *>(thread);
+    for (size_t i = 0; i < STATS_COUNTER_COUNT; ++i) {
+      values[i] += thread_stats->values[i].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void Stats::get(redshow_stats_t *stats) {
+  u64 values[STATS_COUNTER_COUNT];
+  merge(values);
+
+  for (u32 i = 0; i < GPU_PATCH_TYPE_COUNT; ++i) {
+    stats->trace_count[i] = values[stats_trace(i)];
+    stats->trace_ns[i] = values[stats_trace(i) + 1];
+    stats->trace_records[i] = values[STATS_TRACE_RECORDS + i];
+  }
+  stats->cubin_count = values[STATS_CUBIN];
+  stats->cubin_ns = values[STATS_CUBIN + 1];
+  stats->trace_copy_count = values[STATS_TRACE_COPY];
+  stats->trace_copy_bytes = values[STATS_TRACE_COPY_BYTES];
+  stats->dtoh_count = values[STATS_DTOH];
+  stats->dtoh_ns = values[STATS_DTOH + 1];
+  stats->dtoh_bytes = values[STATS_DTOH_BYTES];
+  stats->out_of_bounds_accesses = values[STATS_OUT_OF_BOUNDS_ACCESSES];
+  stats->unknown_memory_accesses = values[STATS_UNKNOWN_MEMORY_ACCESSES];
+  stats->lock_wait_count = values[STATS_LOCK_WAIT];
+  stats->lock_wait_ns = values[STATS_LOCK_WAIT + 1];
+  stats->instruction_cache_hits = values[STATS_INSTRUCTION_CACHE_HITS];
+  stats->instruction_cache_misses = values[STATS_INSTRUCTION_CACHE_MISSES];
+  stats->instruction_shared = values[STATS_INSTRUCTION_SHARED];
+  stats->cubin_prefetch_hits = values[STATS_CUBIN_PREFETCH_HITS];
+  stats->cubin_prefetch_wait_count = values[STATS_CUBIN_PREFETCH_WAIT];
+  stats->cubin_prefetch_wait_ns = values[STATS_CUBIN_PREFETCH_WAIT + 1];
+  stats->memory_tlb_hits = values[STATS_MEMORY_TLB_HITS];
+  stats->memory_tlb_misses = values[STATS_MEMORY_TLB_MISSES];
+  stats->deduplicated_records = values[STATS_DEDUPLICATED_RECORDS];
+
+  for (u32 i = 0; i < REDSHOW_ANALYSIS_COUNT; ++i) {
+    auto &analysis = stats->analysis[i];
+    analysis.begin_count = values[stats_analysis(i, STATS_PHASE_BEGIN)];
+    analysis.begin_ns = values[stats_analysis(i, STATS_PHASE_BEGIN) + 1];
+    analysis.access_count = values[stats_analysis(i, STATS_PHASE_ACCESS)];
+    analysis.access_ns = values[stats_analysis(i, STATS_PHASE_ACCESS) + 1];
+    analysis.end_count = values[stats_analysis(i, STATS_PHASE_END)];
+    analysis.end_ns = values[stats_analysis(i, STATS_PHASE_END) + 1];
+    analysis.op_callback_count = values[stats_analysis(i, STATS_PHASE_OP_CALLBACK)];
+    analysis.op_callback_ns = values[stats_analysis(i, STATS_PHASE_OP_CALLBACK) + 1];
+    analysis.flush_count = values[stats_analysis(i, STATS_PHASE_FLUSH)];
+    analysis.flush_ns = values[stats_analysis(i, STATS_PHASE_FLUSH) + 1];
+  }
+}
+
+static void dump_pair(std::ofstream &out, const char *name, u64 count, const char *unit,
+                      u64 value) {
+  out << "\"" << name << "\": {\"count\": " << count << ", \"" << unit << "\": " << value << "}";
+}
+
+void Stats::dump(const std::string &file_name) {
+  static const char *trace_names[] = {"default", "address_patch", "address_analysis"};
+  static const char *analysis_names[] = {
+      "unknown",         "spatial_redundancy", "temporal_redundancy", "value_pattern",
+      "data_flow",       "memory_profile",     "memory_heatmap",      "memory_liveness",
+      "data_dependency", "torch_monitor"};
+  static const char *phase_names[] = {"begin", "access", "end", "op_callback", "flush"};
+
+  u64 values[STATS_COUNTER_COUNT];
+  merge(values);
+
+  std::ofstream out(file_name);
+  out << "{" << std::endl;
+
+  out << "  \"trace\": {" << std::endl;
+  for (u32 i = 0; i < GPU_PATCH_TYPE_COUNT; ++i) {
+    out << "    \"" << trace_names[i] << "\": {\"count\": " << values[stats_trace(i)]
+        << ", \"ns\": " << values[stats_trace(i) + 1]
+        << ", \"records\": " << values[STATS_TRACE_RECORDS + i] << "}"
+        << (i + 1 < GPU_PATCH_TYPE_COUNT ? "," : "") << std::endl;
+  }
+  out << "  }," << std::endl;
+
+  out << "  ";
+  dump_pair(out, "cubin", values[STATS_CUBIN], "ns", values[STATS_CUBIN + 1]);
+  out << "," << std::endl << "  ";
+  dump_pair(out, "trace_copy", values[STATS_TRACE_COPY], "bytes", values[STATS_TRACE_COPY_BYTES]);
+  out << "," << std::endl;
+  out << "  \"dtoh\": {\"count\": " << values[STATS_DTOH] << ", \"ns\": " << values[STATS_DTOH + 1]
+      << ", \"bytes\": " << values[STATS_DTOH_BYTES] << "}," << std::endl;
+  out << "  \"out_of_bounds_accesses\": " << values[STATS_OUT_OF_BOUNDS_ACCESSES] << ","
+      << std::endl;
+  out << "  \"unknown_memory_accesses\": " << values[STATS_UNKNOWN_MEMORY_ACCESSES] << ","
+      << std::endl << "  ";
+  dump_pair(out, "lock_wait", values[STATS_LOCK_WAIT], "ns", values[STATS_LOCK_WAIT + 1]);
+  out << "," << std::endl;
+  out << "  \"instruction_cache\": {\"hits\": " << values[STATS_INSTRUCTION_CACHE_HITS]
+      << ", \"misses\": " << values[STATS_INSTRUCTION_CACHE_MISSES] << "}," << std::endl;
+  out << "  \"instruction_shared\": " << values[STATS_INSTRUCTION_SHARED] << "," << std::endl;
+  out << "  \"cubin_prefetch\": {\"hits\": " << values[STATS_CUBIN_PREFETCH_HITS]
+      << ", \"wait_count\": " << values[STATS_CUBIN_PREFETCH_WAIT]
+      << ", \"wait_ns\": " << values[STATS_CUBIN_PREFETCH_WAIT + 1] << "}," << std::endl;
+  out << "  \"memory_tlb\": {\"hits\": " << values[STATS_MEMORY_TLB_HITS]
+      << ", \"misses\": " << values[STATS_MEMORY_TLB_MISSES] << "}," << std::endl;
+  out << "  \"deduplicated_records\": " << values[STATS_DEDUPLICATED_RECORDS] << "," << std::endl;
+
+  out << "  \"analysis\": {";
+  bool first = true;
+  for (u32 i = REDSHOW_ANALYSIS_SPATIAL_REDUNDANCY; i < REDSHOW_ANALYSIS_COUNT; ++i) {
+    u64 calls = 0;
+    for (u32 j = 0; j < STATS_PHASE_COUNT; ++j) {
+      calls += values[stats_analysis(i, static_cast<StatsPhase>(j))];
+    }
+    if (calls == 0) {
+      // Not enabled
+      continue;
+    }
+
+    out << (first ? "" : ",") << std::endl << "    \"" << analysis_names[i] << "\": {";
+    first = false;
+    for (u32 j = 0; j < STATS_PHASE_COUNT; ++j) {
+      auto counter = stats_analysis(i, static_cast<StatsPhase>(j));
+      dump_pair(out, phase_names[j], values[counter], "ns", values[counter + 1]);
+      out << (j + 1 < STATS_PHASE_COUNT ? ", " : "");
+    }
+    out << "}";
+  }
+  out << std::endl << "  }" << std::endl;
+
+  out << "}" << std::endl;
+}
+
+}  // namespace redshow
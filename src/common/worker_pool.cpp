@@ -0,0 +1,94 @@
+#include "common/worker_pool.h"
+
+namespace redshow {
+
+void WorkerPool::start(u32 num_workers, u64 budget) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_running) {
+    return;
+  }
+
+  _budget = budget;
+  _stopping = false;
+  _running = true;
+  for (u32 i = 0; i < MAX2(num_workers, 1u); ++i) {
+    _workers.emplace_back(std::make_unique<Worker>());
+  }
+  for (auto &worker : _workers) {
+    auto *w = worker.get();
+    w->thread = std::thread([this, w]() { work(*w); });
+  }
+}
+
+void WorkerPool::stop() {
+  {
+    std::unique_lock<std::mutex> lock(_lock);
+    if (!_running) {
+      return;
+    }
+    _stopping = true;
+    for (auto &worker : _workers) {
+      worker->ready.notify_one();
+    }
+  }
+
+  for (auto &worker : _workers) {
+    worker->thread.join();
+  }
+
+  std::unique_lock<std::mutex> lock(_lock);
+  _workers.clear();
+  _running = false;
+}
+
+bool WorkerPool::running() const {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  return _running;
+}
+
+void WorkerPool::submit(u64 key, u64 bytes, Task task) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  // Backpressure, a single task larger than the budget is still accepted by an empty queue
+  _done.wait(lock, [&]() { return _queued_bytes == 0 || _queued_bytes + bytes <= _budget; });
+
+  auto &worker = _workers[key % _workers.size()];
+  worker->tasks.emplace_back(bytes, std::move(task));
+  _queued_bytes += bytes;
+  ++_pending;
+  worker->ready.notify_one();
+}
+
+void WorkerPool::drain() {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  _done.wait(lock, [&]() { return _pending == 0; });
+}
+
+void WorkerPool::work(Worker &worker) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  while (true) {
+    worker.ready.wait(lock, [&]() { return _stopping || !worker.tasks.empty(); });
+    if (worker.tasks.empty()) {
+      // Stopping and nothing left
+      break;
+    }
+
+    auto bytes = worker.tasks.front().first;
+    auto task = std::move(worker.tasks.front().second);
+    worker.tasks.pop_front();
+
+    lock.unlock();
+    task();
+    lock.lock();
+
+    _queued_bytes -= bytes;
+    --_pending;
+    _done.notify_all();
+  }
+}
+
+}  // namespace redshow
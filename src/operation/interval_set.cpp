@@ -0,0 +1,74 @@
+#include "operation/interval_set.h"
+
+#include <algorithm>
+
+namespace redshow {
+
+void IntervalSet::normalize() {
+  if (_normalized) {
+    return;
+  }
+
+  std::sort(_ranges.begin(), _ranges.end());
+
+  size_t last = 0;
+  for (size_t i = 1; i < _ranges.size(); ++i) {
+    if (_ranges[i].start <= _ranges[last].end) {
+      _ranges[last].end = MAX2(_ranges[last].end, _ranges[i].end);
+    } else {
+      _ranges[++last] = _ranges[i];
+    }
+  }
+  _ranges.resize(last + 1);
+  _normalized = true;
+}
+
+void IntervalSet::merge(const IntervalSet &other) {
+  if (other.empty()) {
+    return;
+  }
+
+  if (empty()) {
+    _ranges = other._ranges;
+    return;
+  }
+
+  if (other.front().start > back().end) {
+    // Fast path, other is after this set
+    _ranges.insert(_ranges.end(), other._ranges.begin(), other._ranges.end());
+    return;
+  }
+
+  Vector<MemoryRange> ranges;
+  ranges.reserve(_ranges.size() + other._ranges.size());
+
+  auto iter = _ranges.begin();
+  auto other_iter = other._ranges.begin();
+  while (iter != _ranges.end() || other_iter != other._ranges.end()) {
+    const MemoryRange *range = NULL;
+    if (other_iter == other._ranges.end() ||
+        (iter != _ranges.end() && iter->start <= other_iter->start)) {
+      range = &*(iter++);
+    } else {
+      range = &*(other_iter++);
+    }
+
+    if (!ranges.empty() && range->start <= ranges.back().end) {
+      ranges.back().end = MAX2(ranges.back().end, range->end);
+    } else {
+      ranges.push_back(*range);
+    }
+  }
+
+  _ranges = std::move(ranges);
+}
+
+u64 IntervalSet::bytes() const {
+  u64 bytes = 0;
+  for (auto &range : _ranges) {
+    bytes += range.end - range.start;
+  }
+  return bytes;
+}
+
+}  // namespace redshow
@@ -0,0 +1,196 @@
+#include "operation/memory_index.h"
+
+#include <algorithm>
+
+namespace redshow {
+
+// Priorities are derived from starts, so the shape of a tree only depends on its objects
+static u64 node_priority(u64 start) {
+  u64 z = start + 0x9E3779B97F4A7C15ul;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ul;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBul;
+  return z ^ (z >> 31);
+}
+
+MemoryIndex::NodePtr MemoryIndex::make_node(const Node &node, NodePtr left, NodePtr right) {
+  auto size = 1 + (left == NULL ? 0 : left->size) + (right == NULL ? 0 : right->size);
+  return std::make_shared<const Node>(
+      Node{node.start, node.priority, size, node.memory, std::move(left), std::move(right)});
+}
+
+void MemoryIndex::split(const NodePtr &node, u64 start, NodePtr &left, NodePtr &right) {
+  if (node == NULL) {
+    left = NULL;
+    right = NULL;
+  } else if (node->start < start) {
+    NodePtr right_left;
+    split(node->right, start, right_left, right);
+    left = make_node(*node, node->left, std::move(right_left));
+  } else {
+    NodePtr left_right;
+    split(node->left, start, left, left_right);
+    right = make_node(*node, std::move(left_right), node->right);
+  }
+}
+
+MemoryIndex::NodePtr MemoryIndex::merge(const NodePtr &left, const NodePtr &right) {
+  if (left == NULL) {
+    return right;
+  } else if (right == NULL) {
+    return left;
+  } else if (left->priority > right->priority) {
+    return make_node(*left, left->left, merge(left->right, right));
+  } else {
+    return make_node(*right, merge(left, right->left), right->right);
+  }
+}
+
+MemoryIndex::NodePtr MemoryIndex::insert_node(const NodePtr &root,
+                                              std::shared_ptr<Memory> memory) {
+  auto start = memory->memory_range.start;
+  Node node{start, node_priority(start), 1, std::move(memory), NULL, NULL};
+
+  NodePtr left, right;
+  split(root, start, left, right);
+  return merge(merge(left, std::make_shared<const Node>(std::move(node))), right);
+}
+
+MemoryIndex::NodePtr MemoryIndex::erase_node(const NodePtr &root, u64 start) {
+  NodePtr left, right, middle, rest;
+  split(root, start, left, right);
+  split(right, start + 1, middle, rest);
+  return merge(left, rest);
+}
+
+const MemoryIndex::Node *MemoryIndex::lower_node(const Node *node, u64 addr) {
+  const Node *lower = NULL;
+  while (node != NULL) {
+    if (node->start <= addr) {
+      lower = node;
+      node = node->right.get();
+    } else {
+      node = node->left.get();
+    }
+  }
+  return lower;
+}
+
+const MemoryIndex::Node *MemoryIndex::root(u64 op_id) const {
+  if (_versions.empty() || op_id < _versions.front().op_id) {
+    return NULL;
+  }
+
+  if (op_id >= _versions.back().op_id) {
+    // Fast path, no operation after op_id
+    return _versions.back().root.get();
+  }
+
+  auto iter = std::upper_bound(
+      _versions.begin(), _versions.end(), op_id,
+      [](u64 op_id, const Version &version) { return op_id < version.op_id; });
+  return (iter - 1)->root.get();
+}
+
+std::deque<MemoryIndex::Version>::iterator MemoryIndex::version_at(u64 op_id) {
+  if (_versions.empty() || op_id > _versions.back().op_id) {
+    // Operations are mostly registered in order
+    NodePtr root = _versions.empty() ? NULL : _versions.back().root;
+    _versions.push_back(Version{op_id, std::move(root)});
+    return _versions.end() - 1;
+  }
+
+  auto iter = std::upper_bound(
+      _versions.begin(), _versions.end(), op_id,
+      [](u64 op_id, const Version &version) { return op_id < version.op_id; });
+  if (iter != _versions.begin() && (iter - 1)->op_id == op_id) {
+    return iter - 1;
+  }
+  NodePtr root = iter == _versions.begin() ? NULL : (iter - 1)->root;
+  return _versions.insert(iter, Version{op_id, std::move(root)});
+}
+
+redshow_result_t MemoryIndex::insert(std::shared_ptr<Memory> memory) {
+  auto op_id = memory->op_id;
+  auto start = memory->memory_range.start;
+
+  if (_first_op_id != ALIVE && op_id < _first_op_id) {
+    // Cannot register an object before the first snapshot
+    return REDSHOW_ERROR_NOT_EXIST_ENTRY;
+  }
+
+  if (find_node(root(op_id), start) != NULL) {
+    return REDSHOW_ERROR_DUPLICATE_ENTRY;
+  }
+
+  auto iter = version_at(op_id);
+  for (auto later = iter + 1; later != _versions.end(); ++later) {
+    if (find_node(later->root.get(), start) != NULL) {
+      // A later allocation at the same address was registered first
+      return REDSHOW_ERROR_DUPLICATE_ENTRY;
+    }
+  }
+
+  // The object is alive in all the following versions until it is freed
+  for (; iter != _versions.end(); ++iter) {
+    iter->root = insert_node(iter->root, memory);
+  }
+
+  _first_op_id = MIN2(_first_op_id, op_id);
+  ++_version;
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t MemoryIndex::erase(u64 op_id, const MemoryRange &memory_range) {
+  if (!has_snapshot(op_id)) {
+    return REDSHOW_ERROR_NOT_EXIST_ENTRY;
+  }
+
+  auto start = memory_range.start;
+  auto *node = find_node(root(op_id), start);
+  if (node == NULL) {
+    return REDSHOW_ERROR_NOT_EXIST_ENTRY;
+  }
+  // Kept alive while versions are updated
+  auto memory = node->memory;
+
+  for (auto iter = version_at(op_id); iter != _versions.end(); ++iter) {
+    node = find_node(iter->root.get(), start);
+    if (node == NULL || node->memory != memory) {
+      break;
+    }
+    iter->root = erase_node(iter->root, start);
+  }
+
+  ++_version;
+
+  return REDSHOW_SUCCESS;
+}
+
+const Memory *MemoryIndex::find(u64 op_id, u64 addr) const {
+  if (!has_snapshot(op_id)) {
+    return NULL;
+  }
+
+  // Alive objects never overlap, so only the nearest object below addr can contain it
+  auto *node = lower_node(root(op_id), addr);
+  if (node != NULL && addr < node->memory->memory_range.end) {
+    return node->memory.get();
+  }
+  return NULL;
+}
+
+void MemoryIndex::prune(u64 op_id) {
+  // Queries as of op_id or later start from the last version at or before op_id
+  bool pruned = false;
+  while (_versions.size() > 1 && _versions[1].op_id <= op_id) {
+    _versions.pop_front();
+    pruned = true;
+  }
+
+  if (pruned) {
+    ++_version;
+  }
+}
+
+}  // namespace redshow
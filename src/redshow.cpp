@@ -20,20 +20,29 @@
 #include "analysis/data_flow.h"
 #include "analysis/spatial_redundancy.h"
 #include "analysis/temporal_redundancy.h"
+#include "analysis/value_decoder.h"
 #include "analysis/value_pattern.h"
 #include "binutils/cubin.h"
+#include "binutils/cubin_prefetcher.h"
+#include "binutils/function_index.h"
 #include "binutils/instruction.h"
+#include "binutils/instruction_cache.h"
 #include "binutils/real_pc.h"
 #include "binutils/symbol.h"
 #include "common/map.h"
+#include "common/rcu.h"
 #include "common/set.h"
+#include "common/stats.h"
 #include "common/utils.h"
 #include "common/vector.h"
+#include "common/worker_pool.h"
 #include "operation/kernel.h"
 #include "operation/memcpy.h"
 #include "operation/memory.h"
+#include "operation/memory_index.h"
 #include "operation/memset.h"
 #include "operation/memfree.h"
+#include "replay/trace_file.h"
 
 #include "torch_monitor.h"
 
@@ -49,25 +58,51 @@ using namespace redshow;
  * Global data structures
  */
 
-static LockableMap<uint32_t, Cubin> cubin_map;
+// Read without locking in RCU read sections, e.g., by analyses flushing results
+static CubinMap cubin_map;
 
-static LockableMap<uint32_t, CubinCache> cubin_cache_map;
+static CubinCacheMap cubin_cache_map;
 
+// <instruction file key, parse>
+static LockableMap<std::string, SharedCubinParse> shared_cubin_map;
 
-// MemoryMap(<range, object>) is a map with current object
-typedef Map<MemoryRange, std::shared_ptr<Memory>> MemoryMap;
-// <op_id, memory_map>
-static LockableMap<uint64_t, MemoryMap> memory_snapshot;
+// Functions of the modules in cubin_map by runtime pc, read by analyses without locking cubin_map
+static FunctionIndex function_index;
+
+
+// Memory objects with their [alloc_op_id, free_op_id) lifetimes
+static MemoryIndex memory_index;
 
 // reuse memory structure for sub-allocation
-static LockableMap<uint64_t, MemoryMap> sub_memory_snapshot;
+static MemoryIndex sub_memory_index;
 
 // Init analysis instance
-// TODO(Keren): Separate address and full analysis modes
 static Map<redshow_analysis_type_t, std::shared_ptr<Analysis>> analysis_enabled;
+// Subscribers of analysis_enabled to each event
+static AnalysisDispatch analysis_dispatch;
 
 static Map<redshow_analysis_type_t, std::string> output_dir;
 
+// Parsed instruction files are not cached if empty
+static std::string instruction_cache_dir;
+
+// Speculative parses of cubins registered by redshow_cubin_cache_register
+static CubinPrefetcher cubin_prefetcher;
+
+// Cubins used by this run are written back to it at flush if not empty
+static std::string cubin_prefetch_hint_file;
+
+// Workers of redshow_analyze_async, started on the first asynchronous analysis
+static WorkerPool analysis_pool;
+
+static uint32_t async_num_workers = ASYNC_NUM_WORKERS;
+static uint64_t async_queue_bytes = ASYNC_QUEUE_BYTES;
+
+// Records every state-changing API call when enabled
+static TraceWriter capture_writer;
+
+static redshow_tool_dtoh_func tool_dtoh_func = NULL;
+
 static redshow_log_data_callback_func log_data_callback = NULL;
 
 static redshow_record_data_callback_func record_data_callback = NULL;
@@ -84,6 +119,11 @@ static int decimal_degree_f64 = VALID_DOUBLE_DIGITS;
 
 static redshow_data_type_t default_data_type = REDSHOW_DATA_UNKNOWN;
 
+static bool record_dedup_enabled = false;
+
+// Time every access callback, otherwise they are only counted
+static bool access_timing_enabled = false;
+
 static void torch_memory_callback(torch_monitor_callback_site_t callback_site,
                             torch_monitor_callback_data_t* callback_data) {
     if (callback_site == TORCH_MONITOR_CALLBACK_ENTER) {
@@ -117,10 +157,41 @@ static void torch_memory_callback(torch_monitor_callback_site_t callback_site,
     }
 }
 
+// Looks up cubins whose instruction files have the same content
+static bool find_shared_cubin(const std::string &key, SymbolVector &symbols,
+                              std::shared_ptr<const InstructionGraph> &inst_graph,
+                              std::shared_ptr<const AccessKindTable> &access_kinds) {
+  bool found = false;
+
+  shared_cubin_map.lock();
+  auto iter = shared_cubin_map.find(key);
+  if (iter != shared_cubin_map.end()) {
+    inst_graph = iter->second.inst_graph.lock();
+    access_kinds = iter->second.access_kinds.lock();
+    if (inst_graph.get() != NULL && access_kinds.get() != NULL) {
+      symbols = iter->second.symbols;
+      found = true;
+    } else {
+      // All the cubins using it are unregistered
+      shared_cubin_map.erase(iter);
+    }
+  }
+  shared_cubin_map.unlock();
+
+  return found;
+}
+
 static redshow_result_t analyze_cubin(const char *path, SymbolVector &symbols,
-                                      InstructionGraph &inst_graph) {
+                                      std::shared_ptr<const InstructionGraph> &inst_graph,
+                                      std::shared_ptr<const AccessKindTable> &access_kinds) {
+  StatsTimer timer(STATS_CUBIN);
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
+  auto parsed_inst_graph = std::make_shared<InstructionGraph>();
+  auto parsed_access_kinds = std::make_shared<AccessKindTable>();
+  bool shared = false;
+
   std::string cubin_path = std::string(path);
   auto iter = cubin_path.rfind("/");
   if (iter == std::string::npos) {
@@ -139,150 +210,487 @@ static redshow_result_t analyze_cubin(const char *path, SymbolVector &symbols,
     if (f.good() == false) {
       result = REDSHOW_ERROR_NO_SUCH_FILE;
     } else {
-      // instructions are analyzed before hpcrun
-      if (InstructionParser::parse(inst_path, symbols, inst_graph)) {
-        result = REDSHOW_SUCCESS;
+      // Same content, e.g., a module loaded on every device, and same symbol table size
+      std::string content_key = InstructionCache::key(inst_path);
+      std::string shared_key;
+      if (!content_key.empty()) {
+        shared_key = content_key + "-" + std::to_string(symbols.size());
+      }
+      if (!shared_key.empty() &&
+          find_shared_cubin(shared_key, symbols, inst_graph, access_kinds)) {
+        Stats::add(STATS_INSTRUCTION_SHARED, 1);
+        shared = true;
       } else {
-        result = REDSHOW_ERROR_FAILED_ANALYZE_CUBIN;
+        std::string cache_key;
+        if (!instruction_cache_dir.empty()) {
+          cache_key = content_key;
+        }
+
+        SymbolVector init_symbols;
+        if (!cache_key.empty()) {
+          init_symbols = symbols;
+        }
+
+        // Trace analysis only needs the access kinds, the instruction graph is not loaded
+        if (!cache_key.empty() && InstructionCache::load(instruction_cache_dir, cache_key, symbols,
+                                                         *parsed_access_kinds)) {
+          Stats::add(STATS_INSTRUCTION_CACHE_HITS, 1);
+          result = REDSHOW_SUCCESS;
+        } else {
+          if (!cache_key.empty()) {
+            // Discard a partially loaded entry
+            Stats::add(STATS_INSTRUCTION_CACHE_MISSES, 1);
+            symbols = init_symbols;
+          }
+
+          // instructions are analyzed before hpcrun
+          if (InstructionParser::parse(inst_path, symbols, *parsed_inst_graph)) {
+            // Symbols still hold cubin offsets only
+            parsed_access_kinds->build(*parsed_inst_graph, symbols);
+            if (!cache_key.empty()) {
+              InstructionCache::store(instruction_cache_dir, cache_key, symbols, *parsed_inst_graph,
+                                      *parsed_access_kinds);
+            }
+            result = REDSHOW_SUCCESS;
+          } else {
+            result = REDSHOW_ERROR_FAILED_ANALYZE_CUBIN;
+          }
+        }
+
+        if (result == REDSHOW_SUCCESS && !shared_key.empty()) {
+          shared_cubin_map.lock();
+          auto &shared_cubin = shared_cubin_map[shared_key];
+          shared_cubin.symbols = symbols;
+          shared_cubin.inst_graph = parsed_inst_graph;
+          shared_cubin.access_kinds = parsed_access_kinds;
+          shared_cubin_map.unlock();
+        }
       }
     }
   }
 
+  if (!shared) {
+    // Empty if the instruction file is missing
+    inst_graph = std::move(parsed_inst_graph);
+    access_kinds = std::move(parsed_access_kinds);
+  }
+
   return result;
 }
 
-static redshow_result_t trace_analyze_address_patch(int32_t kernel_id, u64 host_op_id, MemoryMap *memory_map,
-                                                    gpu_patch_buffer_t *trace_data) {
+static void cubin_parse(const std::string &path, CubinParse &parse) {
+  parse.result = analyze_cubin(path.c_str(), parse.symbols, parse.inst_graph, parse.access_kinds);
+}
+
+// Only the final insertion holds the cubin_map writer lock
+static redshow_result_t cubin_insert(uint32_t cubin_id, uint32_t mod_id, uint32_t nsymbols,
+                                     const uint64_t *symbol_pcs, const char *path,
+                                     CubinParse &parse) {
+  redshow_result_t result = parse.result;
+
+  if (result == REDSHOW_SUCCESS || result == REDSHOW_ERROR_NO_SUCH_FILE) {
+    // Other modules of the cubin share the parse
+    SymbolVector symbols = parse.symbols;
+
+    // We must have found an instruction file, no matter nvdisasm failed or not
+    // Assign symbol pc
+    for (uint32_t i = 0; i < nsymbols; ++i) {
+      symbols[i].pc = symbol_pcs[i];
+    }
+
+    // Sort symbols by pc
+    std::sort(symbols.begin(), symbols.end());
+
+    cubin_map.update([&](CubinMap::Version &cubins) {
+      std::shared_ptr<Cubin> cubin;
+      if (!cubins.has(cubin_id)) {
+        cubin = std::make_shared<Cubin>();
+        cubin->cubin_id = cubin_id;
+        cubin->path = path;
+        cubin->inst_graph = parse.inst_graph;
+        cubin->access_kinds = parse.access_kinds;
+        result = REDSHOW_SUCCESS;
+      } else if (!cubins.at(cubin_id)->symbols.has(mod_id)) {
+        // Readers of the old version still see the cubin without mod_id
+        cubin = std::make_shared<Cubin>(*cubins.at(cubin_id));
+        result = REDSHOW_SUCCESS;
+      } else {
+        result = REDSHOW_ERROR_DUPLICATE_ENTRY;
+      }
+      if (result != REDSHOW_ERROR_DUPLICATE_ENTRY) {
+        cubin->symbols[mod_id] = symbols;
+        function_index.insert(cubin_id, mod_id, symbols, cubin->access_kinds);
+        cubins[cubin_id] = cubin;
+      }
+      return result != REDSHOW_ERROR_DUPLICATE_ENTRY;
+    });
+  }
+
+  return result;
+}
+
+static redshow_result_t cubin_register(uint32_t cubin_id, uint32_t mod_id, uint32_t nsymbols,
+                                       const uint64_t *symbol_pcs, const char *path) {
+  CubinParse parse(nsymbols);
+  cubin_parse(path, parse);
+
+  return cubin_insert(cubin_id, mod_id, nsymbols, symbol_pcs, path, parse);
+}
+
+// Active lanes of an address record merged into contiguous [start, end) spans
+struct LaneSpans {
+  // Sorting scattered lanes costs more than the lookups it saves
+  static const u32 MAX_SORTED_SPANS = 8;
+
+  struct Span {
+    u64 start;
+    u64 end;
+    // Mask of the lanes in the span
+    u32 lanes;
+
+    bool operator<(const Span &other) const { return this->start < other.start; }
+  };
+
+  Span spans[GPU_PATCH_WARP_SIZE];
+  u32 num_spans;
+
+  void coalesce(const gpu_patch_record_address_t *record) {
+    num_spans = 0;
+    bool sorted = true;
+    for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+      if ((record->active & (0x1u << j)) == 0) {
+        continue;
+      }
+
+      auto start = record->address[j];
+      auto end = start + record->size;
+      if (num_spans != 0) {
+        auto &span = spans[num_spans - 1];
+        if (start <= span.end && end >= span.start) {
+          // Overlaps or is adjacent to the previous lane's span
+          span.start = MIN2(span.start, start);
+          span.end = MAX2(span.end, end);
+          span.lanes |= (0x1u << j);
+          continue;
+        }
+        sorted &= start > span.start;
+      }
+      spans[num_spans++] = Span{start, end, 0x1u << j};
+    }
+
+    if (sorted || num_spans > MAX_SORTED_SPANS) {
+      return;
+    }
+
+    std::sort(spans, spans + num_spans);
+    u32 last = 0;
+    for (u32 s = 1; s < num_spans; ++s) {
+      if (spans[s].start <= spans[last].end) {
+        spans[last].end = MAX2(spans[last].end, spans[s].end);
+        spans[last].lanes |= spans[s].lanes;
+      } else {
+        spans[++last] = spans[s];
+      }
+    }
+    num_spans = last + 1;
+  }
+};
+
+static redshow_result_t trace_analyze_address_patch(int32_t kernel_id, u64 host_op_id,
+                                                    const MemoryIndex *memory_index,
+                                                    gpu_patch_buffer_t *trace_data,
+                                                    AccessRanges *access_ranges) {
   redshow_result_t result = REDSHOW_SUCCESS;
 
   size_t size = trace_data->head_index;
   gpu_patch_record_address_t *records =
       reinterpret_cast<gpu_patch_record_address_t *>(trace_data->records);
 
-  // Dummy entries
-  AccessKind access_kind;
-  ThreadId thread_id{0, 0};
+  // Dummy entries, address-only records carry neither thread ids nor values
+  WarpAccess warp_access;
+  warp_access.num_units = 1;
+
+  auto &subscribers = analysis_dispatch.accesses[GPU_PATCH_TYPE_ADDRESS_PATCH];
+
+  MemoryTLB memory_tlb(memory_index, host_op_id);
+  LaneSpans lane_spans;
 
   for (size_t i = 0; i < size; ++i) {
     // Iterate over each record
     gpu_patch_record_address_t *record = records + i;
 
-    for (size_t j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
-      if ((record->active & (0x1u << j)) == 0) {
+    warp_access.flags = static_cast<GPUPatchFlags>(record->flags);
+    warp_access.active = 0;
+    // only for memory profile heatmap storage compression
+    warp_access.access_kind.unit_size = record->size;
+
+    lane_spans.coalesce(record);
+
+    memory_index->lock_shared();
+    for (u32 s = 0; s < lane_spans.num_spans; ++s) {
+      auto &span = lane_spans.spans[s];
+
+      // One lookup for the span if it is within a single memory object
+      auto *memory = memory_tlb.find(span.start);
+      if (memory != NULL && span.end <= memory->memory_range.end) {
+        // Lanes are only needed by analyses that receive warp accesses
+        if (!subscribers.empty()) {
+          for (auto lanes = span.lanes; lanes != 0; lanes &= lanes - 1) {
+            auto j = __builtin_ctz(lanes);
+            warp_access.memories[j] =
+                MemoryView(memory->op_id, memory->ctx_id, record->address[j], record->size);
+          }
+          warp_access.active |= span.lanes;
+        }
+
+        if (access_ranges != NULL) {
+          access_ranges->add(MemoryView(memory->op_id, memory->ctx_id, span.start,
+                                        span.end - span.start),
+                             span.start, span.end, warp_access.flags);
+        }
         continue;
       }
 
-      // <start, end>
-      MemoryRange memory_range(record->address[j], record->address[j] + record->size);
-
-      auto iter = memory_map->prev(memory_range);
-      uint64_t memory_op_id = 0;
-      int32_t memory_id = 0;
-      uint64_t memory_size = 0;
-      uint64_t memory_addr = 0;
-      if (iter != memory_map->end()) {
-        if (record->address[j] >= iter->second->memory_range.start &&
-            record->address[j] + record->size <= iter->second->memory_range.end) {
-          memory_op_id = iter->second->op_id;
-          memory_id = iter->second->ctx_id;
-          memory_size = record->size;
-          memory_addr = memory_range.start;
-        } else {
+      // Otherwise look up each lane of the span
+      for (auto lanes = span.lanes; lanes != 0; lanes &= lanes - 1) {
+        auto j = __builtin_ctz(lanes);
+        auto *memory = memory_tlb.find(record->address[j]);
+        if (memory == NULL) {
+          // Unknown memory object
+          Stats::add(STATS_UNKNOWN_MEMORY_ACCESSES, 1);
+          continue;
+        }
+
+        if (record->address[j] + record->size > memory->memory_range.end) {
           // TODO(Keren): Investigate what are the causes
           // Prevent out of bound memory accesses
+          Stats::add(STATS_OUT_OF_BOUNDS_ACCESSES, 1);
           continue;
         }
-      }
 
-      if (memory_op_id == 0) {
-        // Unknown memory object
-        continue;
+        warp_access.active |= (0x1u << j);
+        warp_access.memories[j] =
+            MemoryView(memory->op_id, memory->ctx_id, record->address[j], record->size);
+
+        if (access_ranges != NULL) {
+          access_ranges->add(warp_access.memories[j], record->address[j],
+                             record->address[j] + record->size, warp_access.flags);
+        }
       }
+    }
+    memory_index->unlock_shared();
 
-      // only for memory profile heatmap storage compression
-      access_kind.unit_size = record->size;
+    if (warp_access.active == 0 || subscribers.empty()) {
+      continue;
+    }
 
-      Memory memory = Memory(memory_op_id, memory_id, memory_addr, memory_size);
-      // XXX(Keren): Need to separate address analysis with value analysis
-      for (auto aiter : analysis_enabled) {
-        aiter.second->unit_access(kernel_id, host_op_id, thread_id, access_kind, memory, 0, 0, 0, 0,
-                                  static_cast<GPUPatchFlags>(record->flags));
-      }
+    for (auto &subscriber : subscribers) {
+      StatsCountTimer timer(stats_analysis(subscriber.type, STATS_PHASE_ACCESS),
+                            access_timing_enabled);
+      subscriber.analysis->warp_access(kernel_id, host_op_id, warp_access);
     }
   }
   return result;
 }
 
-static redshow_result_t trace_analyze_address_analysis(int32_t kernel_id, u64 host_op_id, MemoryMap *memory_map,
-                                                       gpu_patch_buffer_t *trace_data) {
+static redshow_result_t trace_analyze_address_analysis(int32_t kernel_id, u64 host_op_id,
+                                                       const MemoryIndex *memory_index,
+                                                       gpu_patch_buffer_t *trace_data,
+                                                       AccessRanges *access_ranges) {
   redshow_result_t result = REDSHOW_SUCCESS;
 
   size_t size = trace_data->head_index;
   gpu_patch_analysis_address_t *records =
       reinterpret_cast<gpu_patch_analysis_address_t *>(trace_data->records);
+  auto flags = static_cast<GPUPatchFlags>(trace_data->flags);
 
   // Dummy entries
   AccessKind access_kind;
   ThreadId thread_id{0, 0};
 
-  for (size_t i = 0; i < size; ++i) {
-    // Iterate over each record
-    gpu_patch_analysis_address_t *record = records + i;
-
-    // <start, end>
-    MemoryRange memory_range(record->start, record->end);
-    uint64_t addr_start = record->start;
-    uint64_t addr_end = addr_start;
-
-    // Separate memories from a continous address region
-    while (addr_end < memory_range.end) {
-      MemoryRange cur_memory_range(addr_start, addr_start);
-      auto iter = memory_map->prev(cur_memory_range);
-
-      uint64_t memory_op_id = 0;
-      int32_t memory_id = 0;
-      uint64_t memory_size = 0;
-      uint64_t memory_addr = 0;
-      if (iter != memory_map->end()) {
-        if (iter->first.start <= addr_start && iter->first.end > addr_start) {
-          addr_end = MIN2(memory_range.end, iter->first.end);
-          memory_op_id = iter->second->op_id;
-          memory_id = iter->second->ctx_id;
-          memory_size = addr_end - addr_start;
-          memory_addr = addr_start;
-          addr_start = iter->first.end;
-        } else {
-          // TODO(Keren): Investigate what are the causes
-          // Prevent out of bound memory accesses
+  // [start, end) is within memory_object
+  auto analyze_range = [&](const Memory *memory_object, u64 start, u64 end) {
+    MemoryView memory(memory_object->op_id, memory_object->ctx_id, start, end - start);
+    if (access_ranges != NULL) {
+      access_ranges->add(memory, start, end, flags);
+    }
+    for (auto &subscriber : analysis_dispatch.accesses[GPU_PATCH_TYPE_ADDRESS_ANALYSIS]) {
+      StatsCountTimer timer(stats_analysis(subscriber.type, STATS_PHASE_ACCESS),
+                            access_timing_enabled);
+      subscriber.analysis->unit_access(kernel_id, host_op_id, thread_id, access_kind, memory, 0,
+                                       0, 0, 0, flags);
+    }
+  };
+
+  memory_index->lock_shared();
+  auto num_objects = memory_index->visit_size(host_op_id);
+  memory_index->unlock_shared();
+
+  if (size < num_objects) {
+    // Fewer ranges than objects, look up each range
+    MemoryTLB memory_tlb(memory_index, host_op_id);
+
+    for (size_t i = 0; i < size; ++i) {
+      // Iterate over each record
+      gpu_patch_analysis_address_t *record = records + i;
+
+      // Separate memories from a continous address region
+      memory_index->lock_shared();
+      uint64_t addr_start = record->start;
+      while (addr_start < record->end) {
+        auto *memory_object = memory_tlb.find(addr_start);
+        if (memory_object == NULL) {
+          // Unknown memory object
+          Stats::add(STATS_UNKNOWN_MEMORY_ACCESSES, 1);
           break;
         }
+
+        uint64_t addr_end = MIN2(record->end, memory_object->memory_range.end);
+        analyze_range(memory_object, addr_start, addr_end);
+        addr_start = addr_end;
+      }
+      memory_index->unlock_shared();
+    }
+  } else {
+    // Merge join ranges sorted by start with objects sorted by address
+    memory_index->lock_shared();
+    Vector<const Memory *> memory_objects;
+    memory_objects.reserve(num_objects);
+    memory_index->visit(host_op_id,
+                        [&](const Memory &memory) { memory_objects.push_back(&memory); });
+
+    Vector<MemoryRange> memory_ranges;
+    memory_ranges.reserve(size);
+    bool sorted = true;
+    for (size_t i = 0; i < size; ++i) {
+      if (i != 0 && records[i].start < records[i - 1].start) {
+        sorted = false;
       }
+      memory_ranges.emplace_back(records[i].start, records[i].end);
+    }
+    // Ranges are mostly merged in address order on the GPU
+    if (!sorted) {
+      std::sort(memory_ranges.begin(), memory_ranges.end());
+    }
 
-      if (memory_op_id == 0) {
-        // Unknown memory object
-        break;
+    size_t first = 0;
+    for (auto &memory_range : memory_ranges) {
+      // The first object that ends after the range starts
+      while (first < memory_objects.size() &&
+             memory_objects[first]->memory_range.end <= memory_range.start) {
+        ++first;
       }
 
-      Memory memory = Memory(memory_op_id, memory_id, memory_addr, memory_size);
-      // XXX(Keren): Need to separate address analysis with value analysis
-      for (auto aiter : analysis_enabled) {
-        aiter.second->unit_access(kernel_id, host_op_id, thread_id, access_kind, memory, 0, 0, 0, 0,
-                                  static_cast<GPUPatchFlags>(trace_data->flags));
+      // Separate memories from a continous address region
+      uint64_t addr_start = memory_range.start;
+      for (size_t k = first; addr_start < memory_range.end; ++k) {
+        if (k == memory_objects.size() ||
+            memory_objects[k]->memory_range.start > addr_start) {
+          // Unknown memory object
+          Stats::add(STATS_UNKNOWN_MEMORY_ACCESSES, 1);
+          break;
+        }
+
+        uint64_t addr_end = MIN2(memory_range.end, memory_objects[k]->memory_range.end);
+        analyze_range(memory_objects[k], addr_start, addr_end);
+        addr_start = addr_end;
       }
     }
+    memory_index->unlock_shared();
   }
 
   return result;
 }
 
-static redshow_result_t trace_analyze_default(int32_t kernel_id, u64 host_op_id, InstructionGraph *inst_graph,
-                                              SymbolVector *symbols, MemoryMap *memory_map,
-                                              gpu_patch_buffer_t *trace_data) {
+// Slots of the last records of <pc, flat_block_id, flat_thread_id> keys, colliding keys only
+// miss repeats
+const u32 RECORD_DEDUP_BITS = 10;
+
+static bool record_equal(const gpu_patch_record_t *r1, const gpu_patch_record_t *r2) {
+  if (r1->pc != r2->pc || r1->flat_block_id != r2->flat_block_id ||
+      r1->flat_thread_id != r2->flat_thread_id || r1->active != r2->active ||
+      r1->flags != r2->flags || r1->size != r2->size) {
+    return false;
+  }
+
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((r1->active & (0x1u << j)) == 0) {
+      continue;
+    }
+    if (r1->address[j] != r2->address[j] ||
+        memcmp(r1->value[j], r2->value[j], GPU_PATCH_MAX_ACCESS_SIZE) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Fold every access record identical to the previous record of its pc and thread into
+ * the first record of the run.
+ *
+ * @param repeats set to the number of records analyzed as each record, 0 if folded
+ * @return number of folded records
+ */
+static u64 record_dedup(const gpu_patch_record_t *records, size_t size, Vector<u32> &repeats) {
+  u64 folded = 0;
+  u32 last[1u << RECORD_DEDUP_BITS];
+  std::fill(last, last + (1u << RECORD_DEDUP_BITS), std::numeric_limits<u32>::max());
+
+  repeats.assign(size, 1);
+  for (size_t i = 0; i < size; ++i) {
+    auto *record = records + i;
+    if (record->size == 0 ||
+        (record->flags & (GPU_PATCH_BLOCK_ENTER_FLAG | GPU_PATCH_BLOCK_EXIT_FLAG))) {
+      continue;
+    }
+
+    u64 key = (static_cast<u64>(record->flat_block_id) << 32 | record->flat_thread_id) ^
+              (record->pc * 0x9E3779B97F4A7C15ul);
+    auto &slot = last[(key * 0x9E3779B97F4A7C15ul) >> (64 - RECORD_DEDUP_BITS)];
+    if (slot != std::numeric_limits<u32>::max() && record_equal(records + slot, record)) {
+      repeats[slot] += 1;
+      repeats[i] = 0;
+      folded += 1;
+    } else {
+      slot = i;
+    }
+  }
+
+  return folded;
+}
+
+static redshow_result_t trace_analyze_default(uint32_t cubin_id, uint32_t mod_id,
+                                              int32_t kernel_id, u64 host_op_id,
+                                              const FunctionSnapshot *functions,
+                                              const MemoryIndex *memory_index,
+                                              gpu_patch_buffer_t *trace_data,
+                                              AccessRanges *access_ranges) {
   redshow_result_t result = REDSHOW_SUCCESS;
 
   size_t size = trace_data->head_index;
   gpu_patch_record_t *records = reinterpret_cast<gpu_patch_record_t *>(trace_data->records);
 
+  // Resolved lanes of the current record, reused across records
+  WarpAccess warp_access;
+
+  auto &subscribers = analysis_dispatch.accesses[GPU_PATCH_TYPE_DEFAULT];
+  // Decode only what subscribers use
+  bool decode_values = analysis_dispatch.values[GPU_PATCH_TYPE_DEFAULT];
+  bool decode_thread_ids = analysis_dispatch.thread_ids[GPU_PATCH_TYPE_DEFAULT];
+
+  // Identical records are analyzed once if all subscribers only count accesses
+  Vector<u32> repeats;
+  if (record_dedup_enabled && analysis_dispatch.weighted[GPU_PATCH_TYPE_DEFAULT]) {
+    Stats::add(STATS_DEDUPLICATED_RECORDS, record_dedup(records, size, repeats));
+  }
+
+  MemoryTLB memory_tlb(memory_index, host_op_id);
+
+  // Function of the last record, consecutive records often come from the same function
+  const FunctionInterval *function = NULL;
+  uint64_t function_end = 0;
+
   for (size_t i = 0; i < size; ++i) {
     // Iterate over each record
     gpu_patch_record_t *record = records + i;
@@ -292,42 +700,49 @@ static redshow_result_t trace_analyze_default(int32_t kernel_id, u64 host_op_id,
       continue;
     }
 
+    // Number of identical records analyzed as this one
+    u32 count = repeats.empty() ? 1 : repeats[i];
+    if (count == 0) {
+      // Folded into an earlier record
+      continue;
+    }
+
     if (record->flags & GPU_PATCH_BLOCK_ENTER_FLAG) {
       // Skip analysis
     } else if (record->flags & GPU_PATCH_BLOCK_EXIT_FLAG) {
+      if (analysis_dispatch.block_exits.empty()) {
+        continue;
+      }
       // Remove temporal records
       for (size_t j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
         if (record->active & (0x1u << j)) {
           uint32_t flat_thread_id =
               record->flat_thread_id / GPU_PATCH_WARP_SIZE * GPU_PATCH_WARP_SIZE + j;
           ThreadId thread_id{record->flat_block_id, flat_thread_id};
-          for (auto aiter : analysis_enabled) {
-            aiter.second->block_exit(thread_id);
+          for (auto &subscriber : analysis_dispatch.block_exits) {
+            subscriber.analysis->block_exit(thread_id);
           }
         }
       }
-    } else {
-      RealPC real_pc;
-
-      auto ret = symbols->transform_pc(record->pc);
-      if (ret.has_value()) {
-        real_pc = ret.value();
-      } else {
-        result = REDSHOW_ERROR_FAILED_ANALYZE_CUBIN;
-        return result;
+    } else if (!subscribers.empty() || access_ranges != NULL) {
+      if (function == NULL || record->pc < function->pc || record->pc >= function_end) {
+        function = functions->lookup(cubin_id, mod_id, record->pc, function_end);
+        if (function == NULL) {
+          result = REDSHOW_ERROR_FAILED_ANALYZE_CUBIN;
+          return result;
+        }
       }
+      uint64_t cubin_offset = record->pc - function->pc + function->offset;
 
       // record->size * 8, byte to bits
       AccessKind access_kind;
 
-      if (inst_graph->size() != 0) {
-        // Accurate mode, when we have instruction information
-        auto &inst = inst_graph->node(real_pc.cubin_offset);
-        if (inst.access_kind.get() != NULL) {
-          access_kind = *inst.access_kind;
-        }
-        // Fall back to default mode if failed
+      // Accurate mode, when we have instruction information
+      auto *slot = function->access_kinds->lookup(cubin_offset);
+      if (slot != NULL) {
+        access_kind = slot->access_kind.unpack();
       }
+      // Fall back to default mode if failed
 
       if (access_kind.data_type == REDSHOW_DATA_UNKNOWN) {
         // Default mode, we identify every data as 64 bits unit size, 64 bits vec size, float type
@@ -339,34 +754,37 @@ static redshow_result_t trace_analyze_default(int32_t kernel_id, u64 host_op_id,
       }
 
       // Reserved for debugging
-      // std::cout << "function_index: " << real_pc.function_index << ", pc_offset: " <<
-      //  real_pc.pc_offset << ", " << access_kind.to_string() << std::endl;
-      // TODO: accelerate by handling all threads in a warp together
+      // std::cout << "function_index: " << function->function_index << ", pc_offset: " <<
+      //  record->pc - function->pc << ", " << access_kind.to_string() << std::endl;
+      warp_access.pc = record->pc;
+      warp_access.flags = static_cast<GPUPatchFlags>(record->flags);
+      warp_access.active = 0;
+      warp_access.num_units = access_kind.vec_size / access_kind.unit_size;
+      warp_access.access_kind = access_kind;
+      // We iterate through all the units such that every unit's vec_size = unit_size
+      warp_access.access_kind.vec_size = warp_access.access_kind.unit_size;
+
+      memory_index->lock_shared();
       for (size_t j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
         if ((record->active & (0x1u << j)) == 0) {
           continue;
         }
 
-        uint32_t flat_thread_id =
-            record->flat_thread_id / GPU_PATCH_WARP_SIZE * GPU_PATCH_WARP_SIZE + j;
-        ThreadId thread_id{record->flat_block_id, flat_thread_id};
-
-        MemoryRange memory_range(record->address[j], record->address[j]);
-        auto iter = memory_map->prev(memory_range);
+        auto *memory = memory_tlb.find(record->address[j]);
         uint64_t memory_op_id = 0;
         int32_t memory_id = 0;
         uint64_t memory_size = 0;
         uint64_t memory_addr = 0;
-        if (iter != memory_map->end()) {
-          if (record->address[j] >= iter->second->memory_range.start &&
-              record->address[j] + record->size <= iter->second->memory_range.end) {
-            memory_op_id = iter->second->op_id;
-            memory_id = iter->second->ctx_id;
-            memory_size = iter->second->len;
-            memory_addr = iter->second->memory_range.start;
+        if (memory != NULL) {
+          if (record->address[j] + record->size <= memory->memory_range.end) {
+            memory_op_id = memory->op_id;
+            memory_id = memory->ctx_id;
+            memory_size = memory->len;
+            memory_addr = memory->memory_range.start;
           } else {
             // TODO(Keren): Investigate what are the causes
             // Prevent out of bound memory accesses
+            Stats::add(STATS_OUT_OF_BOUNDS_ACCESSES, count);
             continue;
           }
         }
@@ -391,32 +809,43 @@ static redshow_result_t trace_analyze_default(int32_t kernel_id, u64 host_op_id,
 
         if (memory_op_id == 0) {
           // Unknown memory object
+          Stats::add(STATS_UNKNOWN_MEMORY_ACCESSES, count);
           continue;
         }
 
-        Memory memory = Memory(memory_op_id, memory_id, memory_addr, memory_size);
-        auto num_units = access_kind.vec_size / access_kind.unit_size;
-        AccessKind unit_access_kind = access_kind;
-        // We iterate through all the units such that every unit's vec_size = unit_size
-        unit_access_kind.vec_size = unit_access_kind.unit_size;
-
-        for (size_t m = 0; m < num_units; m++) {
-          uint64_t value = 0;
-          uint32_t byte_size = unit_access_kind.unit_size >> 3u;
-          memcpy(&value, &record->value[j][m * byte_size], byte_size);
-          // The 7th digit in float number's decimal part is partial valid, so we set the deault
-          // approx level to REDSHOW_APPROX_MIN.
-          value =
-              unit_access_kind.value_to_basic_type(value, decimal_degree_f32, decimal_degree_f64);
-
-          // Reserved for debug
-          // std::cout << "thread: " << j << ", value: " << value << std::endl;
-
-          for (auto aiter : analysis_enabled) {
-            aiter.second->unit_access(kernel_id, host_op_id, thread_id, unit_access_kind, memory, record->pc,
-                                      value, record->address[j], m,
-                                      static_cast<GPUPatchFlags>(record->flags));
-          }
+        warp_access.active |= (0x1u << j);
+        warp_access.addresses[j] = record->address[j];
+        warp_access.memories[j] = MemoryView(memory_op_id, memory_id, memory_addr, memory_size);
+
+        if (access_ranges != NULL) {
+          access_ranges->add(warp_access.memories[j], record->address[j],
+                             record->address[j] + record->size, warp_access.flags);
+        }
+
+        if (decode_thread_ids) {
+          uint32_t flat_thread_id =
+              record->flat_thread_id / GPU_PATCH_WARP_SIZE * GPU_PATCH_WARP_SIZE + j;
+          warp_access.thread_ids[j] = ThreadId{record->flat_block_id, flat_thread_id};
+        }
+      }
+      memory_index->unlock_shared();
+
+      if (warp_access.active == 0) {
+        continue;
+      }
+
+      if (decode_values) {
+        ValueDecoder value_decoder(access_kind, decimal_degree_f32, decimal_degree_f64);
+        value_decoder.decode(record, warp_access);
+      }
+
+      for (auto &subscriber : subscribers) {
+        StatsCountTimer timer(stats_analysis(subscriber.type, STATS_PHASE_ACCESS),
+                              access_timing_enabled);
+        if (count == 1) {
+          subscriber.analysis->warp_access(kernel_id, host_op_id, warp_access);
+        } else {
+          subscriber.analysis->weighted_warp_access(kernel_id, host_op_id, warp_access, count);
         }
       }
     }
@@ -430,64 +859,47 @@ static redshow_result_t trace_analyze(uint32_t cpu_thread, uint32_t cubin_id, ui
                                       gpu_patch_buffer_t *trace_data) {
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  SymbolVector *symbols = NULL;
-  InstructionGraph *inst_graph = NULL;
-  // Cubin path is added just for debugging purpose
-  std::string cubin_path;
-
-  cubin_map.lock();
-  if (!cubin_map.has(cubin_id) || !cubin_map.at(cubin_id).symbols.has(mod_id)) {
+  // Kept alive until the trace is analyzed, even if the cubin is unregistered meanwhile
+  auto functions = function_index.snapshot();
+  if (!functions->has(cubin_id, mod_id)) {
     result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-  } else {
-    symbols = &(cubin_map.at(cubin_id).symbols.at(mod_id));
-    inst_graph = &(cubin_map.at(cubin_id).inst_graph);
-    cubin_path = cubin_map.at(cubin_id).path;
   }
-  cubin_map.unlock();
 
   // Cubin not found, maybe in the cache map
   if (result == REDSHOW_ERROR_NOT_EXIST_ENTRY) {
     uint32_t nsymbols;
-    uint64_t *symbol_pcs;
-    const char *path;
+    // Copied out of the read section, parsing may take long
+    std::shared_ptr<uint64_t[]> symbol_pcs;
+    std::string path;
 
-    cubin_cache_map.lock();
-    if (!cubin_cache_map.has(cubin_id)) {
+    Rcu::read_lock();
+    auto *cubin_cache = cubin_cache_map.find(cubin_id);
+    if (cubin_cache == NULL || !cubin_cache->symbol_pcs.has(mod_id)) {
       result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
     } else {
-      auto &cubin_cache = cubin_cache_map.at(cubin_id);
-      if (!cubin_cache.symbol_pcs.has(mod_id)) {
-        result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-      } else {
-        result = REDSHOW_SUCCESS;
-        nsymbols = cubin_cache.nsymbols;
-        symbol_pcs = cubin_cache.symbol_pcs.at(mod_id).get();
-        path = cubin_cache.path.c_str();
-      }
+      result = REDSHOW_SUCCESS;
+      nsymbols = cubin_cache->nsymbols;
+      symbol_pcs = cubin_cache->symbol_pcs.at(mod_id);
+      path = cubin_cache->path;
     }
-    cubin_cache_map.unlock();
+    Rcu::read_unlock();
 
     if (result == REDSHOW_SUCCESS) {
-      result = redshow_cubin_register(cubin_id, mod_id, nsymbols, symbol_pcs, path);
+      // Waits only if a prefetch worker is still parsing the cubin
+      auto parse = cubin_prefetcher.take(cubin_id);
+      if (parse.get() != NULL) {
+        result = cubin_insert(cubin_id, mod_id, nsymbols, symbol_pcs.get(), path.c_str(), *parse);
+      } else {
+        result = cubin_register(cubin_id, mod_id, nsymbols, symbol_pcs.get(), path.c_str());
+      }
     }
 
     // Try fetch cubin again
     if (result == REDSHOW_SUCCESS) {
-      cubin_map.lock();
-      if (!cubin_map.has(cubin_id)) {
+      functions = function_index.snapshot();
+      if (!functions->has(cubin_id, mod_id)) {
         result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-      } else {
-        auto &cubin = cubin_map.at(cubin_id);
-        if (!cubin.symbols.has(mod_id)) {
-          result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-        } else {
-          result = REDSHOW_SUCCESS;
-          symbols = &(cubin.symbols.at(mod_id));
-          inst_graph = &(cubin.inst_graph);
-          cubin_path = cubin.path;
-        }
       }
-      cubin_map.unlock();
     }
   }
 
@@ -495,42 +907,95 @@ static redshow_result_t trace_analyze(uint32_t cpu_thread, uint32_t cubin_id, ui
     return result;
   }
 
-  MemoryMap *memory_map = NULL;
-
-  memory_snapshot.lock();
-  auto snapshot_iter = memory_snapshot.prev(host_op_id);
-  if (snapshot_iter == memory_snapshot.end()) {
+  memory_index.lock_shared();
+  if (!memory_index.has_snapshot(host_op_id)) {
     result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-  } else {
-    memory_map = &(snapshot_iter->second);
   }
-  memory_snapshot.unlock();
+  memory_index.unlock_shared();
 
   // Memory snapshot not found
   if (result != REDSHOW_SUCCESS) {
     return result;
   }
 
-  for (auto aiter : analysis_enabled) {
-    aiter.second->analysis_begin(cpu_thread, kernel_id, host_op_id, stream_id, cubin_id, mod_id,
-                                 static_cast<GPUPatchType>(trace_data->type), trace_data);
+  StatsTimer timer(stats_trace(trace_data->type));
+  Stats::add(STATS_TRACE_RECORDS + trace_data->type, trace_data->head_index);
+
+  auto &subscribers = analysis_dispatch.traces[trace_data->type];
+  for (auto &subscriber : subscribers) {
+    StatsTimer timer(stats_analysis(subscriber.type, STATS_PHASE_BEGIN));
+    subscriber.analysis->analysis_begin(cpu_thread, kernel_id, host_op_id, stream_id, cubin_id,
+                                        mod_id, static_cast<GPUPatchType>(trace_data->type),
+                                        trace_data);
   }
 
-  if (trace_data->type == GPU_PATCH_TYPE_DEFAULT) {
-    result = trace_analyze_default(kernel_id, host_op_id, inst_graph, symbols, memory_map, trace_data);
+  // Ranges are merged once for all the analyses that only use ranges
+  AccessRanges access_ranges;
+  auto &range_subscribers = analysis_dispatch.ranges[trace_data->type];
+  auto *ranges = range_subscribers.empty() ? NULL : &access_ranges;
+
+  if (analysis_dispatch.accesses[trace_data->type].empty() && ranges == NULL &&
+      (trace_data->type != GPU_PATCH_TYPE_DEFAULT || analysis_dispatch.block_exits.empty())) {
+    // No subscriber reads the records
+  } else if (trace_data->type == GPU_PATCH_TYPE_DEFAULT) {
+    result = trace_analyze_default(cubin_id, mod_id, kernel_id, host_op_id, functions.get(),
+                                   &memory_index, trace_data, ranges);
   } else if (trace_data->type == GPU_PATCH_TYPE_ADDRESS_PATCH) {
-    result = trace_analyze_address_patch(kernel_id, host_op_id, memory_map, trace_data);
+    result =
+        trace_analyze_address_patch(kernel_id, host_op_id, &memory_index, trace_data, ranges);
   } else if (trace_data->type == GPU_PATCH_TYPE_ADDRESS_ANALYSIS) {
-    result = trace_analyze_address_analysis(kernel_id, host_op_id, memory_map, trace_data);
+    result =
+        trace_analyze_address_analysis(kernel_id, host_op_id, &memory_index, trace_data, ranges);
   }
 
-  for (auto aiter : analysis_enabled) {
-    aiter.second->analysis_end(cpu_thread, kernel_id);
+  if (ranges != NULL && !access_ranges.empty()) {
+    access_ranges.normalize();
+    for (auto &subscriber : range_subscribers) {
+      StatsCountTimer timer(stats_analysis(subscriber.type, STATS_PHASE_ACCESS),
+                            access_timing_enabled);
+      subscriber.analysis->range_access(kernel_id, host_op_id, access_ranges);
+    }
+  }
+
+  for (auto &subscriber : subscribers) {
+    StatsTimer timer(stats_analysis(subscriber.type, STATS_PHASE_END));
+    subscriber.analysis->analysis_end(cpu_thread, kernel_id);
   }
 
   return result;
 }
 
+static void tool_dtoh(uint64_t host_start, uint64_t device_start, uint64_t len) {
+  StatsTimer timer(STATS_DTOH);
+  Stats::add(STATS_DTOH_BYTES, len);
+
+  if (tool_dtoh_func) {
+    tool_dtoh_func(host_start, device_start, len);
+  }
+
+  if (capture_writer.is_open()) {
+    // Keep device data, so analyses see the same values in replay
+    capture_writer.write(TraceEvent(TRACE_EVENT_DTOH).put<u64>(device_start)
+                             .put_bytes(reinterpret_cast<void *>(host_start), len));
+  }
+}
+
+static void analysis_ordered_barrier(OperationType type) {
+  // Op callbacks consume analyzed traces, wait for the pending ones
+  if (analysis_pool.running() && !analysis_dispatch.op_callbacks[type].empty()) {
+    analysis_pool.drain();
+  }
+}
+
+static void analysis_op_callback(OperationPtr operation, bool is_submemory = false) {
+  analysis_ordered_barrier(operation->type);
+
+  for (auto &subscriber : analysis_dispatch.op_callbacks[operation->type]) {
+    StatsTimer timer(stats_analysis(subscriber.type, STATS_PHASE_OP_CALLBACK));
+    subscriber.analysis->op_callback(operation, is_submemory);
+  }
+}
+
 /*
  * Interface methods
  */
@@ -538,6 +1003,11 @@ static redshow_result_t trace_analyze(uint32_t cpu_thread, uint32_t cubin_id, ui
 redshow_result_t redshow_output_dir_config(redshow_analysis_type_t analysis, const char *dir) {
   PRINT("\nredshow-> Enter redshow_output_dir_config\nanalysis: %u\ndir: %s\n", analysis, dir);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_OUTPUT_DIR_CONFIG).put<u32>(analysis)
+                             .put_string(dir));
+  }
+
   if (dir) {
     output_dir[analysis] = std::string(dir);
   }
@@ -545,9 +1015,56 @@ redshow_result_t redshow_output_dir_config(redshow_analysis_type_t analysis, con
   return REDSHOW_SUCCESS;
 }
 
+redshow_result_t redshow_instruction_cache_config(const char *dir) {
+  PRINT("\nredshow-> Enter redshow_instruction_cache_config\ndir: %s\n", dir);
+
+  instruction_cache_dir = dir == NULL ? "" : std::string(dir);
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_cubin_prefetch_config(uint32_t num_workers, const char *hint_file) {
+  PRINT("\nredshow-> Enter redshow_cubin_prefetch_config\nnum_workers: %u\nhint_file: %s\n",
+        num_workers, hint_file);
+
+  if (cubin_prefetcher.running()) {
+    return REDSHOW_ERROR_DUPLICATE_ENTRY;
+  }
+
+  if (hint_file != NULL && hint_file[0] != '\0') {
+    cubin_prefetch_hint_file = std::string(hint_file);
+    cubin_prefetcher.load_hints(cubin_prefetch_hint_file);
+  }
+  if (num_workers > 0) {
+    cubin_prefetcher.start(num_workers, cubin_parse);
+  }
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_record_dedup_config(bool enable) {
+  PRINT("\nredshow-> Enter redshow_record_dedup_config\nenable: %u\n", enable);
+
+  record_dedup_enabled = enable;
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_access_timing_config(bool enable) {
+  PRINT("\nredshow-> Enter redshow_access_timing_config\nenable: %u\n", enable);
+
+  access_timing_enabled = enable;
+
+  return REDSHOW_SUCCESS;
+}
+
 redshow_result_t redshow_data_type_config(redshow_data_type_t data_type) {
   PRINT("\nredshow-> Enter redshow_data_type_config\ndata_type: %u\n", data_type);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_DATA_TYPE_CONFIG).put<u32>(data_type));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
   switch (data_type) {
@@ -572,6 +1089,10 @@ redshow_result_t redshow_data_type_get(redshow_data_type_t *data_type) {
 }
 
 redshow_result_t redshow_approx_level_config(redshow_approx_level_t level) {
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_APPROX_LEVEL_CONFIG).put<u32>(level));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
   switch (level) {
@@ -658,6 +1179,13 @@ redshow_result_t redshow_get_op_id_register(redshow_get_op_id func) {
 redshow_result_t redshow_analysis_enable(redshow_analysis_type_t analysis_type) {
   PRINT("\nredshow-> Enter redshow_analysis_enable\nanalysis_type: %u\n", analysis_type);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYSIS_ENABLE).put<u32>(analysis_type));
+  }
+
+  // Pending traces are analyzed with the current analyses and dispatch table
+  redshow_analysis_drain();
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
   switch (analysis_type) {
@@ -695,6 +1223,8 @@ redshow_result_t redshow_analysis_enable(redshow_analysis_type_t analysis_type)
       break;
   }
 
+  analysis_dispatch.build(analysis_enabled);
+
   return result;
 }
 
@@ -713,7 +1243,15 @@ redshow_result_t redshow_analysis_enabled(redshow_analysis_type_t analysis_type)
 redshow_result_t redshow_analysis_disable(redshow_analysis_type_t analysis_type) {
   PRINT("\nredshow-> Enter redshow_analysis_disable\nanalysis_type: %u\n", analysis_type);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYSIS_DISABLE).put<u32>(analysis_type));
+  }
+
+  // Workers may still use the analysis and the dispatch table
+  redshow_analysis_drain();
+
   analysis_enabled.erase(analysis_type);
+  analysis_dispatch.build(analysis_enabled);
 
   return REDSHOW_SUCCESS;
 }
@@ -724,7 +1262,13 @@ redshow_result_t redshow_analysis_config(redshow_analysis_type_t analysis_type,
       "\nredshow-> Enter redshow_analysis_config\nanalysis_type: %u, config_type: %u, enable: %u\n",
       analysis_type, config_type, enable);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYSIS_CONFIG).put<u32>(analysis_type)
+                             .put<u32>(config_type).put<u8>(enable));
+  }
+
   if (analysis_enabled.has(analysis_type)) {
+    redshow_analysis_drain();
     analysis_enabled[analysis_type]->config(config_type, enable);
   }
 
@@ -736,42 +1280,14 @@ redshow_result_t redshow_cubin_register(uint32_t cubin_id, uint32_t mod_id, uint
   PRINT("\nredshow-> Enter redshow_cubin_register\ncubin_id: %u\nmode_id: %u\npath: %s\n", cubin_id,
         mod_id, path);
 
-  redshow_result_t result = REDSHOW_SUCCESS;
-
-  InstructionGraph inst_graph;
-  SymbolVector symbols(nsymbols);
-  result = analyze_cubin(path, symbols, inst_graph);
-
-  if (result == REDSHOW_SUCCESS || result == REDSHOW_ERROR_NO_SUCH_FILE) {
-    // We must have found an instruction file, no matter nvdisasm failed or not
-    // Assign symbol pc
-    for (auto i = 0; i < nsymbols; ++i) {
-      symbols[i].pc = symbol_pcs[i];
-    }
-
-    // Sort symbols by pc
-    std::sort(symbols.begin(), symbols.end());
-
-    cubin_map.lock();
-
-    if (!cubin_map.has(cubin_id)) {
-      cubin_map[cubin_id].cubin_id = cubin_id;
-      cubin_map[cubin_id].path = path;
-      cubin_map[cubin_id].inst_graph = inst_graph;
-      result = REDSHOW_SUCCESS;
-    } else if (cubin_map[cubin_id].symbols.find(mod_id) == cubin_map[cubin_id].symbols.end()) {
-      result = REDSHOW_SUCCESS;
-    } else {
-      result = REDSHOW_ERROR_DUPLICATE_ENTRY;
-    }
-    if (result != REDSHOW_ERROR_DUPLICATE_ENTRY) {
-      cubin_map[cubin_id].symbols[mod_id] = symbols;
-    }
-
-    cubin_map.unlock();
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_CUBIN_REGISTER).put<u32>(cubin_id)
+                             .put<u32>(mod_id)
+                             .put_bytes(symbol_pcs, nsymbols * sizeof(uint64_t))
+                             .put_string(path));
   }
 
-  return result;
+  return cubin_register(cubin_id, mod_id, nsymbols, symbol_pcs, path);
 }
 
 redshow_result_t redshow_cubin_cache_register(uint32_t cubin_id, uint32_t mod_id, uint32_t nsymbols,
@@ -779,31 +1295,39 @@ redshow_result_t redshow_cubin_cache_register(uint32_t cubin_id, uint32_t mod_id
   PRINT("\nredshow-> Enter redshow_cubin_cache_register\ncubin_id: %u\nmod_id: %u\npath: %s\n",
         cubin_id, mod_id, path);
 
-  redshow_result_t result = REDSHOW_SUCCESS;
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_CUBIN_CACHE_REGISTER).put<u32>(cubin_id)
+                             .put<u32>(mod_id)
+                             .put_bytes(symbol_pcs, nsymbols * sizeof(uint64_t))
+                             .put_string(path));
+  }
 
-  cubin_cache_map.lock();
-  if (!cubin_cache_map.has(cubin_id)) {
-    auto &cubin_cache = cubin_cache_map[cubin_id];
+  redshow_result_t result = REDSHOW_SUCCESS;
 
-    cubin_cache.cubin_id = cubin_id;
-    cubin_cache.path = std::string(path);
-    cubin_cache.nsymbols = nsymbols;
-    result = REDSHOW_SUCCESS;
-  } else if (cubin_cache_map[cubin_id].symbol_pcs.find(mod_id) ==
-             cubin_cache_map[cubin_id].symbol_pcs.end()) {
-    result = REDSHOW_SUCCESS;
-  } else {
-    result = REDSHOW_ERROR_DUPLICATE_ENTRY;
-  }
+  cubin_cache_map.update([&](CubinCacheMap::Version &cubin_caches) {
+    std::shared_ptr<CubinCache> cubin_cache;
+    if (!cubin_caches.has(cubin_id)) {
+      cubin_cache = std::make_shared<CubinCache>(cubin_id, std::string(path));
+      cubin_cache->nsymbols = nsymbols;
+      cubin_prefetcher.submit(cubin_id, nsymbols, cubin_cache->path);
+      result = REDSHOW_SUCCESS;
+    } else if (!cubin_caches.at(cubin_id)->symbol_pcs.has(mod_id)) {
+      cubin_cache = std::make_shared<CubinCache>(*cubin_caches.at(cubin_id));
+      result = REDSHOW_SUCCESS;
+    } else {
+      result = REDSHOW_ERROR_DUPLICATE_ENTRY;
+    }
 
-  if (result != REDSHOW_ERROR_DUPLICATE_ENTRY) {
-    auto *pcs = new uint64_t[nsymbols];
-    cubin_cache_map[cubin_id].symbol_pcs[mod_id].reset(pcs);
-    for (size_t i = 0; i < nsymbols; ++i) {
-      pcs[i] = symbol_pcs[i];
+    if (result != REDSHOW_ERROR_DUPLICATE_ENTRY) {
+      auto *pcs = new uint64_t[nsymbols];
+      cubin_cache->symbol_pcs[mod_id].reset(pcs);
+      for (size_t i = 0; i < nsymbols; ++i) {
+        pcs[i] = symbol_pcs[i];
+      }
+      cubin_caches[cubin_id] = cubin_cache;
     }
-  }
-  cubin_cache_map.unlock();
+    return result != REDSHOW_ERROR_DUPLICATE_ENTRY;
+  });
 
   return result;
 }
@@ -811,19 +1335,31 @@ redshow_result_t redshow_cubin_cache_register(uint32_t cubin_id, uint32_t mod_id
 redshow_result_t redshow_cubin_unregister(uint32_t cubin_id, uint32_t mod_id) {
   PRINT("\nredshow-> Enter redshow_cubin_unregister\ncubin_id: %u\n", cubin_id);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_CUBIN_UNREGISTER).put<u32>(cubin_id)
+                             .put<u32>(mod_id));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  cubin_map.lock();
-  if (cubin_map.has(cubin_id)) {
-    cubin_map.at(cubin_id).symbols.erase(mod_id);
-    if (cubin_map.at(cubin_id).symbols.size() == 0) {
-      cubin_map.erase(cubin_id);
+  cubin_map.update([&](CubinMap::Version &cubins) {
+    if (cubins.has(cubin_id)) {
+      auto cubin = std::make_shared<Cubin>(*cubins.at(cubin_id));
+      cubin->symbols.erase(mod_id);
+      function_index.erase(cubin_id, mod_id);
+      if (cubin->symbols.size() == 0) {
+        cubins.erase(cubin_id);
+        // Release the prefetched graph with the cubin
+        cubin_prefetcher.erase(cubin_id);
+      } else {
+        cubins[cubin_id] = cubin;
+      }
+      result = REDSHOW_SUCCESS;
+    } else {
+      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
     }
-    result = REDSHOW_SUCCESS;
-  } else {
-    result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-  }
-  cubin_map.unlock();
+    return result == REDSHOW_SUCCESS;
+  });
 
   return result;
 }
@@ -835,43 +1371,27 @@ redshow_result_t redshow_memory_register(uint32_t stream_id, int32_t memory_id,
       "start: %lu\nend: %lu\n",
       stream_id, memory_id, host_op_id, start, end);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_MEMORY_REGISTER).put<u32>(stream_id)
+                             .put<i32>(memory_id).put<u64>(host_op_id).put<u64>(start)
+                             .put<u64>(end));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  MemoryMap memory_map;
   MemoryRange memory_range(start, end);
   auto memory = std::make_shared<Memory>(stream_id, host_op_id, memory_id, memory_range);
 
-  memory_snapshot.lock();
-  if (memory_snapshot.size() == 0) {
-    // First snapshot
-    memory_map[memory_range] = memory;
-    memory_snapshot[host_op_id] = memory_map;
-    result = REDSHOW_SUCCESS;
+  memory_index.lock();
+  result = memory_index.insert(memory);
+  memory_index.unlock();
+
+  if (result == REDSHOW_SUCCESS) {
     PRINT("Register memory_id %d\n", memory_id);
-  } else {
-    // snapshot_iter's op_id <= host_op_id
-    auto iter = memory_snapshot.prev(host_op_id);
-    if (iter != memory_snapshot.end()) {
-      // Take a snapshot
-      memory_map = iter->second;
-      if (!memory_map.has(memory_range)) {
-        memory_map[memory_range] = memory;
-        memory_snapshot[host_op_id] = memory_map;
-        result = REDSHOW_SUCCESS;
-        PRINT("Register memory_id %d\n", memory_id);
-      } else {
-        result = REDSHOW_ERROR_DUPLICATE_ENTRY;
-      }
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
   }
-  memory_snapshot.unlock();
 
   if (result == REDSHOW_SUCCESS) {
-    for (auto aiter : analysis_enabled) {
-      aiter.second->op_callback(memory);
-    }
+    analysis_op_callback(memory);
   }
 
   return result;
@@ -883,34 +1403,23 @@ redshow_result_t redshow_memory_unregister(uint32_t stream_id, int32_t memory_id
         "host_op_id: %lu\nstart: %lu\nend: %lu\n",
         stream_id, memory_id, host_op_id, start, end);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_MEMORY_UNREGISTER).put<u32>(stream_id)
+                             .put<i32>(memory_id).put<u64>(host_op_id).put<u64>(start)
+                             .put<u64>(end));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  MemoryMap memory_map;
   MemoryRange memory_range(start, end);
   auto memfree = std::make_shared<Memfree>(stream_id, host_op_id, memory_id, memory_range);
 
-  memory_snapshot.lock();
-  auto snapshot_iter = memory_snapshot.prev(host_op_id);
-  if (snapshot_iter != memory_snapshot.end()) {
-    // Take a snapshot
-    memory_map = snapshot_iter->second;
-    auto memory_map_iter = memory_map.find(memory_range);
-    if (memory_map_iter != memory_map.end()) {
-      memory_map.erase(memory_map_iter);
-      memory_snapshot[host_op_id] = memory_map;
-      result = REDSHOW_SUCCESS;
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
-  } else {
-    result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-  }
-  memory_snapshot.unlock();
+  memory_index.lock();
+  result = memory_index.erase(host_op_id, memory_range);
+  memory_index.unlock();
 
   if (result == REDSHOW_SUCCESS) {
-    for (auto aiter : analysis_enabled) {
-      aiter.second->op_callback(memfree);
-    }
+    analysis_op_callback(memfree);
   }
 
   return result;
@@ -921,45 +1430,28 @@ redshow_result_t redshow_submemory_register(int32_t sub_memory_id, uint64_t host
   PRINT("\nredshow-> Enter redshow_submemory_register\nmemory_id: %d\nhost_op_id: %lu\nstart: %lu\nend: %lu\n",
   sub_memory_id, host_op_id, start, end);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_SUBMEMORY_REGISTER).put<i32>(sub_memory_id)
+                             .put<u64>(host_op_id).put<u64>(start).put<u64>(end));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  MemoryMap sub_memory_map;
   MemoryRange sub_memory_range(start, end);
 
   auto submemory = std::make_shared<Memory>(0, host_op_id, sub_memory_id, sub_memory_range);
 
-  sub_memory_snapshot.lock();
-    if (sub_memory_snapshot.size() == 0) {
-        // First sub-memory snapshot
-        sub_memory_map[sub_memory_range] = submemory;
-        sub_memory_snapshot[host_op_id] = sub_memory_map;
-        result = REDSHOW_SUCCESS;
-        PRINT("Register sub-memory_id %d\n", sub_memory_id);
-    } else {
-        auto iter = sub_memory_snapshot.prev(host_op_id);
-        if (iter != sub_memory_snapshot.end()) {
-            // Take a snapshot
-            sub_memory_map = iter->second;
-            if (!sub_memory_map.has(sub_memory_range)) {
-                sub_memory_map[sub_memory_range] = submemory;
-                sub_memory_snapshot[host_op_id] = sub_memory_map;
-                result = REDSHOW_SUCCESS;
-                PRINT("Register memory_id %d\n", sub_memory_id);
-            } else {
-                result = REDSHOW_ERROR_DUPLICATE_ENTRY;
-            }
-        } else {
-            result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-        }
-    }
-    sub_memory_snapshot.unlock();
+  sub_memory_index.lock();
+  result = sub_memory_index.insert(submemory);
+  sub_memory_index.unlock();
+
+  if (result == REDSHOW_SUCCESS) {
+    PRINT("Register sub-memory_id %d\n", sub_memory_id);
+  }
 
     bool is_submemory = true;
     if (result == REDSHOW_SUCCESS) {
-        for (auto aiter : analysis_enabled) {
-
-            aiter.second->op_callback(submemory, is_submemory);
-        }
+        analysis_op_callback(submemory, is_submemory);
     }
 
     return result;    
@@ -971,35 +1463,23 @@ redshow_result_t redshow_submemory_unregister(int32_t sub_memory_id, uint64_t ho
   PRINT("\nredshow-> Enter redshow_submemory_unregister\nmemory_free_id: %d\nhost_op_id: %lu\nstart: %lu\nend: %lu\n",
         sub_memory_id, host_op_id, start, end);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_SUBMEMORY_UNREGISTER).put<i32>(sub_memory_id)
+                             .put<u64>(host_op_id).put<u64>(start).put<u64>(end));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  MemoryMap sub_memory_map;
   MemoryRange sub_memory_range(start, end);
   auto submemfree = std::make_shared<Memfree>(0, host_op_id, sub_memory_id, sub_memory_range);
 
-  sub_memory_snapshot.lock();
-  auto snapshot_iter = sub_memory_snapshot.prev(host_op_id);
-  if (snapshot_iter != sub_memory_snapshot.end()) {
-    // Take a snapshot
-    sub_memory_map = snapshot_iter->second;
-    auto sub_memory_map_iter = sub_memory_map.find(sub_memory_range);
-    if (sub_memory_map_iter != sub_memory_map.end()) {
-      sub_memory_map.erase(sub_memory_map_iter);
-      sub_memory_snapshot[host_op_id] = sub_memory_map;
-      result = REDSHOW_SUCCESS;
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
-  } else {
-    result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-  }
-  sub_memory_snapshot.unlock();
+  sub_memory_index.lock();
+  result = sub_memory_index.erase(host_op_id, sub_memory_range);
+  sub_memory_index.unlock();
 
   bool is_submemory = true;
   if (result == REDSHOW_SUCCESS) {
-    for (auto aiter : analysis_enabled) {
-      aiter.second->op_callback(submemfree, is_submemory);
-    }
+    analysis_op_callback(submemfree, is_submemory);
   }
 
   return result;
@@ -1012,30 +1492,22 @@ redshow_result_t redshow_memory_query(uint64_t host_op_id, uint64_t start, int32
 
   redshow_result_t result = REDSHOW_SUCCESS;
 
-  MemoryRange memory_range(start, 0);
-
-  memory_snapshot.lock();
-  auto snapshot_iter = memory_snapshot.prev(host_op_id);
-  if (snapshot_iter != memory_snapshot.end()) {
-    auto &memory_map = snapshot_iter->second;
-    auto memory_map_iter = memory_map.prev(memory_range);
-    if (memory_map_iter != memory_map.end() && memory_map_iter->first.end >= start) {
-      // Fall into the range, assume no memory overflow
-      *memory_id = memory_map_iter->second->ctx_id;
-      *memory_op_id = memory_map_iter->second->op_id;
-      auto offset = start - memory_map_iter->first.start;
-      *shadow_start = reinterpret_cast<uint64_t>(memory_map_iter->second->value.get()) + offset;
-      *len = memory_map_iter->second->len;
-      PRINT("memory_id: %d\nmemory_op_id: %lu\noffset %lu\nshadow: %lu\nlen: %lu\n", *memory_id,
-            *memory_op_id, offset, *shadow_start, *len);
-      result = REDSHOW_SUCCESS;
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
+  memory_index.lock_shared();
+  auto *memory = memory_index.find(host_op_id, start);
+  if (memory != NULL) {
+    // Fall into the range, assume no memory overflow
+    *memory_id = memory->ctx_id;
+    *memory_op_id = memory->op_id;
+    auto offset = start - memory->memory_range.start;
+    *shadow_start = reinterpret_cast<uint64_t>(memory->value.get()) + offset;
+    *len = memory->len;
+    PRINT("memory_id: %d\nmemory_op_id: %lu\noffset %lu\nshadow: %lu\nlen: %lu\n", *memory_id,
+          *memory_op_id, offset, *shadow_start, *len);
+    result = REDSHOW_SUCCESS;
   } else {
     result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
   }
-  memory_snapshot.unlock();
+  memory_index.unlock_shared();
 
   return result;
 }
@@ -1049,25 +1521,17 @@ EXTERNC redshow_result_t redshow_memory_ranges_get(uint64_t host_op_id, uint64_t
   redshow_result_t result = REDSHOW_SUCCESS;
 
   *len = 0;
-  memory_snapshot.lock();
-  auto snapshot_iter = memory_snapshot.prev(host_op_id);
-  if (snapshot_iter != memory_snapshot.end()) {
-    auto &memory_map = snapshot_iter->second;
-    if (memory_map.size() != 0) {
-      auto memory_map_iter = memory_map.begin();
-      while (memory_map_iter != memory_map.end()) {
-        start_end[(*len)].start = memory_map_iter->first.start;
-        start_end[(*len)].end = memory_map_iter->first.end;
-        ++(*len);
-        ++memory_map_iter;
-      }
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
-  } else {
+  memory_index.lock_shared();
+  memory_index.visit(host_op_id, [&](const Memory &memory) {
+    start_end[(*len)].start = memory.memory_range.start;
+    start_end[(*len)].end = memory.memory_range.end;
+    ++(*len);
+  });
+  memory_index.unlock_shared();
+
+  if (*len == 0) {
     result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
   }
-  memory_snapshot.unlock();
 
   return result;
 }
@@ -1082,25 +1546,17 @@ EXTERNC redshow_result_t redshow_submemory_ranges_get(uint64_t host_op_id, uint6
   redshow_result_t result = REDSHOW_SUCCESS;
 
   *len = 0;
-  sub_memory_snapshot.lock();
-  auto snapshot_iter = sub_memory_snapshot.prev(host_op_id);
-  if (snapshot_iter != sub_memory_snapshot.end()) {
-    auto &memory_map = snapshot_iter->second;
-    if (memory_map.size() != 0) {
-      auto memory_map_iter = memory_map.begin();
-      while (memory_map_iter != memory_map.end()) {
-        start_end[(*len)].start = memory_map_iter->first.start;
-        start_end[(*len)].end = memory_map_iter->first.end;
-        ++(*len);
-        ++memory_map_iter;
-      }
-    } else {
-      result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
-    }
-  } else {
+  sub_memory_index.lock_shared();
+  sub_memory_index.visit(host_op_id, [&](const Memory &memory) {
+    start_end[(*len)].start = memory.memory_range.start;
+    start_end[(*len)].end = memory.memory_range.end;
+    ++(*len);
+  });
+  sub_memory_index.unlock_shared();
+
+  if (*len == 0) {
     result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
   }
-  sub_memory_snapshot.unlock();
 
   return result;
 }
@@ -1114,6 +1570,13 @@ redshow_result_t redshow_memcpy_register(int32_t memcpy_id, uint64_t host_op_id,
       "%lu\nlen: %lu\n",
       memcpy_id, host_op_id, src_host, src_stream_id, src_start, dst_host, dst_stream_id, dst_start, len);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_MEMCPY_REGISTER).put<i32>(memcpy_id)
+                             .put<u64>(host_op_id).put<u8>(src_host).put<u32>(src_stream_id)
+                             .put<u64>(src_start).put<u8>(dst_host).put<u32>(dst_stream_id)
+                             .put<u64>(dst_start).put<u64>(len));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
   i32 src_mem_id = 0;
@@ -1149,9 +1612,7 @@ redshow_result_t redshow_memcpy_register(int32_t memcpy_id, uint64_t host_op_id,
                                            src_mem_addr, dst_mem_op_id, dst_stream_id, dst_start,
                                            dst_mem_addr, len);
 
-    for (auto aiter : analysis_enabled) {
-      aiter.second->op_callback(memcpy);
-    }
+    analysis_op_callback(memcpy);
   }
 
   return result;
@@ -1164,6 +1625,12 @@ redshow_result_t redshow_memset_register(uint32_t stream_id, int32_t memset_id,
       "%lu\nvalue: %u\nlen: %lu\n",
       stream_id, memset_id, host_op_id, start, value, len);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_MEMSET_REGISTER).put<u32>(stream_id)
+                             .put<i32>(memset_id).put<u64>(host_op_id).put<u64>(start)
+                             .put<u32>(value).put<u64>(len));
+  }
+
   redshow_result_t result = REDSHOW_SUCCESS;
 
   i32 mem_id = 0;
@@ -1176,9 +1643,7 @@ redshow_result_t redshow_memset_register(uint32_t stream_id, int32_t memset_id,
   auto memset = std::make_shared<Memset>(host_op_id, memset_id, mem_op_id, stream_id, start, addr, value, len);
 
   if (addr != 0) {
-    for (auto aiter : analysis_enabled) {
-      aiter.second->op_callback(memset);
-    }
+    analysis_op_callback(memset);
   }
 
   return result;
@@ -1192,6 +1657,11 @@ redshow_result_t redshow_log_data_callback_register(redshow_log_data_callback_fu
 
 redshow_result_t redshow_record_data_callback_register(redshow_record_data_callback_func func,
                                                        uint32_t pc_views, uint32_t mem_views) {
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_RECORD_DATA_CONFIG).put<u32>(pc_views)
+                             .put<u32>(mem_views));
+  }
+
   record_data_callback = func;
   pc_views_limit = pc_views;
   mem_views_limit = mem_views;
@@ -1200,8 +1670,10 @@ redshow_result_t redshow_record_data_callback_register(redshow_record_data_callb
 }
 
 redshow_result_t redshow_tool_dtoh_register(redshow_tool_dtoh_func func) {
+  tool_dtoh_func = func;
+
   for (auto &aiter : analysis_enabled) {
-    aiter.second->dtoh_register(func);
+    aiter.second->dtoh_register(tool_dtoh);
   }
 
   return REDSHOW_SUCCESS;
@@ -1220,6 +1692,11 @@ redshow_result_t redshow_mem_views_get(uint32_t *views) {
 }
 
 redshow_result_t redshow_kernel_begin(uint32_t cpu_thread, int32_t kernel_id, uint64_t host_op_id) {
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_KERNEL_BEGIN).put<u32>(cpu_thread)
+                             .put<i32>(kernel_id).put<u64>(host_op_id));
+  }
+
   return REDSHOW_SUCCESS;
 }
 
@@ -1227,15 +1704,18 @@ redshow_result_t redshow_kernel_end(uint32_t cpu_thread, uint32_t stream_id, int
   PRINT("\nredshow-> Enter redshow_kernel_end\ncpu_thread: %u\nstream_id: %u\nkernel_id: %d\nhost_op_id: %lu\n",
         cpu_thread, stream_id, kernel_id, host_op_id);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_KERNEL_END).put<u32>(cpu_thread)
+                             .put<u32>(stream_id).put<i32>(kernel_id).put<u64>(host_op_id));
+  }
+
   // propose changes
   // read_memory_op_ids, write_memory_op_ids
   redshow_result_t result = REDSHOW_SUCCESS;
 
   auto kernel = std::make_shared<Kernel>(host_op_id, kernel_id, cpu_thread, stream_id);
 
-  for (auto aiter : analysis_enabled) {
-    aiter.second->op_callback(kernel);
-  }
+  analysis_op_callback(kernel);
 
   return REDSHOW_SUCCESS;
 }
@@ -1248,6 +1728,12 @@ redshow_result_t redshow_analyze(uint32_t cpu_thread, uint32_t cubin_id, uint32_
       "kernel_id: %d\nhost_op_id: %lu\ntrace_data: %p\n",
       cpu_thread, cubin_id, mod_id, kernel_id, host_op_id, trace_data);
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYZE).put<u32>(cpu_thread).put<u32>(cubin_id)
+                             .put<u32>(mod_id).put<i32>(kernel_id).put<u64>(host_op_id)
+                             .put<u32>(stream_id).put_buffer(trace_data));
+  }
+
   redshow_result_t result;
 
   // Analyze trace_data
@@ -1272,9 +1758,132 @@ redshow_result_t redshow_analyze(uint32_t cpu_thread, uint32_t cubin_id, uint32_
   return result;
 }
 
+redshow_result_t redshow_analysis_async_config(uint32_t num_workers, uint64_t queue_bytes) {
+  PRINT("\nredshow-> Enter redshow_analysis_async_config\nnum_workers: %u\nqueue_bytes: %lu\n",
+        num_workers, queue_bytes);
+
+  if (analysis_pool.running()) {
+    return REDSHOW_ERROR_DUPLICATE_ENTRY;
+  }
+
+  async_num_workers = num_workers;
+  async_queue_bytes = queue_bytes;
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_analyze_async(uint32_t cpu_thread, uint32_t cubin_id, uint32_t mod_id,
+                                       int32_t kernel_id, uint64_t host_op_id, uint32_t stream_id,
+                                       gpu_patch_buffer_t *trace_data) {
+  PRINT(
+      "\nredshow-> Enter redshow_analyze_async\ncpu_thread: %u\ncubin_id: %u\nmod_id: %u\n"
+      "kernel_id: %d\nhost_op_id: %lu\ntrace_data: %p\n",
+      cpu_thread, cubin_id, mod_id, kernel_id, host_op_id, trace_data);
+
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYZE).put<u32>(cpu_thread).put<u32>(cubin_id)
+                             .put<u32>(mod_id).put<i32>(kernel_id).put<u64>(host_op_id)
+                             .put<u32>(stream_id).put_buffer(trace_data));
+  }
+
+  if (!log_data_callback) {
+    return REDSHOW_ERROR_NOT_REGISTER_CALLBACK;
+  }
+
+  redshow_result_t result = REDSHOW_SUCCESS;
+
+  memory_index.lock_shared();
+  if (!memory_index.has_snapshot(host_op_id)) {
+    result = REDSHOW_ERROR_NOT_EXIST_ENTRY;
+  }
+  memory_index.unlock_shared();
+
+  // Memory snapshot not found
+  if (result != REDSHOW_SUCCESS) {
+    return result;
+  }
+
+  // Own a copy of the trace, so the buffer can be handed back right away
+  auto trace = std::make_shared<TraceBuffer>();
+  trace->copy(trace_data);
+  Stats::add(STATS_TRACE_COPY, 1);
+  Stats::add(STATS_TRACE_COPY_BYTES, trace->records_size());
+
+  log_data_callback(kernel_id, trace_data);
+  if (mini_host_op_id == 0) {
+    mini_host_op_id = host_op_id;
+  } else {
+    mini_host_op_id = MIN2(mini_host_op_id, host_op_id);
+  }
+
+  analysis_pool.start(async_num_workers, async_queue_bytes);
+
+  // Traces of a kernel instance stay on the same worker and are analyzed in order
+  u64 key = (static_cast<u64>(cpu_thread) << 32) ^ static_cast<u32>(kernel_id);
+  u64 bytes = sizeof(TraceBuffer) + trace->records_size();
+  analysis_pool.submit(key, bytes, [=]() {
+    auto ret = trace_analyze(cpu_thread, cubin_id, mod_id, kernel_id, host_op_id, stream_id,
+                             &trace->buffer);
+    if (ret != REDSHOW_SUCCESS) {
+      PRINT("\nredshow-> Fail redshow_analyze_async result %d\n", ret);
+    }
+  });
+
+  return result;
+}
+
+redshow_result_t redshow_analysis_drain() {
+  PRINT("\nredshow-> Enter redshow_analysis_drain\n");
+
+  if (analysis_pool.running()) {
+    analysis_pool.drain();
+  }
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_capture_enable(const char *path) {
+  PRINT("\nredshow-> Enter redshow_capture_enable\npath: %s\n", path);
+
+  if (capture_writer.is_open()) {
+    return REDSHOW_ERROR_DUPLICATE_ENTRY;
+  }
+
+  if (!capture_writer.open(std::string(path))) {
+    return REDSHOW_ERROR_NO_SUCH_FILE;
+  }
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_capture_disable() {
+  PRINT("\nredshow-> Enter redshow_capture_disable\n");
+
+  if (!capture_writer.is_open()) {
+    // A failed write already closed an incomplete capture file
+    return capture_writer.failed() ? REDSHOW_ERROR_NO_SUCH_FILE : REDSHOW_ERROR_NOT_EXIST_ENTRY;
+  }
+
+  capture_writer.close();
+
+  return REDSHOW_SUCCESS;
+}
+
+redshow_result_t redshow_stats_get(redshow_stats_t *stats) {
+  PRINT("\nredshow-> Enter redshow_stats_get\n");
+
+  Stats::get(stats);
+
+  return REDSHOW_SUCCESS;
+}
+
 redshow_result_t redshow_analysis_begin() {
   PRINT("\nredshow-> Enter redshow_analysis_begin\n");
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYSIS_BEGIN));
+  }
+
   mini_host_op_id = 0;
 
   return REDSHOW_SUCCESS;
@@ -1283,28 +1892,23 @@ redshow_result_t redshow_analysis_begin() {
 redshow_result_t redshow_analysis_end() {
   PRINT("\nredshow-> Enter redshow_analysis_end\n");
 
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_ANALYSIS_END));
+  }
+
   redshow_result_t result;
 
+  redshow_analysis_drain();
+
   if (mini_host_op_id != 0 && !analysis_enabled.has(REDSHOW_ANALYSIS_DATA_FLOW)) {
-    // Remove all the memory snapshots before mini_host_op_id
-    Vector<uint64_t> ids;
-
-    memory_snapshot.lock();
-    uint64_t max_min_host_op_id = 0;
-    for (auto &iter : memory_snapshot) {
-      if (iter.first < mini_host_op_id) {
-        ids.push_back(iter.first);
-        max_min_host_op_id = MAX2(iter.first, max_min_host_op_id);
-      }
-    }
-    // Maintain the largest snapshot
-    for (auto &id : ids) {
-      if (id == max_min_host_op_id) {
-        continue;
-      }
-      memory_snapshot.erase(id);
-    }
-    memory_snapshot.unlock();
+    // Remove all the memory objects freed before mini_host_op_id
+    memory_index.lock();
+    memory_index.prune(mini_host_op_id);
+    memory_index.unlock();
+
+    sub_memory_index.lock();
+    sub_memory_index.prune(mini_host_op_id);
+    sub_memory_index.unlock();
 
     result = REDSHOW_SUCCESS;
   } else {
@@ -1317,7 +1921,14 @@ redshow_result_t redshow_analysis_end() {
 redshow_result_t redshow_flush_thread(uint32_t cpu_thread) {
   PRINT("\nredshow-> Enter redshow_flush cpu_thread %u\n", cpu_thread);
 
-  for (auto aiter : analysis_enabled) {
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_FLUSH_THREAD).put<u32>(cpu_thread));
+  }
+
+  redshow_analysis_drain();
+
+  for (auto &aiter : analysis_enabled) {
+    StatsTimer timer(stats_analysis(aiter.first, STATS_PHASE_FLUSH));
     aiter.second->flush_thread(cpu_thread, output_dir[aiter.first], cubin_map,
                                record_data_callback);
   }
@@ -1328,9 +1939,28 @@ redshow_result_t redshow_flush_thread(uint32_t cpu_thread) {
 redshow_result_t redshow_flush() {
   PRINT("\nredshow-> Enter redshow_flush\n");
 
-  for (auto aiter : analysis_enabled) {
+  if (capture_writer.is_open()) {
+    capture_writer.write(TraceEvent(TRACE_EVENT_FLUSH));
+  }
+
+  redshow_analysis_drain();
+
+  cubin_prefetcher.stop();
+  if (!cubin_prefetch_hint_file.empty()) {
+    cubin_prefetcher.store_hints(cubin_prefetch_hint_file);
+  }
+
+  for (auto &aiter : analysis_enabled) {
+    StatsTimer timer(stats_analysis(aiter.first, STATS_PHASE_FLUSH));
     aiter.second->flush(output_dir[aiter.first], cubin_map, record_data_callback);
   }
 
+  // Next to the results of the first enabled analysis
+  std::string stats_dir;
+  if (!analysis_enabled.empty()) {
+    stats_dir = output_dir[analysis_enabled.begin()->first];
+  }
+  Stats::dump(stats_dir + "redshow_stats.json");
+
   return REDSHOW_SUCCESS;
 }
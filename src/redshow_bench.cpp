@@ -0,0 +1,536 @@
+#include <redshow.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "analysis/value_decoder.h"
+#include "bench/peak_rss.h"
+#include "bench/trace_generator.h"
+#include "common/simd.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+using namespace redshow;
+
+struct BenchConfig {
+  Vector<redshow_analysis_type_t> analyses;
+  Vector<GPUPatchType> types;
+  Vector<TraceAccessPattern> patterns;
+  Vector<TraceValueRedundancy> redundancies;
+  Vector<u32> kinds;
+  Vector<u32> num_records;
+  Vector<u32> num_threads;
+  Vector<u32> num_memories;
+  u32 iterations = 4;
+  // Identical default records in a row
+  u32 repeats = 1;
+  bool dedup = false;
+  // Only time the value decoder on default records of each kind, instead of running analyses
+  bool decode = false;
+  std::string output = "redshow_bench.json";
+};
+
+struct BenchResult {
+  u64 records = 0;
+  u64 failures = 0;
+  double seconds = 0.0;
+  u64 peak_rss_kb = 0;
+};
+
+static const char *ANALYSIS_NAMES[] = {
+    "unknown",        "spatial_redundancy", "temporal_redundancy", "value_pattern",
+    "data_flow",      "memory_profile",     "memory_heatmap",      "memory_liveness",
+    "data_dependency", "torch_monitor"};
+
+static const char *TYPE_NAMES[] = {"default", "address_patch", "address_analysis"};
+
+// Access kind of default records. Without instruction files, the unit size is the access size
+// up to 32 bits, and the data type is the configured one, so kinds of 64-bit units are only
+// timed by the value decoder.
+struct BenchKind {
+  const char *name;
+  redshow_data_type_t data_type;
+  u32 access_size;
+  // Bits
+  u32 unit_size;
+};
+
+static const BenchKind KINDS[] = {
+    {"f32", REDSHOW_DATA_FLOAT, 4, 32},    {"f32x2", REDSHOW_DATA_FLOAT, 8, 32},
+    {"f32x4", REDSHOW_DATA_FLOAT, 16, 32}, {"f64", REDSHOW_DATA_FLOAT, 8, 64},
+    {"f64x2", REDSHOW_DATA_FLOAT, 16, 64}, {"i8", REDSHOW_DATA_INT, 1, 8},
+    {"i16", REDSHOW_DATA_INT, 2, 16},      {"i32", REDSHOW_DATA_INT, 4, 32},
+    {"i32x4", REDSHOW_DATA_INT, 16, 32},   {"u64", REDSHOW_DATA_INT, 8, 64}};
+
+static const u32 NUM_KINDS = sizeof(KINDS) / sizeof(BenchKind);
+
+// Single synthetic cubin with one function at TRACE_GENERATOR_PC_START
+static const u32 BENCH_CUBIN_ID = 1;
+static const u32 BENCH_MOD_ID = 0;
+
+static u64 next_host_op_id = 1;
+static i32 next_kernel_id = 1;
+
+static void bench_log_data(int32_t /* kernel_id */, gpu_patch_buffer_t * /* trace_data */) {}
+
+static void bench_record_data(uint32_t /* cubin_id */, int32_t /* kernel_id */,
+                              redshow_record_data_t * /* record_data */) {}
+
+static void bench_dtoh(uint64_t /* host_start */, uint64_t /* device_start */,
+                       uint64_t /* len */) {
+  // Device memory is not simulated
+}
+
+// Trace types that the sanitizer collects for each analysis
+static bool analysis_supports(redshow_analysis_type_t analysis, GPUPatchType type) {
+  switch (analysis) {
+    case REDSHOW_ANALYSIS_SPATIAL_REDUNDANCY:
+    case REDSHOW_ANALYSIS_TEMPORAL_REDUNDANCY:
+    case REDSHOW_ANALYSIS_VALUE_PATTERN:
+      return type == GPU_PATCH_TYPE_DEFAULT;
+    case REDSHOW_ANALYSIS_MEMORY_HEATMAP:
+      // Address analysis records carry no unit size to compress the heatmap
+      return type == GPU_PATCH_TYPE_DEFAULT || type == GPU_PATCH_TYPE_ADDRESS_PATCH;
+    default:
+      return type == GPU_PATCH_TYPE_ADDRESS_PATCH || type == GPU_PATCH_TYPE_ADDRESS_ANALYSIS;
+  }
+}
+
+// Other analyses keep a single in-flight kernel trace and cannot be analyzed by concurrent threads
+static bool analysis_concurrent(redshow_analysis_type_t analysis) {
+  return analysis == REDSHOW_ANALYSIS_SPATIAL_REDUNDANCY ||
+         analysis == REDSHOW_ANALYSIS_TEMPORAL_REDUNDANCY ||
+         analysis == REDSHOW_ANALYSIS_VALUE_PATTERN;
+}
+
+template <typename T>
+static bool parse_list(const std::string &arg, const char *const *names, size_t num_names,
+                       Vector<T> &list) {
+  list.clear();
+
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    bool found = false;
+    for (size_t i = 0; i < num_names; ++i) {
+      if (item == names[i]) {
+        list.push_back(static_cast<T>(i));
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      return false;
+    }
+  }
+  return !list.empty();
+}
+
+static bool parse_numbers(const std::string &arg, Vector<u32> &list) {
+  list.clear();
+
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    try {
+      list.push_back(std::stoul(item));
+    } catch (...) {
+      return false;
+    }
+  }
+  return !list.empty();
+}
+
+static BenchResult run_case(redshow_analysis_type_t analysis, const TraceGeneratorConfig &config,
+                            u32 num_threads, u32 iterations) {
+  BenchResult bench_result;
+
+  redshow_analysis_enable(analysis);
+  redshow_tool_dtoh_register(bench_dtoh);
+
+  // One generator per thread, so traces of different threads differ in random patterns
+  Vector<TraceGenerator> generators;
+  Vector<TraceBuffer> buffers(num_threads);
+  for (u32 i = 0; i < num_threads; ++i) {
+    auto thread_config = config;
+    thread_config.seed = config.seed + i;
+    generators.emplace_back(thread_config);
+    generators[i].generate(buffers[i]);
+  }
+
+  reset_peak_rss();
+
+  auto &memories = generators[0].memories();
+  for (size_t i = 0; i < memories.size(); ++i) {
+    redshow_memory_register(0, i + 1, next_host_op_id++, memories[i].start, memories[i].end);
+  }
+
+  for (u32 iter = 0; iter < iterations; ++iter) {
+    Vector<i32> kernel_ids(num_threads);
+    Vector<u64> host_op_ids(num_threads);
+    Vector<redshow_result_t> results(num_threads);
+    for (u32 i = 0; i < num_threads; ++i) {
+      kernel_ids[i] = next_kernel_id++;
+      host_op_ids[i] = next_host_op_id++;
+      redshow_kernel_begin(i, kernel_ids[i], host_op_ids[i]);
+    }
+
+    // Only redshow_analyze is timed, each thread plays a cpu thread of the profiled application
+    auto begin = std::chrono::steady_clock::now();
+    Vector<std::thread> threads;
+    for (u32 i = 0; i < num_threads; ++i) {
+      threads.emplace_back([&, i]() {
+        results[i] = redshow_analyze(i, BENCH_CUBIN_ID, BENCH_MOD_ID, kernel_ids[i],
+                                     host_op_ids[i], 0, &buffers[i].buffer);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    bench_result.seconds += std::chrono::duration<double>(end - begin).count();
+
+    for (u32 i = 0; i < num_threads; ++i) {
+      if (results[i] != REDSHOW_SUCCESS) {
+        bench_result.failures++;
+      }
+      bench_result.records += buffers[i].buffer.head_index;
+      redshow_kernel_end(i, 0, kernel_ids[i], host_op_ids[i]);
+    }
+  }
+
+  bench_result.peak_rss_kb = peak_rss_kb();
+
+  for (size_t i = 0; i < memories.size(); ++i) {
+    redshow_memory_unregister(0, i + 1, next_host_op_id++, memories[i].start, memories[i].end);
+  }
+
+  redshow_analysis_disable(analysis);
+
+  return bench_result;
+}
+
+// If redshow derives the kind from the access size of a record without instruction files
+static bool kind_without_instructions(const BenchKind &kind) {
+  return kind.unit_size == MIN2(32u, kind.access_size * 8);
+}
+
+static BenchResult decode_case(const BenchKind &kind, const TraceGeneratorConfig &config,
+                               u32 iterations, bool &specialized) {
+  BenchResult bench_result;
+
+  TraceGenerator generator(config);
+  TraceBuffer buffer;
+  generator.generate(buffer);
+  auto *records = reinterpret_cast<const gpu_patch_record_t *>(buffer.buffer.records);
+
+  int decimal_degree_f32;
+  int decimal_degree_f64;
+  redshow_approx_get(&decimal_degree_f32, &decimal_degree_f64);
+  AccessKind access_kind(kind.unit_size, kind.access_size * 8, kind.data_type);
+  ValueDecoder value_decoder(access_kind, decimal_degree_f32, decimal_degree_f64);
+  specialized = value_decoder.specialized();
+
+  auto warp_access = std::make_unique<WarpAccess>();
+  warp_access->access_kind = access_kind;
+  warp_access->access_kind.vec_size = kind.unit_size;
+  warp_access->num_units = access_kind.vec_size / access_kind.unit_size;
+
+  // Keeps the decoded values alive
+  u64 checksum = 0;
+  auto begin = std::chrono::steady_clock::now();
+  for (u32 iter = 0; iter < iterations; ++iter) {
+    for (u32 i = 0; i < buffer.buffer.head_index; ++i) {
+      warp_access->active = records[i].active;
+      value_decoder.decode(&records[i], *warp_access);
+      checksum += warp_access->values[0][i % GPU_PATCH_WARP_SIZE];
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  bench_result.seconds = std::chrono::duration<double>(end - begin).count();
+  bench_result.records = static_cast<u64>(iterations) * buffer.buffer.head_index;
+
+  volatile u64 sink = checksum;
+  (void)sink;
+
+  return bench_result;
+}
+
+// Times the value decoder alone, so kinds of 64-bit units are covered without instruction files
+static void decode_bench(const BenchConfig &bench_config, std::ofstream &out, bool &first) {
+  for (auto pattern : bench_config.patterns) {
+    for (auto redundancy : bench_config.redundancies) {
+      for (auto kind_index : bench_config.kinds) {
+        auto &kind = KINDS[kind_index];
+        for (auto num_records : bench_config.num_records) {
+          TraceGeneratorConfig config;
+          config.pattern = pattern;
+          config.redundancy = redundancy;
+          config.num_records = num_records;
+          config.num_memories = bench_config.num_memories[0];
+          config.memory_size = MAX2((64ul << 20) / config.num_memories, 4096ul);
+          config.access_size = kind.access_size;
+
+          bool specialized = false;
+          auto result = decode_case(kind, config, bench_config.iterations, specialized);
+          auto ns_per_record = result.records > 0 ? result.seconds * 1e9 / result.records : 0;
+
+          std::cout << "value_decoder default " << trace_access_pattern_name(pattern) << " "
+                    << trace_value_redundancy_name(redundancy) << " " << kind.name
+                    << " records " << num_records << ": " << ns_per_record << " ns/record, "
+                    << (specialized ? "specialized" : "generic") << std::endl;
+
+          if (!first) {
+            out << "," << std::endl;
+          }
+          first = false;
+          out << "    {\"analysis\": \"value_decoder\", "
+              << "\"type\": \"default\", "
+              << "\"pattern\": \"" << trace_access_pattern_name(pattern) << "\", "
+              << "\"redundancy\": \"" << trace_value_redundancy_name(redundancy) << "\", "
+              << "\"kind\": \"" << kind.name << "\", "
+              << "\"records\": " << num_records << ", "
+              << "\"specialized\": " << (specialized ? "true" : "false") << ", "
+              << "\"analyzed_records\": " << result.records << ", "
+              << "\"seconds\": " << result.seconds << ", "
+              << "\"ns_per_record\": " << ns_per_record << "}";
+        }
+      }
+    }
+  }
+}
+
+static void usage() {
+  std::cerr << "./redshow_bench [options]" << std::endl
+            << "  -a analyses    comma separated, e.g., spatial_redundancy,data_flow (all)"
+            << std::endl
+            << "  -t types       default,address_patch,address_analysis (all supported)"
+            << std::endl
+            << "  -p patterns    coalesced,strided,random,warp_uniform (all)" << std::endl
+            << "  -v redundancy  low,high (all)" << std::endl
+            << "  -k kinds       f32,f32x2,f32x4,f64,f64x2,i8,i16,i32,i32x4,u64 (f32)"
+            << std::endl
+            << "                 access kinds of default records, kinds of 64-bit units need -e 1"
+            << std::endl
+            << "  -n records     records per trace, comma separated (4096,65536)" << std::endl
+            << "  -j threads     analysis threads, comma separated (1,4)" << std::endl
+            << "                 only redundancy and value pattern analyses use more than one"
+            << std::endl
+            << "  -m memories    memory objects, comma separated (4,1024)" << std::endl
+            << "  -i iterations  kernels per thread (4)" << std::endl
+            << "  -r repeats     identical default records in a row (1)" << std::endl
+            << "  -d dedup       0,1, fold identical default records (0)" << std::endl
+            << "  -e decode      0,1, only time the value decoder on default records (0)"
+            << std::endl
+            << "  -o output      json output file (redshow_bench.json)" << std::endl;
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  BenchConfig bench_config;
+  for (u32 i = REDSHOW_ANALYSIS_SPATIAL_REDUNDANCY; i <= REDSHOW_ANALYSIS_TORCH_MONITOR; ++i) {
+    bench_config.analyses.push_back(static_cast<redshow_analysis_type_t>(i));
+  }
+  for (u32 i = 0; i < GPU_PATCH_TYPE_COUNT; ++i) {
+    bench_config.types.push_back(static_cast<GPUPatchType>(i));
+  }
+  for (u32 i = 0; i < TRACE_ACCESS_COUNT; ++i) {
+    bench_config.patterns.push_back(static_cast<TraceAccessPattern>(i));
+  }
+  for (u32 i = 0; i < TRACE_VALUE_COUNT; ++i) {
+    bench_config.redundancies.push_back(static_cast<TraceValueRedundancy>(i));
+  }
+  bench_config.kinds.assign({0});
+  bench_config.num_records.assign({4096, 65536});
+  bench_config.num_threads.assign({1, 4});
+  bench_config.num_memories.assign({4, 1024});
+
+  const char *pattern_names[TRACE_ACCESS_COUNT];
+  for (u32 i = 0; i < TRACE_ACCESS_COUNT; ++i) {
+    pattern_names[i] = trace_access_pattern_name(static_cast<TraceAccessPattern>(i));
+  }
+  const char *redundancy_names[TRACE_VALUE_COUNT];
+  for (u32 i = 0; i < TRACE_VALUE_COUNT; ++i) {
+    redundancy_names[i] = trace_value_redundancy_name(static_cast<TraceValueRedundancy>(i));
+  }
+  const char *kind_names[NUM_KINDS];
+  for (u32 i = 0; i < NUM_KINDS; ++i) {
+    kind_names[i] = KINDS[i].name;
+  }
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage();
+    }
+    std::string value = argv[++i];
+    bool valid = true;
+    if (arg == "-a") {
+      valid = parse_list(value, ANALYSIS_NAMES, sizeof(ANALYSIS_NAMES) / sizeof(char *),
+                         bench_config.analyses);
+    } else if (arg == "-t") {
+      valid = parse_list(value, TYPE_NAMES, GPU_PATCH_TYPE_COUNT, bench_config.types);
+    } else if (arg == "-p") {
+      valid = parse_list(value, pattern_names, TRACE_ACCESS_COUNT, bench_config.patterns);
+    } else if (arg == "-v") {
+      valid = parse_list(value, redundancy_names, TRACE_VALUE_COUNT, bench_config.redundancies);
+    } else if (arg == "-k") {
+      valid = parse_list(value, kind_names, NUM_KINDS, bench_config.kinds);
+    } else if (arg == "-n") {
+      valid = parse_numbers(value, bench_config.num_records);
+    } else if (arg == "-j") {
+      valid = parse_numbers(value, bench_config.num_threads);
+    } else if (arg == "-m") {
+      valid = parse_numbers(value, bench_config.num_memories);
+    } else if (arg == "-i") {
+      Vector<u32> iterations;
+      valid = parse_numbers(value, iterations);
+      if (valid) {
+        bench_config.iterations = MAX2(iterations[0], 1u);
+      }
+    } else if (arg == "-r") {
+      Vector<u32> repeats;
+      valid = parse_numbers(value, repeats);
+      if (valid) {
+        bench_config.repeats = MAX2(repeats[0], 1u);
+      }
+    } else if (arg == "-d") {
+      Vector<u32> dedup;
+      valid = parse_numbers(value, dedup);
+      if (valid) {
+        bench_config.dedup = dedup[0] != 0;
+      }
+    } else if (arg == "-e") {
+      Vector<u32> decode;
+      valid = parse_numbers(value, decode);
+      if (valid) {
+        bench_config.decode = decode[0] != 0;
+      }
+    } else if (arg == "-o") {
+      bench_config.output = value;
+    } else {
+      valid = false;
+    }
+    if (!valid) {
+      usage();
+    }
+  }
+
+  redshow_log_data_callback_register(bench_log_data);
+  redshow_record_data_callback_register(bench_record_data, PC_VIEWS_LIMIT, MEM_VIEWS_LIMIT);
+  redshow_record_dedup_config(bench_config.dedup);
+
+  // The .inst file does not exist, so the cubin is registered without an instruction graph
+  uint64_t symbol_pcs[1] = {TRACE_GENERATOR_PC_START};
+  redshow_cubin_register(BENCH_CUBIN_ID, BENCH_MOD_ID, 1, symbol_pcs,
+                         "/redshow_bench/cubins/redshow_bench.cubin");
+
+  std::ofstream out(bench_config.output);
+  out << "{" << std::endl;
+  out << "  \"compiler\": \"" << __VERSION__ << "\"," << std::endl;
+  out << "  \"iterations\": " << bench_config.iterations << "," << std::endl;
+  out << "  \"repeats\": " << bench_config.repeats << "," << std::endl;
+  out << "  \"dedup\": " << (bench_config.dedup ? "true" : "false") << "," << std::endl;
+  out << "  \"simd\": \"" << simd_level_name(simd_level()) << "\"," << std::endl;
+  out << "  \"results\": [" << std::endl;
+
+  bool first = true;
+  if (bench_config.decode) {
+    decode_bench(bench_config, out, first);
+  } else {
+    for (auto analysis : bench_config.analyses) {
+      for (auto type : bench_config.types) {
+        if (!analysis_supports(analysis, type)) {
+          continue;
+        }
+        for (auto pattern : bench_config.patterns) {
+          for (auto redundancy : bench_config.redundancies) {
+            if (type != GPU_PATCH_TYPE_DEFAULT && redundancy != bench_config.redundancies[0]) {
+              // Values are only recorded by the default type
+              continue;
+            }
+            for (auto kind_index : bench_config.kinds) {
+              auto &kind = KINDS[kind_index];
+              if (type != GPU_PATCH_TYPE_DEFAULT && kind_index != bench_config.kinds[0]) {
+                // Access kinds only apply to the default type
+                continue;
+              }
+              if (type == GPU_PATCH_TYPE_DEFAULT && !kind_without_instructions(kind)) {
+                std::cout << ANALYSIS_NAMES[analysis] << " " << TYPE_NAMES[type] << " "
+                          << kind.name << ": skipped, needs instruction files or -e 1"
+                          << std::endl;
+                continue;
+              }
+              for (auto num_memories : bench_config.num_memories) {
+                for (auto num_records : bench_config.num_records) {
+                  for (auto num_threads : bench_config.num_threads) {
+                    if (num_threads > 1 && !analysis_concurrent(analysis)) {
+                      continue;
+                    }
+                    TraceGeneratorConfig config;
+                    config.type = type;
+                    config.pattern = pattern;
+                    config.redundancy = redundancy;
+                    config.num_records = num_records;
+                    config.num_memories = num_memories;
+                    config.repeats = bench_config.repeats;
+                    // Keep the total size of memory objects around 64MB
+                    config.memory_size = MAX2((64ul << 20) / num_memories, 4096ul);
+                    if (type == GPU_PATCH_TYPE_DEFAULT) {
+                      config.access_size = kind.access_size;
+                    }
+                    redshow_data_type_config(kind.data_type);
+
+                    auto result = run_case(analysis, config, MAX2(num_threads, 1u),
+                                           bench_config.iterations);
+                    auto records_per_sec = result.seconds > 0 ? result.records / result.seconds : 0;
+                    auto ns_per_record =
+                        result.records > 0 ? result.seconds * 1e9 / result.records : 0;
+
+                    std::cout << ANALYSIS_NAMES[analysis] << " " << TYPE_NAMES[type] << " "
+                              << trace_access_pattern_name(pattern) << " "
+                              << trace_value_redundancy_name(redundancy) << " " << kind.name
+                              << " memories "
+                              << num_memories << " records " << num_records << " threads "
+                              << num_threads << ": " << records_per_sec << " records/s, "
+                              << ns_per_record << " ns/record, " << result.peak_rss_kb
+                              << " KB peak RSS" << std::endl;
+
+                    if (!first) {
+                      out << "," << std::endl;
+                    }
+                    first = false;
+                    out << "    {\"analysis\": \"" << ANALYSIS_NAMES[analysis] << "\", "
+                        << "\"type\": \"" << TYPE_NAMES[type] << "\", "
+                        << "\"pattern\": \"" << trace_access_pattern_name(pattern) << "\", "
+                        << "\"redundancy\": \"" << trace_value_redundancy_name(redundancy)
+                        << "\", "
+                        << "\"kind\": \"" << kind.name << "\", "
+                        << "\"memories\": " << num_memories << ", "
+                        << "\"records\": " << num_records << ", "
+                        << "\"threads\": " << num_threads << ", "
+                        << "\"analyzed_records\": " << result.records << ", "
+                        << "\"failures\": " << result.failures << ", "
+                        << "\"seconds\": " << result.seconds << ", "
+                        << "\"records_per_sec\": " << records_per_sec << ", "
+                        << "\"ns_per_record\": " << ns_per_record << ", "
+                        << "\"peak_rss_kb\": " << result.peak_rss_kb << "}";
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+
+  out << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+  return 0;
+}
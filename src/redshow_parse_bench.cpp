@@ -0,0 +1,344 @@
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "bench/peak_rss.h"
+#include "binutils/access_kind_table.h"
+#include "binutils/instruction.h"
+#include "binutils/instruction_cache.h"
+#include "binutils/instruction_reader.h"
+#include "binutils/symbol.h"
+#include "common/utils.h"
+#include "common/vector.h"
+
+using namespace redshow;
+
+enum ParseMode {
+  PARSE_STREAM = INSTRUCTION_READER_STREAM,
+  PARSE_TREE = INSTRUCTION_READER_TREE,
+  // Load from the instruction cache, including hashing the instruction file
+  PARSE_CACHE = 2,
+  PARSE_MODE_COUNT = 3
+};
+
+static const char *MODE_NAMES[] = {"stream", "tree", "cache"};
+
+enum GraphLayout { GRAPH_TREE = 0, GRAPH_FROZEN = 1, GRAPH_LAYOUT_COUNT = 2 };
+
+static const char *LAYOUT_NAMES[] = {"tree", "frozen"};
+
+struct ParseResult {
+  u64 instructions = 0;
+  u64 memory_instructions = 0;
+  double seconds = 0.0;
+  u64 peak_rss_kb = 0;
+};
+
+static ParseResult run_case(const std::string &file_path, ParseMode mode, u32 iterations,
+                            const std::string &cache_dir, SymbolVector &symbols,
+                            InstructionGraph &inst_graph, AccessKindTable &access_kinds) {
+  ParseResult parse_result;
+
+  reset_peak_rss();
+
+  for (u32 iter = 0; iter < iterations; ++iter) {
+    // Results of the last iteration are kept for comparison
+    symbols.clear();
+    inst_graph = InstructionGraph();
+
+    auto begin = std::chrono::steady_clock::now();
+    if (mode == PARSE_CACHE) {
+      // Same as redshow_cubin_register, the instruction graph is not loaded
+      InstructionCache::load(cache_dir, InstructionCache::key(file_path), symbols, access_kinds);
+    } else {
+      InstructionParser::parse(file_path, symbols, inst_graph,
+                               static_cast<InstructionReaderMode>(mode));
+      access_kinds.build(inst_graph, symbols);
+    }
+    auto end = std::chrono::steady_clock::now();
+    parse_result.seconds += std::chrono::duration<double>(end - begin).count();
+  }
+
+  parse_result.peak_rss_kb = peak_rss_kb();
+  parse_result.instructions = inst_graph.size();
+  for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end(); ++iter) {
+    if (iter->second.access_kind.get() != NULL) {
+      parse_result.memory_instructions++;
+    }
+  }
+
+  return parse_result;
+}
+
+struct GraphResult {
+  u64 heap_kb = 0;
+  double seconds = 0.0;
+};
+
+// Access kind inference of the parsed instruction graph in the given layout
+static GraphResult run_graph_case(const SymbolVector &symbols,
+                                  const InstructionGraph &parsed_inst_graph, GraphLayout layout,
+                                  u32 iterations, InstructionGraph &layout_inst_graph) {
+  GraphResult graph_result;
+
+  auto heap_begin = heap_bytes();
+  InstructionGraph inst_graph(parsed_inst_graph);
+  if (layout == GRAPH_FROZEN) {
+    inst_graph.freeze();
+  } else {
+    inst_graph.thaw();
+  }
+  auto heap_end = heap_bytes();
+  graph_result.heap_kb = heap_end > heap_begin ? (heap_end - heap_begin) / 1024 : 0;
+
+  for (u32 iter = 0; iter < iterations; ++iter) {
+    for (auto node_iter = inst_graph.nodes_begin(); node_iter != inst_graph.nodes_end();
+         ++node_iter) {
+      node_iter->second.access_kind = NULL;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    InstructionParser::infer_access_kinds(symbols, inst_graph);
+    auto end = std::chrono::steady_clock::now();
+    graph_result.seconds += std::chrono::duration<double>(end - begin).count();
+  }
+  layout_inst_graph = std::move(inst_graph);
+
+  return graph_result;
+}
+
+static bool same_symbols(SymbolVector &symbols, SymbolVector &other_symbols) {
+  if (symbols.size() != other_symbols.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (symbols[i].index != other_symbols[i].index ||
+        symbols[i].offset != other_symbols[i].offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool same_access_kinds(const AccessKindTable &access_kinds,
+                              const AccessKindTable &other_access_kinds) {
+  auto &slots = access_kinds.slots();
+  auto &other_slots = other_access_kinds.slots();
+  return access_kinds.start() == other_access_kinds.start() &&
+         access_kinds.shift() == other_access_kinds.shift() &&
+         slots.size() == other_slots.size() &&
+         memcmp(slots.data(), other_slots.data(), slots.size() * sizeof(AccessKindSlot)) == 0;
+}
+
+// Both readers must produce the same instructions, dependencies, and access kinds
+static bool same_graph(InstructionGraph &inst_graph, InstructionGraph &other_inst_graph) {
+  if (inst_graph.size() != other_inst_graph.size() ||
+      inst_graph.edge_size() != other_inst_graph.edge_size()) {
+    return false;
+  }
+
+  auto other_iter = other_inst_graph.nodes_begin();
+  for (auto iter = inst_graph.nodes_begin(); iter != inst_graph.nodes_end();
+       ++iter, ++other_iter) {
+    auto &inst = iter->second;
+    auto &other_inst = other_iter->second;
+    if (iter->first != other_iter->first || inst.op != other_inst.op ||
+        inst.predicate != other_inst.predicate || inst.dsts != other_inst.dsts ||
+        inst.srcs != other_inst.srcs || inst.udsts != other_inst.udsts ||
+        inst.usrcs != other_inst.usrcs || inst.assign_pcs != other_inst.assign_pcs ||
+        inst.uassign_pcs != other_inst.uassign_pcs) {
+      return false;
+    }
+
+    auto *access_kind = inst.access_kind.get();
+    auto *other_access_kind = other_inst.access_kind.get();
+    if ((access_kind == NULL) != (other_access_kind == NULL)) {
+      return false;
+    }
+    if (access_kind != NULL && (access_kind->vec_size != other_access_kind->vec_size ||
+                                access_kind->unit_size != other_access_kind->unit_size ||
+                                access_kind->data_type != other_access_kind->data_type)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void usage() {
+  std::cerr << "./redshow_parse_bench [options] /path/to/instruction/file..." << std::endl
+            << "  -i iterations  parses per file and reader (4)" << std::endl
+            << "  -c cache_dir   also measure loading from an instruction cache in cache_dir"
+            << std::endl
+            << "  -g             also measure access kind inference on tree and frozen graphs"
+            << std::endl
+            << "  -o output      json output file (redshow_parse_bench.json)" << std::endl;
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  u32 iterations = 4;
+  std::string output = "redshow_parse_bench.json";
+  std::string cache_dir;
+  bool graphs = false;
+  Vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-g") {
+      graphs = true;
+    } else if (arg == "-i" || arg == "-o" || arg == "-c") {
+      if (i + 1 >= argc) {
+        usage();
+      }
+      std::string value = argv[++i];
+      if (arg == "-i") {
+        try {
+          iterations = MAX2(static_cast<u32>(std::stoul(value)), 1u);
+        } catch (...) {
+          usage();
+        }
+      } else if (arg == "-o") {
+        output = value;
+      } else {
+        cache_dir = value;
+      }
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    usage();
+  }
+
+  std::ofstream out(output);
+  out << "{" << std::endl;
+  out << "  \"compiler\": \"" << __VERSION__ << "\"," << std::endl;
+  out << "  \"iterations\": " << iterations << "," << std::endl;
+  out << "  \"results\": [" << std::endl;
+
+  bool first = true;
+  int mismatches = 0;
+  std::stringstream graph_out;
+  bool graph_first = true;
+  for (auto &file_path : files) {
+    std::ifstream f(file_path.c_str());
+    if (!f.good()) {
+      std::cerr << "Cannot open " << file_path << std::endl;
+      continue;
+    }
+    f.seekg(0, std::ios::end);
+    u64 file_size = f.tellg();
+
+    // Whether the streaming reader handles the file without falling back to the tree reader
+    SymbolVector stream_symbols;
+    InstructionGraph stream_inst_graph;
+    bool streamed = InstructionReader::read(file_path, stream_symbols, stream_inst_graph);
+
+    u32 num_modes = cache_dir.empty() ? PARSE_CACHE : PARSE_MODE_COUNT;
+    SymbolVector symbols[PARSE_MODE_COUNT];
+    InstructionGraph inst_graphs[PARSE_MODE_COUNT];
+    AccessKindTable access_kinds[PARSE_MODE_COUNT];
+    ParseResult results[PARSE_MODE_COUNT];
+    bool match = true;
+    for (u32 mode = PARSE_STREAM; mode < num_modes; ++mode) {
+      if (mode == PARSE_CACHE) {
+        // Warm the cache with the streaming reader's results
+        InstructionCache::store(cache_dir, InstructionCache::key(file_path), symbols[PARSE_STREAM],
+                                inst_graphs[PARSE_STREAM], access_kinds[PARSE_STREAM]);
+      }
+      results[mode] = run_case(file_path, static_cast<ParseMode>(mode), iterations, cache_dir,
+                               symbols[mode], inst_graphs[mode], access_kinds[mode]);
+      if (mode != PARSE_STREAM) {
+        match = match && same_symbols(symbols[PARSE_STREAM], symbols[mode]) &&
+                same_access_kinds(access_kinds[PARSE_STREAM], access_kinds[mode]);
+      }
+      if (mode == PARSE_TREE) {
+        match = match && same_graph(inst_graphs[PARSE_STREAM], inst_graphs[mode]);
+      }
+    }
+    if (!match) {
+      mismatches++;
+    }
+
+    for (u32 mode = PARSE_STREAM; mode < num_modes; ++mode) {
+      auto &result = results[mode];
+      auto ms_per_parse = result.seconds * 1e3 / iterations;
+      auto mb_per_sec =
+          result.seconds > 0 ? file_size * iterations / result.seconds / (1 << 20) : 0;
+
+      std::cout << file_path << " " << MODE_NAMES[mode] << ": " << ms_per_parse << " ms/parse, "
+                << mb_per_sec << " MB/s, " << result.instructions << " instructions, "
+                << result.peak_rss_kb << " KB peak RSS" << (streamed ? "" : ", FALLBACK")
+                << (match ? "" : ", MISMATCH") << std::endl;
+
+      if (!first) {
+        out << "," << std::endl;
+      }
+      first = false;
+      out << "    {\"file\": \"" << file_path << "\", "
+          << "\"reader\": \"" << MODE_NAMES[mode] << "\", "
+          << "\"bytes\": " << file_size << ", "
+          << "\"instructions\": " << result.instructions << ", "
+          << "\"memory_instructions\": " << result.memory_instructions << ", "
+          << "\"streamed\": " << (streamed ? "true" : "false") << ", "
+          << "\"match\": " << (match ? "true" : "false") << ", "
+          << "\"seconds\": " << result.seconds << ", "
+          << "\"ms_per_parse\": " << ms_per_parse << ", "
+          << "\"mb_per_sec\": " << mb_per_sec << ", "
+          << "\"peak_rss_kb\": " << result.peak_rss_kb << "}";
+    }
+
+    if (!graphs) {
+      continue;
+    }
+
+    InstructionGraph layout_inst_graphs[GRAPH_LAYOUT_COUNT];
+    GraphResult graph_results[GRAPH_LAYOUT_COUNT];
+    for (u32 layout = GRAPH_TREE; layout < GRAPH_LAYOUT_COUNT; ++layout) {
+      graph_results[layout] =
+          run_graph_case(symbols[PARSE_STREAM], inst_graphs[PARSE_STREAM],
+                         static_cast<GraphLayout>(layout), iterations, layout_inst_graphs[layout]);
+    }
+    bool graph_match = same_graph(layout_inst_graphs[GRAPH_TREE], layout_inst_graphs[GRAPH_FROZEN]);
+    if (!graph_match) {
+      mismatches++;
+    }
+
+    for (u32 layout = GRAPH_TREE; layout < GRAPH_LAYOUT_COUNT; ++layout) {
+      auto &graph_result = graph_results[layout];
+      auto ms_per_inference = graph_result.seconds * 1e3 / iterations;
+
+      std::cout << file_path << " " << LAYOUT_NAMES[layout] << " graph: " << ms_per_inference
+                << " ms/inference, " << graph_result.heap_kb << " KB heap"
+                << (graph_match ? "" : ", MISMATCH") << std::endl;
+
+      if (!graph_first) {
+        graph_out << "," << std::endl;
+      }
+      graph_first = false;
+      graph_out << "    {\"file\": \"" << file_path << "\", "
+                << "\"layout\": \"" << LAYOUT_NAMES[layout] << "\", "
+                << "\"nodes\": " << layout_inst_graphs[layout].size() << ", "
+                << "\"edges\": " << layout_inst_graphs[layout].edge_size() << ", "
+                << "\"match\": " << (graph_match ? "true" : "false") << ", "
+                << "\"heap_kb\": " << graph_result.heap_kb << ", "
+                << "\"seconds\": " << graph_result.seconds << ", "
+                << "\"ms_per_inference\": " << ms_per_inference << "}";
+    }
+  }
+
+  out << std::endl << "  ]";
+  if (graphs) {
+    out << "," << std::endl << "  \"graphs\": [" << std::endl << graph_out.str() << std::endl
+        << "  ]";
+  }
+  out << std::endl << "}" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
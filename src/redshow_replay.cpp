@@ -0,0 +1,302 @@
+#include <redshow.h>
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+
+#include "common/utils.h"
+#include "replay/trace_file.h"
+
+using namespace redshow;
+
+// Device memory captured by the dtoh events of the current call
+static std::deque<TraceEvent> dtoh_events;
+
+static void replay_dtoh(uint64_t host_start, uint64_t device_start, uint64_t len) {
+  auto *host = reinterpret_cast<u8 *>(host_start);
+
+  if (dtoh_events.empty()) {
+    memset(host, 0, len);
+    return;
+  }
+
+  auto &event = dtoh_events.front();
+  auto captured_device_start = event.get<u64>();
+  u64 captured_len = 0;
+  auto *data = event.get_bytes(captured_len);
+  if (captured_device_start == device_start && captured_len == len) {
+    memcpy(host, data, len);
+  } else {
+    std::cerr << "Mismatched dtoh at 0x" << std::hex << device_start << std::dec << std::endl;
+    memset(host, 0, len);
+  }
+  dtoh_events.pop_front();
+}
+
+static void replay_log_data(int32_t /* kernel_id */, gpu_patch_buffer_t * /* trace_data */) {
+  // Buffers are owned by the replay loop
+}
+
+static void replay_record_data(uint32_t /* cubin_id */, int32_t /* kernel_id */,
+                               redshow_record_data_t * /* record_data */) {
+  // Results are written to the output directories by each analysis
+}
+
+static std::string remap_path(const std::string &path, const std::string &from,
+                              const std::string &to) {
+  if (!from.empty() && path.compare(0, from.size(), from) == 0) {
+    return to + path.substr(from.size());
+  }
+  return path;
+}
+
+static redshow_result_t replay_event(TraceEvent &event, bool async, const std::string &from,
+                                     const std::string &to) {
+  switch (event.type) {
+    case TRACE_EVENT_OUTPUT_DIR_CONFIG: {
+      auto analysis = static_cast<redshow_analysis_type_t>(event.get<u32>());
+      auto dir = event.get_string();
+      return redshow_output_dir_config(analysis, dir.c_str());
+    }
+    case TRACE_EVENT_DATA_TYPE_CONFIG: {
+      return redshow_data_type_config(static_cast<redshow_data_type_t>(event.get<u32>()));
+    }
+    case TRACE_EVENT_APPROX_LEVEL_CONFIG: {
+      return redshow_approx_level_config(static_cast<redshow_approx_level_t>(event.get<u32>()));
+    }
+    case TRACE_EVENT_ANALYSIS_ENABLE: {
+      auto result =
+          redshow_analysis_enable(static_cast<redshow_analysis_type_t>(event.get<u32>()));
+      // Analyses only get the dtoh function registered before they are enabled
+      redshow_tool_dtoh_register(replay_dtoh);
+      return result;
+    }
+    case TRACE_EVENT_ANALYSIS_DISABLE: {
+      return redshow_analysis_disable(static_cast<redshow_analysis_type_t>(event.get<u32>()));
+    }
+    case TRACE_EVENT_ANALYSIS_CONFIG: {
+      auto analysis = static_cast<redshow_analysis_type_t>(event.get<u32>());
+      auto config = static_cast<redshow_analysis_config_type_t>(event.get<u32>());
+      auto enable = event.get<u8>() != 0;
+      return redshow_analysis_config(analysis, config, enable);
+    }
+    case TRACE_EVENT_RECORD_DATA_CONFIG: {
+      auto pc_views = event.get<u32>();
+      auto mem_views = event.get<u32>();
+      return redshow_record_data_callback_register(replay_record_data, pc_views, mem_views);
+    }
+    case TRACE_EVENT_CUBIN_REGISTER:
+    case TRACE_EVENT_CUBIN_CACHE_REGISTER: {
+      auto cubin_id = event.get<u32>();
+      auto mod_id = event.get<u32>();
+      u64 len = 0;
+      auto *data = event.get_bytes(len);
+      auto path = remap_path(event.get_string(), from, to);
+      auto nsymbols = static_cast<uint32_t>(len / sizeof(uint64_t));
+      Vector<uint64_t> symbol_pcs(nsymbols);
+      if (nsymbols != 0) {
+        memcpy(symbol_pcs.data(), data, nsymbols * sizeof(uint64_t));
+      }
+      if (event.type == TRACE_EVENT_CUBIN_REGISTER) {
+        return redshow_cubin_register(cubin_id, mod_id, nsymbols, symbol_pcs.data(),
+                                      path.c_str());
+      } else {
+        return redshow_cubin_cache_register(cubin_id, mod_id, nsymbols, symbol_pcs.data(),
+                                            path.c_str());
+      }
+    }
+    case TRACE_EVENT_CUBIN_UNREGISTER: {
+      auto cubin_id = event.get<u32>();
+      auto mod_id = event.get<u32>();
+      return redshow_cubin_unregister(cubin_id, mod_id);
+    }
+    case TRACE_EVENT_MEMORY_REGISTER:
+    case TRACE_EVENT_MEMORY_UNREGISTER: {
+      auto stream_id = event.get<u32>();
+      auto memory_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      auto start = event.get<u64>();
+      auto end = event.get<u64>();
+      if (event.type == TRACE_EVENT_MEMORY_REGISTER) {
+        return redshow_memory_register(stream_id, memory_id, host_op_id, start, end);
+      } else {
+        return redshow_memory_unregister(stream_id, memory_id, host_op_id, start, end);
+      }
+    }
+    case TRACE_EVENT_SUBMEMORY_REGISTER:
+    case TRACE_EVENT_SUBMEMORY_UNREGISTER: {
+      auto sub_memory_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      auto start = event.get<u64>();
+      auto end = event.get<u64>();
+      if (event.type == TRACE_EVENT_SUBMEMORY_REGISTER) {
+        return redshow_submemory_register(sub_memory_id, host_op_id, start, end);
+      } else {
+        return redshow_submemory_unregister(sub_memory_id, host_op_id, start, end);
+      }
+    }
+    case TRACE_EVENT_MEMCPY_REGISTER: {
+      auto memcpy_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      auto src_host = event.get<u8>() != 0;
+      auto src_stream_id = event.get<u32>();
+      auto src_start = event.get<u64>();
+      auto dst_host = event.get<u8>() != 0;
+      auto dst_stream_id = event.get<u32>();
+      auto dst_start = event.get<u64>();
+      auto len = event.get<u64>();
+      return redshow_memcpy_register(memcpy_id, host_op_id, src_host, src_stream_id, src_start,
+                                     dst_host, dst_stream_id, dst_start, len);
+    }
+    case TRACE_EVENT_MEMSET_REGISTER: {
+      auto stream_id = event.get<u32>();
+      auto memset_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      auto start = event.get<u64>();
+      auto value = event.get<u32>();
+      auto len = event.get<u64>();
+      return redshow_memset_register(stream_id, memset_id, host_op_id, start, value, len);
+    }
+    case TRACE_EVENT_KERNEL_BEGIN: {
+      auto cpu_thread = event.get<u32>();
+      auto kernel_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      return redshow_kernel_begin(cpu_thread, kernel_id, host_op_id);
+    }
+    case TRACE_EVENT_KERNEL_END: {
+      auto cpu_thread = event.get<u32>();
+      auto stream_id = event.get<u32>();
+      auto kernel_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      return redshow_kernel_end(cpu_thread, stream_id, kernel_id, host_op_id);
+    }
+    case TRACE_EVENT_ANALYZE: {
+      auto cpu_thread = event.get<u32>();
+      auto cubin_id = event.get<u32>();
+      auto mod_id = event.get<u32>();
+      auto kernel_id = event.get<i32>();
+      auto host_op_id = event.get<u64>();
+      auto stream_id = event.get<u32>();
+      TraceBuffer trace_buffer;
+      event.get_buffer(trace_buffer);
+      if (async) {
+        return redshow_analyze_async(cpu_thread, cubin_id, mod_id, kernel_id, host_op_id,
+                                     stream_id, &trace_buffer.buffer);
+      } else {
+        return redshow_analyze(cpu_thread, cubin_id, mod_id, kernel_id, host_op_id, stream_id,
+                               &trace_buffer.buffer);
+      }
+    }
+    case TRACE_EVENT_ANALYSIS_BEGIN: {
+      return redshow_analysis_begin();
+    }
+    case TRACE_EVENT_ANALYSIS_END: {
+      return redshow_analysis_end();
+    }
+    case TRACE_EVENT_FLUSH_THREAD: {
+      return redshow_flush_thread(event.get<u32>());
+    }
+    case TRACE_EVENT_FLUSH: {
+      return redshow_flush();
+    }
+    default: {
+      return REDSHOW_ERROR_NOT_IMPL;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool async = false;
+  // 0 keeps the library's default number of analysis workers
+  u32 num_workers = 0;
+  std::string from;
+  std::string to;
+  std::string capture_path;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-a") {
+      async = true;
+    } else if (arg == "-j" && i + 1 < argc) {
+      num_workers = std::stoul(argv[++i]);
+    } else if (arg == "-p" && i + 1 < argc) {
+      // old_prefix=new_prefix
+      std::string remap = argv[++i];
+      auto pos = remap.find("=");
+      if (pos != std::string::npos) {
+        from = remap.substr(0, pos);
+        to = remap.substr(pos + 1);
+      }
+    } else {
+      capture_path = arg;
+    }
+  }
+
+  if (capture_path.empty()) {
+    std::cerr << "./redshow_replay [-a] [-j num_workers] [-p old_cubin_prefix=new_cubin_prefix] "
+                 "/path/to/capture"
+              << std::endl;
+    exit(-1);
+  }
+
+  TraceReader reader;
+  if (!reader.open(capture_path)) {
+    std::cerr << "Failed to open capture file " << capture_path << ", expect version "
+              << TRACE_FILE_VERSION << std::endl;
+    exit(-1);
+  }
+
+  if (async && num_workers != 0) {
+    redshow_analysis_async_config(num_workers, ASYNC_QUEUE_BYTES);
+  }
+
+  redshow_log_data_callback_register(replay_log_data);
+  redshow_record_data_callback_register(replay_record_data, PC_VIEWS_LIMIT, MEM_VIEWS_LIMIT);
+
+  u64 counts[TRACE_EVENT_COUNT] = {0};
+  u64 failures = 0;
+
+  auto begin = std::chrono::steady_clock::now();
+
+  TraceEvent event;
+  TraceEvent next;
+  bool has_next = reader.read(next);
+  while (has_next) {
+    std::swap(event, next);
+    // dtoh events are recorded while the preceding call runs
+    while ((has_next = reader.read(next)) && next.type == TRACE_EVENT_DTOH) {
+      dtoh_events.emplace_back(next);
+    }
+
+    if (event.type == TRACE_EVENT_DTOH) {
+      continue;
+    }
+
+    auto result = replay_event(event, async, from, to);
+    if (event.type < TRACE_EVENT_COUNT) {
+      counts[event.type]++;
+    }
+    if (result != REDSHOW_SUCCESS) {
+      failures++;
+    }
+
+    dtoh_events.clear();
+  }
+
+  redshow_analysis_drain();
+
+  auto end = std::chrono::steady_clock::now();
+  auto seconds = std::chrono::duration<double>(end - begin).count();
+
+  u64 total = 0;
+  for (auto count : counts) {
+    total += count;
+  }
+  std::cout << "events: " << total << ", analyze: " << counts[TRACE_EVENT_ANALYZE]
+            << ", non-success results: " << failures << ", time: " << seconds << " s"
+            << std::endl;
+
+  return 0;
+}
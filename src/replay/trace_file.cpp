@@ -0,0 +1,229 @@
+#include "replay/trace_file.h"
+
+namespace redshow {
+
+size_t TraceBuffer::record_size(u32 type) {
+  if (type == GPU_PATCH_TYPE_DEFAULT) {
+    return sizeof(gpu_patch_record_t);
+  } else if (type == GPU_PATCH_TYPE_ADDRESS_PATCH) {
+    return sizeof(gpu_patch_record_address_t);
+  } else if (type == GPU_PATCH_TYPE_ADDRESS_ANALYSIS) {
+    return sizeof(gpu_patch_analysis_address_t);
+  }
+  return 0;
+}
+
+void TraceBuffer::copy(const gpu_patch_buffer_t *trace_data) {
+  buffer = *trace_data;
+
+  auto len = records_size();
+  records.reset(new u8[len]);
+  if (len != 0) {
+    memcpy(records.get(), trace_data->records, len);
+  }
+  buffer.records = records.get();
+
+  if (trace_data->aux) {
+    aux.reset(new gpu_patch_aux_address_dict_t);
+    memcpy(aux.get(), trace_data->aux, sizeof(gpu_patch_aux_address_dict_t));
+  } else {
+    aux.reset();
+  }
+  buffer.aux = aux.get();
+
+  if (trace_data->torch_aux) {
+    torch_aux.reset(new gpu_patch_aux_address_dict_t);
+    memcpy(torch_aux.get(), trace_data->torch_aux, sizeof(gpu_patch_aux_address_dict_t));
+  } else {
+    torch_aux.reset();
+  }
+  buffer.torch_aux = torch_aux.get();
+}
+
+TraceEvent &TraceEvent::put_bytes(const void *data, u64 len) {
+  put<u64>(len);
+  auto *bytes = reinterpret_cast<const u8 *>(data);
+  _payload.insert(_payload.end(), bytes, bytes + len);
+  return *this;
+}
+
+TraceEvent &TraceEvent::put_string(const char *str) {
+  return put_bytes(str, str == NULL ? 0 : strlen(str));
+}
+
+TraceEvent &TraceEvent::put_buffer(const gpu_patch_buffer_t *trace_data) {
+  // Only fields read by the analyses are kept
+  put<u32>(trace_data->type);
+  put<u32>(trace_data->flags);
+  put<u32>(trace_data->size);
+  put<u32>(trace_data->head_index);
+  put_bytes(trace_data->records,
+            TraceBuffer::record_size(trace_data->type) * trace_data->head_index);
+  put_bytes(trace_data->aux, trace_data->aux ? sizeof(gpu_patch_aux_address_dict_t) : 0);
+  put_bytes(trace_data->torch_aux,
+            trace_data->torch_aux ? sizeof(gpu_patch_aux_address_dict_t) : 0);
+  return *this;
+}
+
+const u8 *TraceEvent::get_bytes(u64 &len) {
+  len = get<u64>();
+  if (truncated() || _offset + len > _payload.size()) {
+    _offset = _payload.size() + 1;
+    len = 0;
+    return NULL;
+  }
+  auto *data = _payload.data() + _offset;
+  _offset += len;
+  return data;
+}
+
+std::string TraceEvent::get_string() {
+  u64 len = 0;
+  auto *data = get_bytes(len);
+  if (data == NULL) {
+    return std::string();
+  }
+  return std::string(reinterpret_cast<const char *>(data), len);
+}
+
+void TraceEvent::get_buffer(TraceBuffer &trace_buffer) {
+  gpu_patch_buffer_t trace_data;
+  memset(&trace_data, 0, sizeof(trace_data));
+  trace_data.type = get<u32>();
+  trace_data.flags = get<u32>();
+  trace_data.size = get<u32>();
+  trace_data.head_index = get<u32>();
+
+  u64 len = 0;
+  trace_data.records = const_cast<u8 *>(get_bytes(len));
+  if (len != TraceBuffer::record_size(trace_data.type) * trace_data.head_index) {
+    trace_data.head_index = 0;
+  }
+  trace_data.aux = const_cast<u8 *>(get_bytes(len));
+  if (len != sizeof(gpu_patch_aux_address_dict_t)) {
+    trace_data.aux = NULL;
+  }
+  trace_data.torch_aux = const_cast<u8 *>(get_bytes(len));
+  if (len != sizeof(gpu_patch_aux_address_dict_t)) {
+    trace_data.torch_aux = NULL;
+  }
+
+  trace_buffer.copy(&trace_data);
+}
+
+bool TraceWriter::open(const std::string &path) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_file != NULL) {
+    return false;
+  }
+
+  _failed = false;
+  _file = fopen(path.c_str(), "wb");
+  if (_file == NULL) {
+    return false;
+  }
+
+  u32 reserved = 0;
+  if (fwrite(TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC), 1, _file) != 1 ||
+      fwrite(&TRACE_FILE_VERSION, sizeof(TRACE_FILE_VERSION), 1, _file) != 1 ||
+      fwrite(&reserved, sizeof(reserved), 1, _file) != 1) {
+    fclose(_file);
+    _file = NULL;
+    return false;
+  }
+  _open.store(true, std::memory_order_release);
+  return true;
+}
+
+void TraceWriter::close() {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_file != NULL) {
+    _open.store(false, std::memory_order_release);
+    fclose(_file);
+    _file = NULL;
+  }
+}
+
+bool TraceWriter::failed() const {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  return _failed;
+}
+
+bool TraceWriter::write(const TraceEvent &event) {
+  std::unique_lock<std::mutex> lock(_lock);
+
+  if (_file == NULL) {
+    return false;
+  }
+
+  u32 type = event.type;
+  u32 reserved = 0;
+  u64 len = event.payload().size();
+  if (fwrite(&type, sizeof(type), 1, _file) != 1 ||
+      fwrite(&reserved, sizeof(reserved), 1, _file) != 1 ||
+      fwrite(&len, sizeof(len), 1, _file) != 1 ||
+      (len != 0 && fwrite(event.payload().data(), 1, len, _file) != len)) {
+    // Later events would follow a partial one, stop capturing
+    _open.store(false, std::memory_order_release);
+    fclose(_file);
+    _file = NULL;
+    _failed = true;
+    return false;
+  }
+  return true;
+}
+
+bool TraceReader::open(const std::string &path) {
+  close();
+
+  _file = fopen(path.c_str(), "rb");
+  if (_file == NULL) {
+    return false;
+  }
+
+  char magic[sizeof(TRACE_FILE_MAGIC)];
+  u32 reserved = 0;
+  if (fread(magic, sizeof(magic), 1, _file) != 1 ||
+      memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) != 0 ||
+      fread(&_version, sizeof(_version), 1, _file) != 1 ||
+      fread(&reserved, sizeof(reserved), 1, _file) != 1 || _version != TRACE_FILE_VERSION) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void TraceReader::close() {
+  if (_file != NULL) {
+    fclose(_file);
+    _file = NULL;
+  }
+}
+
+bool TraceReader::read(TraceEvent &event) {
+  if (_file == NULL) {
+    return false;
+  }
+
+  u32 type = 0;
+  u32 reserved = 0;
+  u64 len = 0;
+  if (fread(&type, sizeof(type), 1, _file) != 1 ||
+      fread(&reserved, sizeof(reserved), 1, _file) != 1 ||
+      fread(&len, sizeof(len), 1, _file) != 1) {
+    return false;
+  }
+
+  auto &payload = event.payload();
+  payload.resize(len);
+  if (len != 0 && fread(payload.data(), 1, len, _file) != len) {
+    return false;
+  }
+  event.type = static_cast<TraceEventType>(type);
+  return true;
+}
+
+}  // namespace redshow
@@ -0,0 +1,229 @@
+/*
+ * Checks IntervalSet against a bitmap of the covered addresses
+ */
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "operation/interval_set.h"
+
+using redshow::IntervalSet;
+using redshow::MemoryRange;
+using redshow::u64;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      ++failures;                                                            \
+    }                                                                        \
+  } while (0)
+
+// Addresses are below UNIVERSE, so the reference is a bitmap
+static const u64 UNIVERSE = 512;
+
+struct Reference {
+  std::vector<bool> bits = std::vector<bool>(UNIVERSE, false);
+
+  void add(u64 start, u64 end) {
+    for (auto addr = start; addr < end; ++addr) {
+      bits[addr] = true;
+    }
+  }
+
+  void merge(const Reference &other) {
+    for (u64 addr = 0; addr < UNIVERSE; ++addr) {
+      bits[addr] = bits[addr] || other.bits[addr];
+    }
+  }
+
+  // Maximal runs of set bits, adjacent ranges are one run
+  std::vector<MemoryRange> ranges() const {
+    std::vector<MemoryRange> ranges;
+    for (u64 addr = 0; addr < UNIVERSE; ++addr) {
+      if (!bits[addr]) {
+        continue;
+      }
+      if (!ranges.empty() && ranges.back().end == addr) {
+        ranges.back().end = addr + 1;
+      } else {
+        ranges.emplace_back(addr, addr + 1);
+      }
+    }
+    return ranges;
+  }
+};
+
+static bool same(const IntervalSet &set, const std::vector<MemoryRange> &ranges) {
+  if (set.size() != ranges.size()) {
+    return false;
+  }
+  size_t i = 0;
+  u64 bytes = 0;
+  for (auto &range : set) {
+    if (range.start != ranges[i].start || range.end != ranges[i].end) {
+      return false;
+    }
+    bytes += ranges[i].end - ranges[i].start;
+    ++i;
+  }
+  return set.bytes() == bytes;
+}
+
+static bool same(const IntervalSet &set, const IntervalSet &other) {
+  return same(set, std::vector<MemoryRange>(other.begin(), other.end()));
+}
+
+// Random ranges, including empty ones, within [base, base + span)
+static void random_add(std::mt19937_64 &rng, u64 base, u64 span, size_t n, IntervalSet &set,
+                       Reference &reference) {
+  for (size_t i = 0; i < n; ++i) {
+    u64 start = base + rng() % span;
+    u64 end = start + rng() % 24;
+    end = end > base + span ? base + span : end;
+    set.add(start, end);
+    reference.add(start, end);
+  }
+}
+
+static void test_empty() {
+  IntervalSet set;
+  CHECK(set.empty() && set.normalized() && set.bytes() == 0);
+
+  set.add(8, 8);
+  set.add(9, 3);
+  CHECK(set.empty() && set.normalized());
+
+  set.normalize();
+  CHECK(set.empty());
+
+  IntervalSet other;
+  set.merge(other);
+  CHECK(set.empty());
+
+  other.add(4, 12);
+  set.merge(other);
+  CHECK(same(set, {MemoryRange(4, 12)}));
+
+  set.merge(IntervalSet());
+  CHECK(same(set, {MemoryRange(4, 12)}));
+
+  set.clear();
+  CHECK(set.empty() && set.normalized());
+}
+
+static void test_adjacent() {
+  // start == back.end extends the last range without normalize
+  IntervalSet set;
+  set.add(0, 4);
+  set.add(4, 8);
+  set.add(8, 8);
+  CHECK(set.normalized());
+  CHECK(same(set, {MemoryRange(0, 8)}));
+
+  set.add(9, 12);
+  CHECK(same(set, {MemoryRange(0, 8), MemoryRange(9, 12)}));
+
+  // Adjacent out of order ranges are coalesced by normalize
+  IntervalSet reversed;
+  reversed.add(8, 12);
+  reversed.add(4, 8);
+  reversed.add(0, 4);
+  CHECK(!reversed.normalized());
+  reversed.normalize();
+  CHECK(same(reversed, {MemoryRange(0, 12)}));
+
+  // other.front().start == back().end is not appended as a separate range
+  IntervalSet left, right;
+  left.add(0, 4);
+  right.add(4, 8);
+  right.add(16, 20);
+  left.merge(right);
+  CHECK(same(left, {MemoryRange(0, 8), MemoryRange(16, 20)}));
+}
+
+static void test_out_of_order(std::mt19937_64 &rng) {
+  for (int iter = 0; iter < 2000; ++iter) {
+    IntervalSet set;
+    Reference reference;
+    random_add(rng, 0, UNIVERSE, rng() % 40, set, reference);
+
+    set.normalize();
+    CHECK(set.normalized());
+    CHECK(same(set, reference.ranges()));
+
+    // Idempotent, coalesced ranges added out of order are normalized to themselves
+    IntervalSet again;
+    for (auto iter = set.end(); iter != set.begin();) {
+      again.add(*--iter);
+    }
+    CHECK(again.normalized() == (set.size() <= 1));
+    again.normalize();
+    CHECK(same(again, set));
+    again.normalize();
+    CHECK(same(again, set));
+
+    // Ascending adds stay normalized
+    IntervalSet ascending;
+    for (auto &range : set) {
+      ascending.add(range);
+    }
+    CHECK(ascending.normalized());
+    CHECK(same(ascending, set));
+  }
+}
+
+static void test_merge(std::mt19937_64 &rng) {
+  for (int iter = 0; iter < 2000; ++iter) {
+    IntervalSet set, other;
+    Reference reference, other_reference;
+
+    bool after = iter % 2 == 0;
+    if (after) {
+      // Fast path, other starts after the end of set
+      random_add(rng, 0, UNIVERSE / 2, rng() % 20, set, reference);
+      random_add(rng, UNIVERSE / 2 + 1, UNIVERSE / 2 - 1, rng() % 20, other, other_reference);
+    } else {
+      // Interleaved
+      random_add(rng, 0, UNIVERSE, rng() % 20, set, reference);
+      random_add(rng, 0, UNIVERSE, rng() % 20, other, other_reference);
+    }
+    set.normalize();
+    other.normalize();
+
+    IntervalSet merged = set;
+    merged.merge(other);
+    reference.merge(other_reference);
+    CHECK(same(merged, reference.ranges()));
+
+    // Merge is symmetric
+    IntervalSet reversed = other;
+    reversed.merge(set);
+    CHECK(same(reversed, merged));
+
+    CHECK(merged.normalized());
+
+    // Merging a set into itself does not change it
+    IntervalSet twice = merged;
+    twice.merge(merged);
+    CHECK(same(twice, merged));
+  }
+}
+
+int main() {
+  std::mt19937_64 rng(20);
+
+  test_empty();
+  test_adjacent();
+  test_out_of_order(rng);
+  test_merge(rng);
+
+  if (failures != 0) {
+    fprintf(stderr, "test_interval_set: %d checks failed\n", failures);
+    return 1;
+  }
+  printf("test_interval_set: passed\n");
+  return 0;
+}
@@ -0,0 +1,188 @@
+/*
+ * Checks the SIMD warp routines against the scalar ones, and ValueDecoder against decoding every
+ * unit with AccessKind::value_to_basic_type
+ */
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+
+#include "analysis/value_decoder.h"
+#include "common/simd.h"
+
+using namespace redshow;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+      ++failures;                                                            \
+    }                                                                        \
+  } while (0)
+
+static const u32 NUM_BLOCKS = 100000;
+static const u32 NUM_RECORDS = 200;
+
+static void random_bytes(std::mt19937_64 &rng, u8 *bytes, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = rng();
+  }
+}
+
+// Vector routines must produce the same bits as the scalar ones
+static void test_simd(std::mt19937_64 &rng) {
+  auto &scalar = simd_warp_functions(SIMD_SCALAR);
+
+  for (u32 i = SIMD_SCALAR + 1; i < SIMD_LEVEL_COUNT; ++i) {
+    auto level = static_cast<SimdLevel>(i);
+    if (!simd_supported(level)) {
+      printf("test_simd: %s not supported\n", simd_level_name(level));
+      continue;
+    }
+
+    auto &functions = simd_warp_functions(level);
+    u32 mismatches = 0;
+    for (u32 n = 0; n < NUM_BLOCKS; ++n) {
+      u8 block[GPU_PATCH_WARP_SIZE][GPU_PATCH_MAX_ACCESS_SIZE];
+      random_bytes(rng, block[0], sizeof(block));
+
+      // Truncation masks of every approximation level, and random masks
+      u64 mask = rng();
+      if (n % 3 == 0) {
+        mask = value_to_float(0xffffffffffffffff, rng() % (VALID_FLOAT_DIGITS + 1));
+      } else if (n % 3 == 1) {
+        mask = value_to_double(0xffffffffffffffff, rng() % (VALID_DOUBLE_DIGITS + 1));
+      }
+
+      u64 expected[GPU_PATCH_WARP_SIZE];
+      u64 values[GPU_PATCH_WARP_SIZE];
+      u32 offset = rng() % (GPU_PATCH_MAX_ACCESS_SIZE / sizeof(u32)) * sizeof(u32);
+      scalar.extract_u32(block[0], offset, mask, expected);
+      functions.extract_u32(block[0], offset, mask, values);
+      mismatches += memcmp(expected, values, sizeof(values)) != 0;
+
+      offset = rng() % (GPU_PATCH_MAX_ACCESS_SIZE / sizeof(u64)) * sizeof(u64);
+      scalar.extract_u64(block[0], offset, mask, expected);
+      functions.extract_u64(block[0], offset, mask, values);
+      mismatches += memcmp(expected, values, sizeof(values)) != 0;
+
+      // In place
+      mask = rng();
+      scalar.mask(expected, mask, expected);
+      functions.mask(values, mask, values);
+      mismatches += memcmp(expected, values, sizeof(values)) != 0;
+    }
+
+    if (mismatches != 0) {
+      fprintf(stderr, "test_simd: %s, %u mismatches in %u blocks\n", simd_level_name(level),
+              mismatches, NUM_BLOCKS);
+    }
+    CHECK(mismatches == 0);
+  }
+}
+
+// Decodes the units of active lanes one by one, as analyses did before ValueDecoder
+static void decode_reference(const AccessKind &access_kind, const gpu_patch_record_t *record,
+                             u32 active, int decimal_degree_f32, int decimal_degree_f64,
+                             u64 values[WARP_ACCESS_MAX_UNITS][GPU_PATCH_WARP_SIZE]) {
+  AccessKind unit_kind(access_kind.unit_size, access_kind.unit_size, access_kind.data_type);
+  u32 byte_size = unit_kind.unit_size >> 3u;
+  u32 num_units = access_kind.vec_size / access_kind.unit_size;
+  for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+    if ((active & (0x1u << j)) == 0) {
+      continue;
+    }
+    for (u32 m = 0; m < num_units; ++m) {
+      u64 value = 0;
+      memcpy(&value, &record->value[j][m * byte_size], byte_size);
+      values[m][j] = unit_kind.value_to_basic_type(value, decimal_degree_f32, decimal_degree_f64);
+    }
+  }
+}
+
+static void test_value_decoder(std::mt19937_64 &rng) {
+  const redshow_data_type_t data_types[] = {REDSHOW_DATA_UNKNOWN, REDSHOW_DATA_INT,
+                                            REDSHOW_DATA_FLOAT};
+  // <f32, f64> decimal degrees, the last pair does not truncate
+  const int decimal_degrees[][2] = {
+      {0, 0}, {3, 11}, {7, 23}, {14, 37}, {22, 51}, {VALID_FLOAT_DIGITS, VALID_DOUBLE_DIGITS}};
+  auto warp_access = std::make_unique<WarpAccess>();
+  auto expected = std::make_unique<u64[][GPU_PATCH_WARP_SIZE]>(WARP_ACCESS_MAX_UNITS);
+  u32 specialized = 0;
+  u32 generic = 0;
+
+  for (u32 unit_size = 8; unit_size <= 64; unit_size *= 2) {
+    // Vectors of 1 to 16 units up to 128 bits, including sizes without a specialized loop
+    for (u32 vec_size = unit_size; vec_size <= GPU_PATCH_MAX_ACCESS_SIZE * 8;
+         vec_size += unit_size) {
+      for (auto data_type : data_types) {
+        for (auto &degrees : decimal_degrees) {
+          int decimal_degree_f32 = degrees[0];
+          int decimal_degree_f64 = degrees[1];
+
+          AccessKind access_kind(unit_size, vec_size, data_type);
+          ValueDecoder value_decoder(access_kind, decimal_degree_f32, decimal_degree_f64);
+          if (value_decoder.specialized()) {
+            ++specialized;
+          } else {
+            ++generic;
+          }
+
+          warp_access->access_kind = access_kind;
+          warp_access->access_kind.vec_size = unit_size;
+          warp_access->num_units = vec_size / unit_size;
+
+          u32 mismatches = 0;
+          for (u32 n = 0; n < NUM_RECORDS; ++n) {
+            gpu_patch_record_t record;
+            memset(&record, 0, sizeof(record));
+            random_bytes(rng, record.value[0], sizeof(record.value));
+            u32 active = n % 4 == 0 ? 0xffffffff : static_cast<u32>(rng());
+            record.active = active;
+            warp_access->active = active;
+
+            value_decoder.decode(&record, *warp_access);
+            decode_reference(access_kind, &record, active, decimal_degree_f32,
+                             decimal_degree_f64, expected.get());
+
+            // Values of inactive lanes are undefined
+            for (u32 m = 0; m < warp_access->num_units; ++m) {
+              for (u32 j = 0; j < GPU_PATCH_WARP_SIZE; ++j) {
+                if ((active & (0x1u << j)) != 0 && warp_access->values[m][j] != expected[m][j]) {
+                  ++mismatches;
+                }
+              }
+            }
+          }
+
+          if (mismatches != 0) {
+            fprintf(stderr, "test_simd: decoder %s, f32 %d, f64 %d, %u mismatches\n",
+                    access_kind.to_string().c_str(), decimal_degree_f32, decimal_degree_f64,
+                    mismatches);
+          }
+          CHECK(mismatches == 0);
+        }
+      }
+    }
+  }
+
+  // Both the specialized loops and the generic path are covered
+  CHECK(specialized != 0 && generic != 0);
+}
+
+int main() {
+  std::mt19937_64 rng(24);
+
+  printf("test_simd: level %s\n", simd_level_name(simd_level()));
+  test_simd(rng);
+  test_value_decoder(rng);
+
+  if (failures != 0) {
+    fprintf(stderr, "test_simd: %d checks failed\n", failures);
+    return 1;
+  }
+  printf("test_simd: passed\n");
+  return 0;
+}